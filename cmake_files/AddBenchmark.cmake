@@ -0,0 +1,30 @@
+if(NOT TARGET benchmarks)
+  add_custom_target(benchmarks)
+endif()
+
+function(add_benchmark targetname)
+  cmake_parse_arguments(benchmark "" "" "LIBRARIES;DEPENDS" ${ARGN})
+
+  # Source deduce from targetname if possible
+  unset(source)
+  if(EXISTS "${CMAKE_CURRENT_SOURCE_DIR}/${targetname}.cc")
+    set(source ${targetname}.cc)
+  elseif("${benchmark_UNPARSED_ARGUMENTS}" STREQUAL "")
+    message(FATAL_ERROR "No source given or found for ${targetname}")
+  endif()
+
+  add_executable(benchmark_${targetname} ${source} ${benchmark_UNPARSED_ARGUMENTS})
+  set_target_properties(benchmark_${targetname} PROPERTIES OUTPUT_NAME ${targetname}
+    RUNTIME_OUTPUT_DIRECTORY "${PROJECT_BINARY_DIR}/benchmarks")
+
+  if(benchmark_LIBRARIES)
+    target_link_libraries(benchmark_${targetname} ${benchmark_LIBRARIES})
+  endif()
+  add_dependencies(benchmarks benchmark_${targetname})
+  if(benchmark_DEPENDS)
+    add_dependencies(benchmark_${targetname} ${benchmark_DEPENDS})
+  endif()
+  if(TARGET lookup_dependencies)
+    add_dependencies(benchmark_${targetname} lookup_dependencies)
+  endif()
+endfunction()
@@ -1,22 +1,26 @@
 #include "purify/config.h"
 #include "AlgorithmUpdate.h"
+#include "purify/instrumentation.h"
 
 namespace purify {
 
 AlgorithmUpdate::AlgorithmUpdate(const purify::Params &params, const utilities::vis_params &uv_data,
                                  sopt::algorithm::ImagingProximalADMM<t_complex> &padmm,
-                                 std::ostream &stream, const MeasurementOperator &measurements,
+                                 std::ostream &stream,
+                                 const sopt::LinearTransform<sopt::Vector<sopt::t_complex>> &Phi,
                                  const sopt::LinearTransform<sopt::Vector<sopt::t_complex>> &Psi)
     : params(params), stats(read_params_to_stats(params)), uv_data(uv_data), out_diagnostic(stream),
-      padmm(padmm), c_start(std::clock()), Psi(Psi), measurements(measurements){};
+      padmm(padmm), c_start(std::chrono::steady_clock::now()), Psi(Psi), Phi(Phi){};
 
 bool AlgorithmUpdate::operator()(const Vector<t_complex> &x) {
-  std::clock_t c_end = std::clock();
-  stats.total_time = (c_end - c_start) / CLOCKS_PER_SEC; // total time for solver to run in seconds
+  instrumentation::ScopedEvent const event("algorithm_update");
+  // wall clock time for solver to run in seconds, std::clock would add up the time of all threads
+  stats.total_time
+      = std::chrono::duration<t_real>(std::chrono::steady_clock::now() - c_start).count();
   // Getting things ready for l1 and l2 norm calculation
   Image<t_complex> const image = Image<t_complex>::Map(x.data(), params.height, params.width);
   Vector<t_complex> const y_residual
-      = ((uv_data.vis - measurements.degrid(image)).array() * uv_data.weights.array().real());
+      = ((uv_data.vis - Phi * x).array() * uv_data.weights.array().real());
   stats.l2_norm = y_residual.stableNorm();
   Vector<t_complex> const alpha = Psi.adjoint() * x;
   // updating parameter
@@ -33,7 +37,9 @@ bool AlgorithmUpdate::operator()(const Vector<t_complex> &x) {
     std::string const residual_fits_scaled
         = params.name + "_residual_" + params.weighting + "_update_scaled.fits";
 
-    auto const residual = measurements.grid(y_residual);
+    Vector<t_complex> const residual_vector = Phi.adjoint() * y_residual;
+    auto const residual
+        = Image<t_complex>::Map(residual_vector.data(), params.height, params.width);
     AlgorithmUpdate::save_figure(x, outfile_fits, "JY/PIXEL", 1);
     if(params.upsample_ratio != 1)
       AlgorithmUpdate::save_figure(x, outfile_upsample_fits, "JY/PIXEL", params.upsample_ratio);
@@ -48,7 +54,7 @@ bool AlgorithmUpdate::operator()(const Vector<t_complex> &x) {
     stats.max = residual.matrix().real().maxCoeff();
     stats.min = residual.matrix().real().minCoeff();
     // printing log information to stream
-    AlgorithmUpdate::print_to_stream(out_diagnostic);
+    AlgorithmUpdate::print_to_stream(out_diagnostic, true);
   }
   AlgorithmUpdate::print_to_stream(std::cout);
   stats.iter++;
@@ -78,11 +84,14 @@ void AlgorithmUpdate::modify_gamma(Vector<t_complex> const &alpha) {
   }
 }
 
-void AlgorithmUpdate::print_to_stream(std::ostream &stream) {
-  if(stats.iter == 0)
+void AlgorithmUpdate::print_to_stream(std::ostream &stream, bool with_stages) {
+  if(stats.iter == 0) {
     stream
-        << "i Gamma RelativeGamma DynamicRange RMS(Res) Max(Res) Min(Res) l1_norm l2_norm l1_variation Time(sec)"
-        << std::endl;
+        << "i Gamma RelativeGamma DynamicRange RMS(Res) Max(Res) Min(Res) l1_norm l2_norm l1_variation Time(sec)";
+    if(with_stages)
+      stream << " " << instrumentation::column_names();
+    stream << std::endl;
+  }
   stream << stats.iter << " ";
   stream << stats.new_purify_gamma << " ";
   stream << stats.relative_gamma << " ";
@@ -94,6 +103,8 @@ void AlgorithmUpdate::print_to_stream(std::ostream &stream) {
   stream << stats.l2_norm << " ";
   stream << stats.l1_variation << " ";
   stream << stats.total_time << " ";
+  if(with_stages)
+    stream << instrumentation::columns() << " ";
   stream << std::endl;
 }
 
@@ -111,7 +122,9 @@ void AlgorithmUpdate::save_figure(const Vector<t_complex> &image,
   if(upsample_ratio != 1) {
     temp_image = utilities::re_sample_image(temp_image, upsample_ratio);
   }
-  pfitsio::write2d_header(temp_image.real(), header);
+  // the writer keeps only the latest snapshot of each file if it falls behind the solver
+  Image<t_real> snapshot = temp_image.real();
+  writer.write2d_header(std::move(snapshot), header);
 }
 
 pfitsio::header_params AlgorithmUpdate::create_header(purify::utilities::vis_params const &uv_data,
@@ -2,13 +2,13 @@
 #define ALGORITHMUPDATE_H
 
 #include "purify/config.h"
+#include <chrono>
 #include <sopt/imaging_padmm.h>
 #include <sopt/relative_variation.h>
 #include <sopt/utilities.h>
 #include <sopt/wavelets.h>
 #include <sopt/wavelets/sara.h>
 #include "cmdl.h"
-#include "purify/MeasurementOperator.h"
 #include "purify/pfitsio.h"
 #include "purify/types.h"
 #include "purify/utilities.h"
@@ -19,7 +19,7 @@ class AlgorithmUpdate {
 public:
   AlgorithmUpdate(const purify::Params &params, const utilities::vis_params &uv_data,
                   sopt::algorithm::ImagingProximalADMM<t_complex> &padmm, std::ostream &stream,
-                  const MeasurementOperator &measurements,
+                  const sopt::LinearTransform<sopt::Vector<sopt::t_complex>> &Phi,
                   const sopt::LinearTransform<sopt::Vector<sopt::t_complex>> &Psi);
 
   bool operator()(Vector<t_complex> const &x);
@@ -44,15 +44,17 @@ private:
   const utilities::vis_params &uv_data;
   std::ostream &out_diagnostic;
   sopt::algorithm::ImagingProximalADMM<t_complex> &padmm;
-  std::clock_t const c_start;
+  std::chrono::steady_clock::time_point const c_start;
   const sopt::LinearTransform<sopt::Vector<sopt::t_complex>> &Psi;
-  const MeasurementOperator &measurements;
+  const sopt::LinearTransform<sopt::Vector<sopt::t_complex>> &Phi;
+  //! Writes the diagnostic images while the solver carries on
+  pfitsio::AsyncWriter writer;
 
 private:
   //! Method to modify gamma
   void modify_gamma(Vector<t_complex> const &alpha);
-  //! method to print log to stream
-  void print_to_stream(std::ostream &stream);
+  //! method to print log to stream, with the time spent in each stage so far if with_stages
+  void print_to_stream(std::ostream &stream, bool with_stages = false);
   //! method to save images to fits files
   void save_figure(const Vector<t_complex> &image, std::string const &output_file_name,
                    std::string const &units, t_real const &upsample_ratio);
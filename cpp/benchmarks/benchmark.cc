@@ -0,0 +1,239 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+#ifdef PURIFY_OPENMP
+#include <omp.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include "purify/logging.h"
+
+namespace purify {
+namespace benchmark {
+namespace {
+//! Quotes a string for JSON
+std::string quoted(std::string const &text) {
+  std::string result = "\"";
+  for(auto const c : text) {
+    if(c == '"' or c == '\\')
+      result += '\\';
+    result += c;
+  }
+  return result + "\"";
+}
+
+std::string host_name() {
+  char name[256] = {0};
+  if(gethostname(name, sizeof(name) - 1) != 0)
+    return "unknown";
+  return name;
+}
+
+std::string utc_time() {
+  auto const now = std::time(nullptr);
+  char buffer[32];
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  return buffer;
+}
+}
+
+std::string usage(std::string const &benchmark) {
+  return benchmark + " [options]\n\n"
+                     "--imsize: width and height of the image (default 256)\n"
+                     "--nvis: number of visibilities (default as many as pixels)\n"
+                     "--kernel: gridding kernel, kb, gauss, pswf, box or kb_interp (default kb)\n"
+                     "--J: support of the kernel (default 4)\n"
+                     "--oversample: oversampling of the fourier grid (default 2)\n"
+                     "--threads: threads for openmp and fftw, or the most for scaling (default "
+                     "openmp's)\n"
+                     "--pinning: scaling with threads pinned to cpus, none, compact or both "
+                     "(default both)\n"
+                     "--repeats: timed calls of each operation (default 10)\n"
+                     "--iterations: iterations of a solver (default 10)\n"
+                     "--json: file for the results (default " + benchmark + ".json)\n";
+}
+
+Parameters parse(int argc, char const **argv) {
+  Parameters parameters;
+  for(int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if(option == "--help" or option == "-h") {
+      parameters.help = true;
+      continue;
+    }
+    if(option.compare(0, 2, "--") != 0)
+      throw std::runtime_error("Unexpected argument " + option);
+    std::string value;
+    auto const equal = option.find('=');
+    if(equal != std::string::npos) {
+      value = option.substr(equal + 1);
+      option = option.substr(0, equal);
+    } else if(i + 1 < argc)
+      value = argv[++i];
+    else
+      throw std::runtime_error("No value given for " + option);
+
+    if(option == "--imsize")
+      parameters.imsize = std::stoi(value);
+    else if(option == "--nvis")
+      parameters.nvis = std::stoi(value);
+    else if(option == "--kernel")
+      parameters.kernel = value;
+    else if(option == "--J")
+      parameters.J = std::stoi(value);
+    else if(option == "--oversample")
+      parameters.oversample = std::stod(value);
+    else if(option == "--threads")
+      parameters.threads = std::stoi(value);
+    else if(option == "--repeats")
+      parameters.repeats = std::stoi(value);
+    else if(option == "--iterations")
+      parameters.iterations = std::stoi(value);
+    else if(option == "--pinning")
+      parameters.pinning = value;
+    else if(option == "--json")
+      parameters.json = value;
+    else
+      throw std::runtime_error("Unknown option " + option);
+  }
+  if(parameters.imsize <= 0 or parameters.J <= 0 or parameters.oversample < 1
+     or parameters.repeats <= 0 or parameters.iterations < 0 or parameters.nvis < 0
+     or parameters.threads < 0
+     or (parameters.pinning != "none" and parameters.pinning != "compact"
+         and parameters.pinning != "both"))
+    throw std::runtime_error("Options out of range, see --help");
+  return parameters;
+}
+
+t_int set_threads(t_int threads) {
+#ifdef PURIFY_OPENMP
+  if(threads > 0)
+    omp_set_num_threads(threads);
+  return omp_get_max_threads();
+#else
+  if(threads > 1)
+    PURIFY_HIGH_LOG("Purify was compiled without openmp, using a single thread");
+  return 1;
+#endif
+}
+
+bool pin_threads(bool pin) {
+#if defined(__linux__) && defined(PURIFY_OPENMP)
+  // cpus the process was started with, e.g. restricted by taskset or a batch system
+  static cpu_set_t const available = []() {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    sched_getaffinity(0, sizeof(cpus), &cpus);
+    return cpus;
+  }();
+  std::vector<t_int> cpus;
+  for(t_int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    if(CPU_ISSET(cpu, &available))
+      cpus.push_back(cpu);
+  if(cpus.empty())
+    return false;
+  bool pinned = true;
+#pragma omp parallel
+  {
+    cpu_set_t cpu = available;
+    if(pin) {
+      CPU_ZERO(&cpu);
+      CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &cpu);
+    }
+    if(sched_setaffinity(0, sizeof(cpu), &cpu) != 0) {
+#pragma omp atomic write
+      pinned = false;
+    }
+  }
+  return pinned;
+#else
+  return not pin;
+#endif
+}
+
+Statistics statistics(std::vector<t_real> seconds) {
+  Statistics result;
+  result.repeats = seconds.size();
+  if(seconds.empty())
+    return result;
+  std::sort(seconds.begin(), seconds.end());
+  auto const size = seconds.size();
+  result.min = seconds.front();
+  result.max = seconds.back();
+  result.median = size % 2 == 0 ? (seconds[size / 2 - 1] + seconds[size / 2]) * 0.5
+                                : seconds[size / 2];
+  for(auto const s : seconds)
+    result.mean += s;
+  result.mean /= size;
+  for(auto const s : seconds)
+    result.standard_deviation += (s - result.mean) * (s - result.mean);
+  // sample standard deviation, zero for a single call
+  result.standard_deviation
+      = size > 1 ? std::sqrt(result.standard_deviation / (size - 1)) : 0;
+  return result;
+}
+
+void Report::write(std::ostream &stream) const {
+  stream << std::setprecision(9);
+  stream << "{\n  \"benchmark\": " << quoted(benchmark_) << ",\n";
+  stream << "  \"context\": {\"purify_version\": " << quoted(version())
+         << ", \"gitref\": " << quoted(gitref()) << ", \"host\": " << quoted(host_name())
+         << ", \"date\": " << quoted(utc_time())
+         << ", \"hardware_threads\": " << std::thread::hardware_concurrency() << "},\n";
+  stream << "  \"parameters\": {\"imsize\": " << parameters_.imsize
+         << ", \"nvis\": " << parameters_.visibilities()
+         << ", \"kernel\": " << quoted(parameters_.kernel) << ", \"J\": " << parameters_.J
+         << ", \"oversample\": " << parameters_.oversample
+         << ", \"threads\": " << set_threads(0) << ", \"repeats\": " << parameters_.repeats
+         << ", \"iterations\": " << parameters_.iterations << "},\n";
+  stream << "  \"results\": [";
+  for(auto const &result : results_) {
+    auto const &stats = result.stats;
+    stream << (&result == &results_.front() ? "\n" : ",\n") << "    {\"name\": "
+           << quoted(result.name);
+    for(auto const &label : result.labels)
+      stream << ", " << quoted(label.first) << ": " << quoted(label.second);
+    for(auto const &value : result.values)
+      stream << ", " << quoted(value.first) << ": " << value.second;
+    stream << ", \"unit\": \"seconds\", \"repeats\": " << stats.repeats
+           << ", \"min\": " << stats.min << ", \"max\": " << stats.max
+           << ", \"mean\": " << stats.mean << ", \"median\": " << stats.median
+           << ", \"standard_deviation\": " << stats.standard_deviation << "}";
+  }
+  stream << "\n  ]\n}\n";
+}
+
+void Report::write() const {
+  std::ostringstream table;
+  table << std::left << std::setw(36) << "operation" << std::right << std::setw(14) << "median(sec)"
+        << std::setw(14) << "mean(sec)" << std::setw(14) << "std(sec)" << '\n';
+  for(auto const &result : results_) {
+    auto name = result.name;
+    for(auto const &label : result.labels)
+      name += " " + label.second;
+    table << std::left << std::setw(36) << name << std::right << std::setw(14)
+          << result.stats.median << std::setw(14) << result.stats.mean << std::setw(14)
+          << result.stats.standard_deviation;
+    for(auto const &value : result.values)
+      table << "  " << value.first << " " << value.second;
+    table << '\n';
+  }
+  PURIFY_HIGH_LOG("{} benchmark:\n{}", benchmark_, table.str());
+
+  auto const file_name = parameters_.json.empty() ? benchmark_ + ".json" : parameters_.json;
+  std::ofstream file(file_name);
+  write(file);
+  if(not file)
+    throw std::runtime_error("Could not write the results to " + file_name);
+  PURIFY_HIGH_LOG("Wrote the results to {}", file_name);
+}
+}
+}
@@ -0,0 +1,113 @@
+#ifndef PURIFY_BENCHMARK_H
+#define PURIFY_BENCHMARK_H
+
+#include "purify/config.h"
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "purify/types.h"
+
+namespace purify {
+//! Shared set up, timing and reporting of the benchmarks
+namespace benchmark {
+//! Parameters shared by all benchmarks, set from the command line
+struct Parameters {
+  t_int imsize = 256;
+  //! Number of visibilities, 0 means as many as there are pixels
+  t_int nvis = 0;
+  std::string kernel = "kb";
+  t_int J = 4;
+  t_real oversample = 2;
+  //! Threads used by openmp and fftw, 0 means the openmp default, or the most for scaling runs
+  t_int threads = 0;
+  //! Scaling runs with threads pinned to cpus, none, compact or both
+  std::string pinning = "both";
+  //! Timed calls of each operation, after one untimed call
+  t_int repeats = 10;
+  //! Iterations of a solver
+  t_int iterations = 10;
+  //! File for the results, empty means the name of the benchmark with .json
+  std::string json = "";
+  bool help = false;
+
+  t_int visibilities() const { return nvis > 0 ? nvis : imsize * imsize; }
+};
+
+//! Description of the command line options
+std::string usage(std::string const &benchmark);
+//! Reads --name value or --name=value options, throws on unknown ones
+Parameters parse(int argc, char const **argv);
+//! Sets the threads of openmp, and so of fftw plans made afterwards, returns the number used
+t_int set_threads(t_int threads);
+//! \brief Pins each openmp thread to its own cpu, or with pin false lets them run anywhere again
+//! \details Threads take the cpus available to the process in order, so that neighbouring
+//! threads share a socket, and its memory, on machines that number cpus by socket. Has to be
+//! called again when the number of threads changes. Returns false where affinity cannot be set.
+bool pin_threads(bool pin);
+
+//! Statistics of the wall clock time of repeated calls
+struct Statistics {
+  t_int repeats = 0;
+  t_real min = 0;
+  t_real max = 0;
+  t_real mean = 0;
+  t_real median = 0;
+  t_real standard_deviation = 0;
+};
+//! Statistics of timings in seconds
+Statistics statistics(std::vector<t_real> seconds);
+
+//! Times repeated calls of a function, after one call to warm up caches and plans
+template <class FUNCTION> Statistics time(FUNCTION const &function, t_int repeats) {
+  function();
+  std::vector<t_real> seconds;
+  for(t_int i = 0; i < repeats; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+    function();
+    seconds.push_back(
+        std::chrono::duration<t_real>(std::chrono::steady_clock::now() - start).count());
+  }
+  return statistics(seconds);
+}
+
+//! \brief Results of a benchmark
+//! \details Written as JSON with the parameters and machine, so runs can be compared over time
+//! and across hardware.
+class Report {
+public:
+  Report(std::string const &benchmark, Parameters const &parameters)
+      : benchmark_(benchmark), parameters_(parameters){};
+
+  //! Timings of an operation, with labels such as the number of threads and derived values
+  struct Result {
+    std::string name;
+    Statistics stats;
+    std::map<std::string, std::string> labels;
+    std::map<std::string, t_real> values;
+  };
+
+  //! Adds the timings of an operation
+  void add(std::string const &name, Statistics const &stats) { add(name, stats, {}, {}); }
+  //! Adds the timings of an operation, with labels and derived values
+  void add(std::string const &name, Statistics const &stats,
+           std::map<std::string, std::string> const &labels,
+           std::map<std::string, t_real> const &values) {
+    results_.push_back(Result{name, stats, labels, values});
+  }
+  //! Writes the results as JSON
+  void write(std::ostream &stream) const;
+  //! Logs a table of the results, and writes the JSON to the file of the parameters
+  //! \details The log goes to standard output, so the JSON goes to a file.
+  void write() const;
+
+protected:
+  std::string const benchmark_;
+  Parameters const parameters_;
+  std::vector<Result> results_;
+};
+}
+}
+#endif
@@ -0,0 +1,81 @@
+#include "purify/config.h"
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include "benchmark.h"
+#include "purify/MeasurementOperator.h"
+#include "purify/instrumentation.h"
+#include "purify/logging.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+int main(int argc, char const **argv) {
+  purify::logging::initialize();
+  purify::logging::set_level("info");
+  benchmark::Parameters parameters;
+  try {
+    parameters = benchmark::parse(argc, argv);
+  } catch(std::exception const &e) {
+    std::cerr << e.what() << "\n\n" << benchmark::usage("measurement_operator");
+    return 1;
+  }
+  if(parameters.help) {
+    std::cout << "Times building the measurement operator and its parts.\n\n"
+              << benchmark::usage("measurement_operator");
+    return 0;
+  }
+  benchmark::set_threads(parameters.threads);
+  benchmark::Report report("measurement_operator", parameters);
+  t_int const imsize = parameters.imsize;
+  auto uv_data = utilities::random_sample_density(parameters.visibilities(), 0, constant::pi / 3);
+  uv_data.units = "radians";
+  auto const make_operator = [&]() {
+    return MeasurementOperator(uv_data, parameters.J, parameters.J, parameters.kernel, imsize,
+                               imsize, 20, parameters.oversample);
+  };
+
+  /*
+    Construction is timed without the untimed first call of benchmark::time, as it is done once
+    per run. The interpolation matrix, G, is its part that grows with the visibilities, and is
+    taken from the stage timers.
+  */
+  std::vector<t_real> construction;
+  std::vector<t_real> interpolation_matrix;
+  for(t_int i = 0; i < parameters.repeats; ++i) {
+    instrumentation::reset();
+    auto const start = std::chrono::steady_clock::now();
+    make_operator();
+    construction.push_back(
+        std::chrono::duration<t_real>(std::chrono::steady_clock::now() - start).count());
+    interpolation_matrix.push_back(
+        instrumentation::statistics(instrumentation::Stage::interpolation_matrix).seconds);
+  }
+  report.add("construction", benchmark::statistics(construction));
+  report.add("interpolation_matrix", benchmark::statistics(interpolation_matrix));
+
+  auto op = make_operator();
+  Image<t_complex> const image = Image<t_complex>::Random(imsize, imsize);
+  Vector<t_complex> const visibilities = Vector<t_complex>::Random(uv_data.vis.size());
+  report.add("degrid", benchmark::time([&]() { op.degrid(image); }, parameters.repeats));
+  report.add("grid", benchmark::time([&]() { op.grid(visibilities); }, parameters.repeats));
+
+  t_int const padded_size = std::floor(imsize * parameters.oversample);
+  Matrix<t_complex> const padded = Matrix<t_complex>::Random(padded_size, padded_size);
+  report.add("fft_forward",
+             benchmark::time([&]() { op.fftoperator().forward(padded); }, parameters.repeats));
+  report.add("fft_inverse",
+             benchmark::time([&]() { op.fftoperator().inverse(padded); }, parameters.repeats));
+
+  auto const scaled = op.grid_units(uv_data);
+  report.add("uniform_weighting", benchmark::time(
+                                      [&]() {
+                                        utilities::init_weights(scaled.u, scaled.v, scaled.weights,
+                                                                parameters.oversample, "uniform",
+                                                                0, op.ftsizeu(), op.ftsizev());
+                                      },
+                                      parameters.repeats));
+  report.write();
+  return 0;
+}
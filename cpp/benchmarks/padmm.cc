@@ -0,0 +1,78 @@
+#include "purify/config.h"
+#include <exception>
+#include <iostream>
+#include <sopt/imaging_padmm.h>
+#include <sopt/wavelets.h>
+#include <sopt/wavelets/sara.h>
+#include "benchmark.h"
+#include "purify/MeasurementOperator.h"
+#include "purify/logging.h"
+#include "purify/sara.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+int main(int argc, char const **argv) {
+  sopt::logging::initialize();
+  purify::logging::initialize();
+  sopt::logging::set_level("warn");
+  purify::logging::set_level("info");
+  benchmark::Parameters parameters;
+  try {
+    parameters = benchmark::parse(argc, argv);
+  } catch(std::exception const &e) {
+    std::cerr << e.what() << "\n\n" << benchmark::usage("padmm");
+    return 1;
+  }
+  if(parameters.help) {
+    std::cout << "Times a fixed number of PADMM iterations with a SARA basis of Dirac and DB4 at "
+                 "3 levels, so the image size must be a multiple of 8.\n\n"
+              << benchmark::usage("padmm");
+    return 0;
+  }
+  benchmark::set_threads(parameters.threads);
+  benchmark::Report report("padmm", parameters);
+  t_int const imsize = parameters.imsize;
+
+  auto uv_data = utilities::random_sample_density(parameters.visibilities(), 0, constant::pi / 3);
+  uv_data.units = "radians";
+  MeasurementOperator const measurements(uv_data, parameters.J, parameters.J, parameters.kernel,
+                                         imsize, imsize, 20, parameters.oversample);
+  // a few point sources, so the solver has something to do
+  Image<t_complex> sky = Image<t_complex>::Zero(imsize, imsize);
+  sky(imsize / 2, imsize / 2) = 1;
+  sky(imsize / 4, imsize / 3) = 0.5;
+  sky(2 * imsize / 3, imsize / 5) = 0.25;
+  uv_data.vis = measurements.degrid(sky);
+  t_real const sigma = utilities::SNR_to_standard_deviation(uv_data.vis, 30);
+  uv_data.vis = utilities::add_noise(uv_data.vis, 0., sigma);
+  auto const epsilon = utilities::calculate_l2_radius(uv_data.vis, sigma);
+
+  auto const Phi = linear_transform(measurements, uv_data.vis.size());
+  sopt::wavelets::SARA const sara{std::make_tuple("Dirac", 3u), std::make_tuple("DB4", 3u)};
+  auto const Psi = purify::linear_transform(sara, imsize, imsize);
+  auto const gamma = (Psi.adjoint() * (Phi.adjoint() * uv_data.vis)).real().maxCoeff() * 1e-3;
+  /*
+    Convergence is never reached, so that each call runs exactly the given number of iterations
+  */
+  auto const padmm = sopt::algorithm::ImagingProximalADMM<t_complex>(uv_data.vis)
+                         .gamma(gamma)
+                         .relative_variation(0)
+                         .l2ball_proximal_epsilon(epsilon)
+                         .tight_frame(false)
+                         .l1_proximal_tolerance(1e-2)
+                         .l1_proximal_nu(1)
+                         .l1_proximal_itermax(50)
+                         .l1_proximal_positivity_constraint(true)
+                         .l1_proximal_real_constraint(true)
+                         .residual_convergence(0)
+                         .lagrange_update_scale(0.9)
+                         .nu(1e0)
+                         .Psi(Psi)
+                         .Phi(Phi)
+                         .itermax(parameters.iterations)
+                         .is_converged([](Vector<t_complex> const &) { return false; });
+  report.add("padmm_iterations", benchmark::time([&]() { padmm(); }, parameters.repeats));
+  report.write();
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include "purify/config.h"
+#include <exception>
+#include <iostream>
+#include "benchmark.h"
+#include "purify/directories.h"
+#include "purify/logging.h"
+#include "purify/pfitsio.h"
+#include "purify/pvis.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+using namespace purify::notinstalled;
+
+int main(int argc, char const **argv) {
+  purify::logging::initialize();
+  purify::logging::set_level("info");
+  benchmark::Parameters parameters;
+  try {
+    parameters = benchmark::parse(argc, argv);
+  } catch(std::exception const &e) {
+    std::cerr << e.what() << "\n\n" << benchmark::usage("readers");
+    return 1;
+  }
+  if(parameters.help) {
+    std::cout << "Times reading visibilities and images, from files written by the benchmark.\n\n"
+              << benchmark::usage("readers");
+    return 0;
+  }
+  benchmark::set_threads(parameters.threads);
+  benchmark::Report report("readers", parameters);
+
+  auto uv_data = utilities::random_sample_density(parameters.visibilities(), 0, constant::pi / 3);
+  uv_data.vis = Vector<t_complex>::Random(uv_data.u.size());
+  uv_data.weights = Vector<t_complex>::Ones(uv_data.u.size());
+  uv_data.units = "radians";
+  std::string const text_file = output_filename("benchmark_readers.vis");
+  std::string const binary_file = output_filename("benchmark_readers.pvis");
+  std::string const fits_file = output_filename("benchmark_readers.fits");
+  utilities::write_visibility(uv_data, text_file, true);
+  pvis::write(uv_data, binary_file);
+  pfitsio::write2d(Image<t_real>::Random(parameters.imsize, parameters.imsize), fits_file);
+
+  report.add("text_visibilities",
+             benchmark::time([&]() { utilities::read_visibility(text_file, true); },
+                             parameters.repeats));
+  report.add("binary_visibilities",
+             benchmark::time([&]() { pvis::read(binary_file); }, parameters.repeats));
+  report.add("mapped_visibilities",
+             benchmark::time([&]() { pvis::MappedVisibilities const mapped(binary_file); },
+                             parameters.repeats));
+  report.add("fits_image", benchmark::time([&]() { pfitsio::read2d(fits_file); },
+                                           parameters.repeats));
+  report.write();
+  return 0;
+}
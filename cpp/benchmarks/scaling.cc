@@ -0,0 +1,126 @@
+#include "purify/config.h"
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include "benchmark.h"
+#include "purify/MeasurementOperator.h"
+#include "purify/logging.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+namespace {
+//! 1, 2, 4, ... up to and including the most threads
+std::vector<t_int> thread_counts(t_int most) {
+  std::vector<t_int> counts;
+  for(t_int threads = 1; threads < most; threads *= 2)
+    counts.push_back(threads);
+  counts.push_back(most);
+  return counts;
+}
+
+//! Medians with a single thread, per operation, for the efficiency of the other counts
+typedef std::map<std::string, t_real> Baseline;
+
+void run(benchmark::Parameters const &parameters, benchmark::Report &report, bool weak,
+         bool pinned, t_int threads, Baseline &baseline) {
+  benchmark::set_threads(threads);
+  if(not benchmark::pin_threads(pinned) and pinned)
+    PURIFY_HIGH_LOG("Could not pin threads to cpus");
+  /*
+    Weak scaling grows the visibilities, and the image area, with the threads. The operator is
+    built for each run, as fftw plans for the threads available when they are made. Its norm does
+    not matter here, so the power method stops after one iteration.
+  */
+  t_int const imsize
+      = weak ? 2 * static_cast<t_int>(std::round(parameters.imsize * std::sqrt(threads) * 0.5))
+             : parameters.imsize;
+  t_int const nvis = parameters.visibilities() * (weak ? threads : 1);
+  auto uv_data = utilities::random_sample_density(nvis, 0, constant::pi / 3);
+  uv_data.units = "radians";
+  MeasurementOperator op(uv_data, parameters.J, parameters.J, parameters.kernel, imsize, imsize, 1,
+                         parameters.oversample);
+
+  Image<t_complex> const image = Image<t_complex>::Random(imsize, imsize);
+  Vector<t_complex> const visibilities = Vector<t_complex>::Random(nvis);
+  Vector<t_complex> const ft_vector = op.image_to_ft_grid(image);
+  Matrix<t_complex> ft_grid = ft_vector;
+  ft_grid.resize(op.ftsizev(), op.ftsizeu());
+  t_int const padded_size = std::floor(imsize * parameters.oversample);
+  Matrix<t_complex> const padded = Matrix<t_complex>::Random(padded_size, padded_size);
+  Sparse<t_complex> const adjoint = op.G.adjoint();
+
+  /*
+    Besides the operator and its fft, the parts of degrid and grid are timed on their own. The
+    sparse products are parallel, while the transposition of G in grid, the resampling of the
+    fourier grid (a copy when the resampling factor is one) and the gridding correction run on a
+    single thread.
+  */
+  std::vector<std::pair<std::string, std::function<void()>>> const operations = {
+      {"degrid", [&]() { op.degrid(image); }},
+      {"grid", [&]() { op.grid(visibilities); }},
+      {"fft_forward", [&]() { op.fftoperator().forward(padded); }},
+      {"sparse_degrid", [&]() { utilities::sparse_multiply_matrix(op.G, ft_vector); }},
+      {"sparse_grid", [&]() { utilities::sparse_multiply_matrix(adjoint, visibilities); }},
+      {"adjoint_transpose", [&]() { Sparse<t_complex> const transposed = op.G.adjoint(); }},
+      {"re_sample_ft_grid",
+       [&]() { utilities::re_sample_ft_grid(ft_grid, 1. / op.resample_factor); }},
+      {"gridding_correction", [&]() { utilities::parallel_multiply_image(op.S, image); }}};
+  for(auto const &operation : operations) {
+    auto const stats = benchmark::time(operation.second, parameters.repeats);
+    if(threads == 1)
+      baseline[operation.first] = stats.median;
+    /*
+      Strong scaling efficiency is T(1) / (p T(p)), weak scaling efficiency T(1) / T(p). The serial
+      fraction is the Karp-Flatt metric (1/S - 1/p) / (1 - 1/p), with the speed up S = T(1) / T(p),
+      i.e. the fraction of the work that did not speed up with more threads.
+    */
+    std::map<std::string, t_real> values;
+    auto const speed_up = baseline[operation.first] / stats.median;
+    values["efficiency"] = weak ? speed_up : speed_up / threads;
+    if(not weak and threads > 1)
+      values["serial_fraction"] = (1. / speed_up - 1. / threads) / (1. - 1. / threads);
+    report.add(operation.first, stats,
+               {{"scaling", weak ? "weak" : "strong"},
+                {"pinning", pinned ? "compact" : "none"},
+                {"threads", std::to_string(threads)}},
+               values);
+  }
+}
+}
+
+int main(int argc, char const **argv) {
+  purify::logging::initialize();
+  purify::logging::set_level("warn");
+  benchmark::Parameters parameters;
+  try {
+    parameters = benchmark::parse(argc, argv);
+  } catch(std::exception const &e) {
+    std::cerr << e.what() << "\n\n" << benchmark::usage("scaling");
+    return 1;
+  }
+  if(parameters.help) {
+    std::cout << "Times degrid, grid, the fft and their serial parts with 1, 2, 4, ... threads, "
+                 "up to --threads, for strong and weak scaling, with and without threads pinned "
+                 "to cpus.\n\n"
+              << benchmark::usage("scaling");
+    return 0;
+  }
+  t_int const most = parameters.threads > 0 ? parameters.threads : benchmark::set_threads(0);
+  benchmark::Report report("scaling", parameters);
+  std::vector<bool> pinning;
+  if(parameters.pinning != "compact")
+    pinning.push_back(false);
+  if(parameters.pinning != "none")
+    pinning.push_back(true);
+  for(auto const weak : {false, true})
+    for(auto const pinned : pinning) {
+      Baseline baseline;
+      for(auto const threads : thread_counts(most))
+        run(parameters, report, weak, pinned, threads, baseline);
+    }
+  purify::logging::set_level("info");
+  report.write();
+  return 0;
+}
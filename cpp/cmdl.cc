@@ -31,7 +31,30 @@ std::string usage() {
          "--kernel: Type of gridding kernel to use, kb, gauss, pswf, box. (kb is default) \n\n"
          "--kernel_support: Support of kernel in grid cells. (4 is the default) \n\n"
          "--logging_level: Determines the output logging level for sopt and purify. (\"debug\" is "
-         "the default) \n\n";
+         "the default) \n\n"
+         "--bda_tolerance: Average visibilities over time and frequency on each baseline, keeping the "
+         "amplitude loss from smearing at the edge of the image below this fraction. (measurement "
+         "sets only, 0 is the default and means no averaging) \n\n"
+         "--coalesce: Merge visibilities whose uv positions agree within this fraction of an FFT grid "
+         "cell into a single weighted visibility. (0 is the default and means no merging) \n\n"
+         "--compress: Solve for the image using the weighted data gridded onto the FFT grid cells, "
+         "rather than the visibilities. The cost per iteration no longer depends on the number of "
+         "visibilities. \n\n"
+         "--image_domain: Solve for the image using the dirty image and a convolution with the "
+         "PSF, rather than the visibilities. Much cheaper per iteration for well sampled data. "
+         "Cannot be combined with --compress. \n\n"
+         "--polish: Number of iterations with the full measurement operator after an image domain "
+         "solve. (0 is the default) \n\n"
+         "--trace: Write a timeline of the operator, solver and input/output events on each thread "
+         "to this file, in the Chrome trace format for chrome://tracing or Perfetto. \n\n"
+         "--perf_counters: Count cycles, instructions and cache misses in the timed stages, and add "
+         "the instructions per cycle and memory bandwidth to the timings. Needs Linux perf events. "
+         "\n\n"
+         "--dry_run: Read the visibilities, print the memory the measurement operator will need, "
+         "and stop before building it. \n\n"
+         "--checkpoint_interval: Save the full state of the solver every this many iterations, and "
+         "carry on from it when run again with the same name. (0 is the default, no checkpoints) "
+         "\n\n";
 }
 
 Params parse_cmdl(int argc, char **argv) {
@@ -178,6 +201,52 @@ break;
       params.fftw_plan = optarg;
       break;
 
+    case '2':
+      params.bda_tolerance = std::stod(optarg);
+      if(params.bda_tolerance < 0 or params.bda_tolerance >= 1) {
+        std::printf("Wrong smearing tolerance! %f", params.bda_tolerance);
+        params.bda_tolerance = 0;
+      }
+      break;
+
+    case '3':
+      params.coalesce = std::stod(optarg);
+      if(params.coalesce < 0)
+        params.coalesce = 0;
+      break;
+
+    case '4':
+      params.compress = true;
+      break;
+
+    case '5':
+      params.image_domain = true;
+      break;
+
+    case '6':
+      params.polish_iterations = std::stoi(optarg);
+      if(params.polish_iterations < 0)
+        params.polish_iterations = 0;
+      break;
+
+    case '7':
+      params.trace_file = optarg;
+      break;
+
+    case '8':
+      params.perf_counters = true;
+      break;
+
+    case '9':
+      params.dry_run = true;
+      break;
+
+    case 'A':
+      params.checkpoint_interval = std::stoi(optarg);
+      if(params.checkpoint_interval < 0)
+        params.checkpoint_interval = 0;
+      break;
+
     case '?':
       /* getopt_long already printed an error message. */
       break;
@@ -186,6 +255,10 @@ break;
       abort();
     }
   }
+  if(params.compress and params.image_domain) {
+    std::printf("--compress and --image_domain cannot be used together.\n");
+    std::exit(1);
+  }
   return params;
 }
 };
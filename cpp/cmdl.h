@@ -57,6 +57,16 @@ struct Params {
   t_real relative_variation = 5e-3; // relative difference in model for convergence
   t_real residual_convergence = 1; // max l2 norm reisudals can have for convergence, -1 means it will choose epsilon by default
   t_real epsilon = 0;
+  // data reduction
+  t_real bda_tolerance = 0; // smearing tolerance for baseline-dependent averaging, 0 means none
+  t_real coalesce = 0; // merge visibilities closer than this fraction of an FFT cell, 0 means none
+  bool compress = false; // solve on the fourier grid cells with data instead of the visibilities
+  bool image_domain = false; // solve on the dirty image with the psf instead of the visibilities
+  t_int polish_iterations = 0; // iterations with the full operator after an image domain solve
+  std::string trace_file = ""; // timeline of events in the Chrome trace format, empty means none
+  bool perf_counters = false; // read hardware counters around the timed stages
+  bool dry_run = false; // print the memory the measurement operator will need, and stop
+  t_int checkpoint_interval = 0; // iterations between checkpoints of the solver, 0 means none
 };
 
 static struct option long_options[] = {
@@ -89,6 +99,15 @@ static struct option long_options[] = {
     {"relative_gamma_adapt", required_argument, 0, 'x'},
     {"adapt_iter", required_argument, 0, 'y'},
     {"fftw_plan", required_argument, 0, '1'},
+    {"bda_tolerance", required_argument, 0, '2'},
+    {"coalesce", required_argument, 0, '3'},
+    {"compress", no_argument, 0, '4'},
+    {"image_domain", no_argument, 0, '5'},
+    {"polish", required_argument, 0, '6'},
+    {"trace", required_argument, 0, '7'},
+    {"perf_counters", no_argument, 0, '8'},
+    {"dry_run", no_argument, 0, '9'},
+    {"checkpoint_interval", required_argument, 0, 'A'},
     {0, 0, 0, 0}};
 
 std::string usage();
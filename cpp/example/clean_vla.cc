@@ -3,6 +3,7 @@
 #include <random>
 #include "purify/MeasurementOperator.h"
 #include "purify/clean.h"
+#include "purify/convolution.h"
 #include "purify/directories.h"
 #include "purify/logging.h"
 #include "purify/pfitsio.h"
@@ -61,7 +62,10 @@ int main(int, char **) {
   std::cout << "Stokes V RMS noise of " << sigma_real * 1e3 << " mJy and " << sigma_real * 1e3
             << " mJy" << '\n';
 
-  auto psf_model = clean::fit_gaussian(measurements, uv_data);
+  // psf and restoring beam are computed once, and reused to restore the model
+  auto const psf_model
+      = clean::fit_gaussian(clean::point_spread_function(measurements, uv_data));
+  convolution::Kernel const beam(psf_model, measurements.imsizey(), measurements.imsizex(), 1e-6);
   std::string const psf_model_fits
       = output_filename(name + "_psf_model_" + weighting + "_clean.fits");
   header.pix_units = "JY/BEAM";
@@ -70,14 +74,14 @@ int main(int, char **) {
 
   auto model = clean::clean(measurements, uv_data, niters, 0.1, "hogbom");
 
-  const Image<t_complex> final_model = clean::convolve_model(model, psf_model);
+  const Image<t_complex> final_model = beam(model);
 
   std::string const model_fits = output_filename(name + "_model_" + weighting + "_clean.fits");
   header.pix_units = "JY/BEAM";
   header.fits_name = model_fits;
   pfitsio::write2d_header(model.real(), header);
 
-  auto restored_image = clean::restore(measurements, uv_data, model);
+  auto restored_image = clean::restore(measurements, uv_data, model, beam);
 
   std::string const outfile_fits = output_filename(name + "_solution_" + weighting + "_clean.fits");
 
@@ -10,6 +10,7 @@
 #include "purify/MeasurementOperator.h"
 #include "purify/directories.h"
 #include "purify/pfitsio.h"
+#include "purify/sara.h"
 #include "purify/types.h"
 #include "purify/utilities.h"
 #include "purify/logging.h"
@@ -34,8 +35,7 @@ void padmm(const std::string & name, const Image<t_complex> & M31, const std::st
       std::make_tuple("DB3", 3u),   std::make_tuple("DB4", 3u), std::make_tuple("DB5", 3u),
       std::make_tuple("DB6", 3u),   std::make_tuple("DB7", 3u), std::make_tuple("DB8", 3u)};
 
-  auto const Psi
-      = sopt::linear_transform<t_complex>(sara, measurements.imsizey(), measurements.imsizex());
+  auto const Psi = purify::linear_transform(sara, measurements.imsizey(), measurements.imsizex());
 
   Vector<> dimage = (measurements_transform.adjoint() * uv_data.vis).real();
   Vector<t_complex> initial_estimate = Vector<t_complex>::Zero(dimage.size());
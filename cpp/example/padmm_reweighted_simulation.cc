@@ -15,6 +15,7 @@
 #include "purify/directories.h"
 #include "purify/logging.h"
 #include "purify/pfitsio.h"
+#include "purify/sara.h"
 #include "purify/types.h"
 #include "purify/utilities.h"
 
@@ -69,8 +70,7 @@ int main(int nargs, char const **args) {
       std::make_tuple("DB3", 3u),   std::make_tuple("DB4", 3u), std::make_tuple("DB5", 3u),
       std::make_tuple("DB6", 3u),   std::make_tuple("DB7", 3u), std::make_tuple("DB8", 3u)};
 
-  auto const Psi
-      = sopt::linear_transform<t_complex>(sara, measurements.imsizey(), measurements.imsizex());
+  auto const Psi = purify::linear_transform(sara, measurements.imsizey(), measurements.imsizex());
 
   // working out value of sigma given SNR of 30
   t_real sigma = utilities::SNR_to_standard_deviation(uv_data.vis, ISNR);
@@ -13,6 +13,7 @@
 #include "purify/directories.h"
 #include "purify/logging.h"
 #include "purify/pfitsio.h"
+#include "purify/sara.h"
 #include "purify/types.h"
 #include "purify/utilities.h"
 
@@ -80,8 +81,7 @@ int main(int nargs, char const **args) {
   	wavelets.push_back(std::make_tuple("DB8" ,3u));
   }
   sopt::wavelets::SARA const sara(wavelets.begin(), wavelets.end());
-  auto const Psi
-      = sopt::linear_transform<t_complex>(sara, measurements.imsizey(), measurements.imsizex());
+  auto const Psi = purify::linear_transform(sara, measurements.imsizey(), measurements.imsizex());
 
   // working out value of sigma given SNR of 30
   t_real sigma = utilities::SNR_to_standard_deviation(uv_data.vis, ISNR);
@@ -1,4 +1,5 @@
-
+#include <chrono>
+#include <iostream>
 #include "purify/RMOperator.h"
 #include "purify/pfitsio.h"
 #include "purify/types.h"
@@ -37,4 +38,31 @@ int main(int nargs, char const **args) {
 
   Image<t_real> output = faraday_dispersion.array().abs();
   pfitsio::write2d(output, "rm_kb_4.fits");
+
+  // Benchmark: a polarisation cube where every line of sight shares the same frequency coverage
+  t_int const cube_size = (nargs > 1) ? std::stoi(args[1]) : 128;
+  t_int const nlines = cube_size * cube_size;
+  Matrix<t_complex> const cube_vis
+      = rm_vis.linear_polarisation * Matrix<t_complex>::Ones(1, nlines)
+        + 0.1 * Matrix<t_complex>::Random(number_of_samples, nlines);
+  auto const start_lines = std::chrono::high_resolution_clock::now();
+  Matrix<t_complex> cube(width, nlines);
+  for(t_int i = 0; i < nlines; ++i)
+    cube.col(i) = op.grid(cube_vis.col(i));
+  auto const end_lines = std::chrono::high_resolution_clock::now();
+  Matrix<t_complex> const batched_cube = op.grid_lines(cube_vis);
+  auto const end_batched = std::chrono::high_resolution_clock::now();
+  Matrix<t_complex> const batched_vis = op.degrid_lines(batched_cube);
+  auto const end_degrid = std::chrono::high_resolution_clock::now();
+
+  std::chrono::duration<t_real> const line_time = end_lines - start_lines;
+  std::chrono::duration<t_real> const batched_time = end_batched - end_lines;
+  std::chrono::duration<t_real> const degrid_time = end_degrid - end_batched;
+  std::cout << "Faraday cube of " << cube_size << " x " << cube_size << " lines of sight, "
+            << number_of_samples << " channels, " << width << " faraday depths" << std::endl;
+  std::cout << "Gridding one line at a time: " << line_time.count() << " s" << std::endl;
+  std::cout << "Batched gridding: " << batched_time.count() << " s (speed up "
+            << line_time.count() / batched_time.count() << ")" << std::endl;
+  std::cout << "Batched degridding: " << degrid_time.count() << " s" << std::endl;
+  std::cout << "Max difference: " << (cube - batched_cube).cwiseAbs().maxCoeff() << std::endl;
 }
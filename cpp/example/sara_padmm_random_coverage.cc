@@ -13,6 +13,7 @@
 #include "purify/MeasurementOperator.h"
 #include "purify/directories.h"
 #include "purify/pfitsio.h"
+#include "purify/sara.h"
 #include "purify/types.h"
 #include "purify/utilities.h"
 
@@ -55,8 +56,7 @@ int main(int, char **) {
       std::make_tuple("DB3", 3u),   std::make_tuple("DB4", 3u), std::make_tuple("DB5", 3u),
       std::make_tuple("DB6", 3u),   std::make_tuple("DB7", 3u), std::make_tuple("DB8", 3u)};
 
-  auto const Psi
-      = sopt::linear_transform<t_complex>(sara, measurements.imsizey(), measurements.imsizex());
+  auto const Psi = purify::linear_transform(sara, measurements.imsizey(), measurements.imsizex());
 
   std::mt19937_64 mersenne;
   Vector<t_complex> const y0
@@ -6,7 +6,7 @@
 #include "purify/pfitsio.h"
 #include "purify/utilities.h"
 
-#include <ctime>
+#include <chrono>
 
 using namespace purify;
 using namespace purify::notinstalled;
@@ -49,29 +49,29 @@ int main(int nargs, char const **args) {
 
     uv_data.vis
         = Vector<t_complex>::Random(number_of_vis) + I * Vector<t_complex>::Random(number_of_vis);
-    std::clock_t c_start = std::clock();
+    auto const start = std::chrono::steady_clock::now();
     for(t_int j = 0; j < inner_loop; ++j) {
       op.grid(uv_data.vis);
     }
-    std::clock_t c_end = std::clock();
-    grid_times(i) = static_cast<t_real>((c_end - c_start) / CLOCKS_PER_SEC) / inner_loop;
-    PURIFY_MEDIUM_LOG("inner: {:f20.12}", (c_end - c_start) / CLOCKS_PER_SEC / inner_loop);
+    auto const end = std::chrono::steady_clock::now();
+    grid_times(i) = std::chrono::duration<t_real>(end - start).count() / inner_loop;
+    PURIFY_MEDIUM_LOG("inner: {:f20.12}", grid_times(i));
   }
 
   for(t_int i = 0; i < number_of_tests; ++i) {
     auto uv_data = utilities::random_sample_density(number_of_vis, 0, sigma_m);
     uv_data.units = "radians";
-    MeasurementOperator op(uv_data, J, J, kernel, width, height,
+    MeasurementOperator op(uv_data, J, J, kernel, width, height, 20,
                            over_sample); // Generating gridding matrix
     Image<t_complex> im
         = Matrix<t_complex>::Random(width, height) + I * Matrix<t_complex>::Random(width, height);
-    std::clock_t c_start = std::clock();
+    auto const start = std::chrono::steady_clock::now();
     for(t_int j = 0; j < inner_loop; ++j) {
       op.degrid(im);
     }
-    std::clock_t c_end = std::clock();
-    degrid_times(i) = static_cast<t_real>((c_end - c_start) / CLOCKS_PER_SEC) / inner_loop;
-    PURIFY_MEDIUM_LOG("inner: {:f20.12}", (c_end - c_start) / CLOCKS_PER_SEC / inner_loop);
+    auto const end = std::chrono::steady_clock::now();
+    degrid_times(i) = std::chrono::duration<t_real>(end - start).count() / inner_loop;
+    PURIFY_MEDIUM_LOG("inner: {:f20.12}", degrid_times(i));
   }
   t_real const mean_grid_time = grid_times.array().mean();
   t_real const rms_grid_time = utilities::standard_deviation(grid_times);
@@ -1,7 +1,14 @@
 #include <array>
 #include <ctime>
+#include <fstream>
+#include <iostream>
+#include <future>
 #include <random>
+#include <sstream>
 #include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <tuple>
 #include <sopt/imaging_padmm.h>
 #include <sopt/positive_quadrant.h>
 #include <sopt/relative_variation.h>
@@ -13,9 +20,19 @@
 #include "AlgorithmUpdate.h"
 #include "cmdl.h"
 #include "purify/MeasurementOperator.h"
+#include "purify/PSFOperator.h"
+#include "purify/ReducedOperator.h"
+#include "purify/ResumablePADMM.h"
+#include "purify/averaging.h"
 #include "purify/casacore.h"
+#include "purify/checkpoint.h"
+#include "purify/clean.h"
+#include "purify/instrumentation.h"
 #include "purify/logging.h"
+#include "purify/memoise.h"
 #include "purify/pfitsio.h"
+#include "purify/pvis.h"
+#include "purify/sara.h"
 #include "purify/types.h"
 
 using namespace purify;
@@ -68,41 +85,6 @@ t_real estimate_noise(purify::Params const &params) {
   return std::sqrt(sigma_real * sigma_real + sigma_imag * sigma_imag); //calculation is for combined real and imaginary sigma, factor of 1/sqrt(2) in epsilon calculation
 }
 
-purify::casa::MeasurementSet::ChannelWrapper::polarization choose_pol(std::string const & stokes){
-  /*
-   Chooses the polarisation to read from a measurement set.
-   */
-  auto stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::I;
-  //stokes
-  if (stokes == "I" or stokes == "i")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::I;
-  if (stokes == "Q" or stokes == "q")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::Q;
-  if (stokes == "U" or stokes == "u")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::U;
-  if (stokes == "V" or stokes == "v")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::V;
-  //linear
-  if (stokes == "XX" or stokes == "xx")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::XX;
-  if (stokes == "YY" or stokes == "yy")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::YY;
-  if (stokes == "XY" or stokes == "xy")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::XY;
-  if (stokes == "YX" or stokes == "yx")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::YX;
-  //circular
-  if (stokes == "LL" or stokes == "ll")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::LL;
-  if (stokes == "RR" or stokes == "rr")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::RR;
-  if (stokes == "LR" or stokes == "lr")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::LR;
-  if (stokes == "RL" or stokes == "rl")
-    stokes_val = purify::casa::MeasurementSet::ChannelWrapper::polarization::RL;
-  
-  return stokes_val;
-}
 t_real save_psf_and_dirty_image(
     sopt::LinearTransform<sopt::Vector<sopt::t_complex>> const &measurements,
     purify::utilities::vis_params const &uv_data, purify::Params const &params) {
@@ -180,28 +162,137 @@ read_estimates(sopt::LinearTransform<sopt::Vector<sopt::t_complex>> const &measu
   return estimates;
 }
 
+checkpoint::SolverState read_solver_checkpoint(std::string const &file_name,
+                                               std::uint64_t const &fingerprint,
+                                               t_uint const &image_size, t_uint const &data_size) {
+  //! State saved by an earlier run, or an empty state if there is none that fits this run
+  if(not utilities::file_exists(file_name))
+    return checkpoint::SolverState();
+  try {
+    auto const state = checkpoint::read(file_name);
+    if(state.fingerprint != fingerprint)
+      PURIFY_ERROR("Ignoring {}, it was written by a run with other data or parameters", file_name);
+    else if(static_cast<t_uint>(state.x.size()) == image_size
+            and static_cast<t_uint>(state.residual.size()) == data_size) {
+      PURIFY_HIGH_LOG("Resuming from the checkpoint of iteration {} in {}", state.iteration,
+                      file_name);
+      return state;
+    } else
+      PURIFY_ERROR("Ignoring {}, its sizes do not match this run", file_name);
+  } catch(std::exception const &e) {
+    PURIFY_ERROR("Ignoring {}: {}", file_name, e.what());
+  }
+  return checkpoint::SolverState();
+}
+
+void save_original_residuals(utilities::vis_params const &original_data,
+                             std::vector<t_int> const &merged_visibilities,
+                             Vector<t_complex> const &x, Params const &params,
+                             MeasurementOperator const &measurements) {
+  //! Residuals for each visibility before merging
+  Image<t_complex> const image
+      = Image<t_complex>::Map(x.data(), measurements.imsizey(), measurements.imsizex());
+  auto residuals = original_data;
+  residuals.vis = original_data.vis
+                  - averaging::expand(measurements.degrid(image), merged_visibilities);
+  t_real const rms = std::sqrt(
+      (residuals.vis.array() * original_data.weights.array()).abs2().sum() / residuals.vis.size());
+  PURIFY_MEDIUM_LOG("RMS of whitened residuals over {} original visibilities: {}",
+                    residuals.vis.size(), rms);
+  std::string const residual_vis = params.name + "_residual_visibilities.vis";
+  PURIFY_HIGH_LOG("Saving {}", residual_vis);
+  utilities::write_visibility(residuals, residual_vis, params.use_w_term);
+}
+
+t_real image_domain_l2_radius(MeasurementOperator const &measurements, t_real const &noise_rms,
+                              PSFOperator const &psf) {
+  /*
+    The noise in the dirty image is the whitened visibility noise gridded the same way as the data.
+    Each pixel has about the variance of the centre, noise_rms^2 times the squared norm of the row
+    of the gridding operator. grid is the adjoint of degrid up to a scale, which is found from the
+    peak of the psf without weights.
+  */
+  Image<t_complex> point_source
+      = Image<t_complex>::Zero(measurements.imsizey(), measurements.imsizex());
+  point_source(measurements.imsizey() / 2, measurements.imsizex() / 2) = 1;
+  Vector<t_complex> const response = measurements.degrid(point_source);
+  t_real const psf_peak = std::abs(
+      measurements.grid(response)(measurements.imsizey() / 2, measurements.imsizex() / 2));
+  return noise_rms * std::sqrt(static_cast<t_real>(point_source.size())) * psf_peak
+         / response.norm() / psf.norm();
+}
+
+//! Logs the resident memory of the process after a phase of the run
+void log_memory(std::string const &phase) {
+  PURIFY_HIGH_LOG("Memory after {}: {:.1f} MB resident, at most {:.1f} MB so far", phase,
+                  instrumentation::resident_bytes() / 1048576.,
+                  instrumentation::peak_resident_bytes() / 1048576.);
+}
+
+MeasurementOperator configure_measurement_operator(purify::Params const &params) {
+  return MeasurementOperator()
+      .Ju(params.J)
+      .Jv(params.J)
+      .kernel_name(params.kernel)
+      .imsizex(params.width)
+      .imsizey(params.height)
+      .norm_iterations(params.power_method_iterations)
+      .oversample_factor(params.over_sample)
+      .cell_x(params.cellsizex)
+      .cell_y(params.cellsizey)
+      .weighting_type("none") // weighting is done outside of the operator
+      .R(0)
+      .use_w_term(params.use_w_term)
+      .energy_fraction(params.energy_fraction)
+      .primary_beam(params.primary_beam)
+      .fft_grid_correction(params.fft_grid_correction)
+      .fftw_plan_flag(params.fftw_plan);
+}
+
 MeasurementOperator
 construct_measurement_operator(utilities::vis_params const &uv_data, purify::Params const &params) {
-  auto measurements = MeasurementOperator()
-                          .Ju(params.J)
-                          .Jv(params.J)
-                          .kernel_name(params.kernel)
-                          .imsizex(params.width)
-                          .imsizey(params.height)
-                          .norm_iterations(params.power_method_iterations)
-                          .oversample_factor(params.over_sample)
-                          .cell_x(params.cellsizex)
-                          .cell_y(params.cellsizey)
-                          .weighting_type("none") // weighting is done outside of the operator
-                          .R(0)
-                          .use_w_term(params.use_w_term)
-                          .energy_fraction(params.energy_fraction)
-                          .primary_beam(params.primary_beam)
-                          .fft_grid_correction(params.fft_grid_correction)
-                          .fftw_plan_flag(params.fftw_plan);
+  auto measurements = configure_measurement_operator(params);
   measurements.init_operator(uv_data);
   return measurements;
 };
+
+//! Reads a measurement set while building the measurement operator from the chunks already read
+std::tuple<utilities::vis_params, MeasurementOperator>
+read_while_constructing(purify::Params const &params) {
+  /*
+    The fft plan and gridding correction do not depend on the visibilities, so they are set up
+    while the first chunk is read. Each chunk then adds to the weighting grid and to the rows of
+    the interpolation matrix while the next one is read. Same weights and operator as the serial
+    path, which needs the cell size to be known before reading.
+  */
+  auto measurements = configure_measurement_operator(params);
+  auto gridding
+      = std::async(std::launch::async, [&measurements]() { measurements.init_gridding(); });
+  bool const uses_grid = params.weighting != "none" and params.weighting != "natural";
+  Matrix<t_complex> gridded_weights;
+  if(uses_grid)
+    gridded_weights
+        = Matrix<t_complex>::Zero(static_cast<t_int>(params.over_sample * params.height),
+                                  static_cast<t_int>(params.over_sample * params.width));
+  std::vector<t_tripletList> entries;
+  auto const consumer = [&](utilities::vis_params const &chunk, t_uint first) {
+    if(gridding.valid())
+      gridding.get();
+    if(uses_grid)
+      utilities::accumulate_weights(gridded_weights, chunk.u, chunk.v, params.over_sample);
+    auto const scaled = measurements.grid_units(chunk);
+    auto const chunk_entries = measurements.interpolation_entries(scaled.u, scaled.v, first);
+    entries.insert(entries.end(), chunk_entries.begin(), chunk_entries.end());
+  };
+  auto uv_data = purify::casa::read_measurementset(params.visfile, consumer, params.stokes_val);
+  if(gridding.valid())
+    gridding.get();
+  uv_data.weights = utilities::finalize_weights(gridded_weights, uv_data.u, uv_data.v,
+                                                uv_data.weights, params.over_sample,
+                                                params.weighting, 0);
+  measurements.init_operator(Array<t_complex>::Ones(uv_data.u.size()), entries);
+  return std::make_tuple(std::move(uv_data), std::move(measurements));
+}
 }
 
 int main(int argc, char **argv) {
@@ -211,46 +302,149 @@ int main(int argc, char **argv) {
   Params params = parse_cmdl(argc, argv);
   sopt::logging::set_level(params.sopt_logging_level);
   purify::logging::set_level(params.sopt_logging_level);
-  params.stokes_val = choose_pol(params.stokes);
+  params.stokes_val = casa::polarization(params.stokes);
+  if(not params.trace_file.empty())
+    instrumentation::enable_tracing();
+  if(params.perf_counters and not instrumentation::enable_hardware_counters())
+    PURIFY_HIGH_LOG("Timings will not include hardware counts");
   //checking if reading measurement set or .vis file
   std::size_t found = params.visfile.find_last_of(".");
   std::string format =  "." + params.visfile.substr(found+1);
   std::transform(format.begin(), format.end(), format.begin(), ::tolower);
-  auto uv_data = (format == ".ms") ? purify::casa::read_measurementset(params.visfile, params.stokes_val) : utilities::read_visibility(params.visfile, params.use_w_term);
+  // a measurement set read as is can overlap reading with building the measurement operator
+  bool const overlap_reading = format == ".ms" and params.cellsizex > 0 and params.cellsizey > 0
+                               and params.bda_tolerance <= 0 and params.coalesce <= 0
+                               and not params.dry_run;
+  utilities::vis_params uv_data;
+  MeasurementOperator measurements;
+  if(overlap_reading)
+    std::tie(uv_data, measurements) = read_while_constructing(params);
+  else
+    uv_data = (format == ".ms")
+                  ? purify::casa::read_measurementset(params.visfile, params.stokes_val)
+                  : (format == ".pvis")
+                        ? pvis::read(params.visfile)
+                        : utilities::read_visibility(params.visfile, params.use_w_term);
+  log_memory(overlap_reading ? "reading visibilities and building the measurement operator"
+                             : "reading visibilities");
   bandwidth_scaling(uv_data, params);
+  if(params.bda_tolerance > 0) {
+    if(format == ".ms") {
+      auto const samples = purify::casa::read_measurementset_samples(params.visfile);
+      auto const field_of_view = averaging::field_of_view_radius(params.width, params.height,
+                                                                 params.cellsizex, params.cellsizey);
+      uv_data = averaging::baseline_dependent_averaging(uv_data, samples, params.bda_tolerance,
+                                                        field_of_view);
+    } else
+      PURIFY_HIGH_LOG("Baseline-dependent averaging needs baselines and times, skipping it for {}",
+                      params.visfile);
+  }
 
   // calculate weights outside of measurement operator
-  uv_data.weights = utilities::init_weights(
-      uv_data.u, uv_data.v, uv_data.weights, params.over_sample, params.weighting, 0,
-      params.over_sample * params.width, params.over_sample * params.height);
+  if(not overlap_reading)
+    uv_data.weights = utilities::init_weights(
+        uv_data.u, uv_data.v, uv_data.weights, params.over_sample, params.weighting, 0,
+        params.over_sample * params.width, params.over_sample * params.height);
+  // merge visibilities that fall at the same place on the FFT grid
+  utilities::vis_params original_data;
+  std::vector<t_int> merged_visibilities;
+  if(params.coalesce > 0) {
+    t_real const arcsec_to_radians = constant::pi / (180. * 3600.);
+    t_real const du
+        = 1. / (params.over_sample * params.width * params.cellsizex * arcsec_to_radians);
+    t_real const dv
+        = 1. / (params.over_sample * params.height * params.cellsizey * arcsec_to_radians);
+    original_data = uv_data;
+    std::tie(uv_data, merged_visibilities)
+        = averaging::coalesce(original_data, params.coalesce * std::min(du, dv));
+  }
+  if(not overlap_reading) {
+    // the reduced and psf operators are built on top of the measurement operator
+    auto const estimate_memory = params.compress ? &ReducedOperator::estimate_memory :
+                                                   params.image_domain ?
+                                                   &PSFOperator::estimate_memory :
+                                                   &MeasurementOperator::estimate_memory;
+    auto const estimate = estimate_memory(uv_data.vis.size(), params.J, params.J, params.width,
+                                          params.height, params.over_sample);
+    if(params.dry_run) {
+      std::cout << "Memory of the operators for " << uv_data.vis.size()
+                << " visibilities, in bytes:\n"
+                << estimate;
+      return 0;
+    }
+    PURIFY_HIGH_LOG("The operators should hold {:.1f} MB, and use at most {:.1f} MB",
+                    estimate.persistent() / 1048576., estimate.peak() / 1048576.);
+  }
   auto const noise_rms = estimate_noise(params);
-  auto const measurements = construct_measurement_operator(uv_data, params);
+  if(not overlap_reading) {
+    measurements = construct_measurement_operator(uv_data, params);
+    log_memory("building the measurement operator");
+  }
+  auto const footprint = measurements.memory_footprint();
+  PURIFY_HIGH_LOG("The measurement operator holds {:.1f} MB, and uses at most {:.1f} MB",
+                  footprint.persistent() / 1048576., footprint.peak() / 1048576.);
   params.norm = measurements.norm;
   auto const measurements_transform = linear_transform(measurements, uv_data.vis.size());
+  // the solver works on the visibilities, on the fourier grid cells with data when compressing, or
+  // on the pixels of the dirty image in the image domain
+  std::unique_ptr<ReducedOperator> reduced;
+  std::unique_ptr<PSFOperator> psf_operator;
+  auto solver_data = uv_data;
+  auto solver_transform = measurements_transform;
+  if(params.compress) {
+    reduced.reset(new ReducedOperator(measurements, uv_data, params.power_method_iterations));
+    solver_data.vis = reduced->data();
+    solver_data.weights = Vector<t_complex>::Ones(reduced->size());
+    solver_transform = linear_transform(*reduced);
+  } else if(params.image_domain) {
+    psf_operator.reset(new PSFOperator(clean::point_spread_function(measurements, uv_data),
+                                       params.height, params.width,
+                                       params.power_method_iterations));
+    Image<t_complex> const dirty
+        = measurements.grid((uv_data.vis.array() * uv_data.weights.array()).matrix());
+    solver_data.vis = Vector<t_complex>::Map(dirty.data(), dirty.size()) / psf_operator->norm();
+    solver_data.weights = Vector<t_complex>::Ones(dirty.size());
+    solver_transform = linear_transform(*psf_operator);
+  }
+  if(reduced or psf_operator) {
+    auto const solver_footprint
+        = reduced ? reduced->memory_footprint() : psf_operator->memory_footprint(footprint);
+    PURIFY_HIGH_LOG("The solver operator holds {:.1f} MB, {:.1f} MB with the measurement operator",
+                    solver_footprint.solver / 1048576., solver_footprint.persistent() / 1048576.);
+  }
+  // the convergence check applies the operator to the image the solver has just applied it to
+  solver_transform = memoised_linear_transform(solver_transform);
 
   sopt::wavelets::SARA const sara{
       std::make_tuple("Dirac", 3u), std::make_tuple("DB1", 3u), std::make_tuple("DB2", 3u),
       std::make_tuple("DB3", 3u),   std::make_tuple("DB4", 3u), std::make_tuple("DB5", 3u),
       std::make_tuple("DB6", 3u),   std::make_tuple("DB7", 3u), std::make_tuple("DB8", 3u)};
 
-  auto const Psi = sopt::linear_transform<t_complex>(sara, params.height, params.width);
+  auto const Psi = purify::linear_transform(sara, params.height, params.width);
 
   PURIFY_LOW_LOG("Saving dirty map");
   params.psf_norm = save_psf_and_dirty_image(measurements_transform, uv_data, params);
+  log_memory("the dirty image");
 
-  auto const estimates = read_estimates(measurements_transform, uv_data, params);
-  t_real const epsilon = params.n_mu * std::sqrt(2 * uv_data.vis.size()) * noise_rms / std::sqrt(2); // Calculation of l_2 bound following SARA paper
+  auto const estimates = read_estimates(solver_transform, solver_data, params);
+  // Calculation of l_2 bound following SARA paper
+  t_real const visibility_epsilon
+      = params.n_mu * std::sqrt(2 * uv_data.vis.size()) * noise_rms / std::sqrt(2);
+  t_real const epsilon
+      = reduced ? params.n_mu * reduced->l2_radius(noise_rms, 0) :
+                  psf_operator ? params.n_mu * image_domain_l2_radius(measurements, noise_rms,
+                                                                       *psf_operator) :
+                                 visibility_epsilon;
   params.epsilon = epsilon;
   params.residual_convergence
       = (params.residual_convergence < 0) ? 0. : params.residual_convergence * epsilon;
-  t_real purify_gamma = 0;
-  std::tie(params.iter, purify_gamma) = utilities::checkpoint_log(params.name + "_diagnostic");
-  if(params.iter == 0)
-    purify_gamma = (Psi.adjoint() * (measurements_transform.adjoint()
-                                     * (uv_data.weights.array() * uv_data.vis.array()).matrix()))
-                       .cwiseAbs()
-                       .maxCoeff()
-                   * params.beta;
+  t_real const initial_gamma
+      = (Psi.adjoint()
+         * (solver_transform.adjoint()
+            * (solver_data.weights.array() * solver_data.vis.array()).matrix()))
+            .cwiseAbs()
+            .maxCoeff()
+        * params.beta;
 
   std::ofstream out_diagnostic;
   out_diagnostic.precision(13);
@@ -263,26 +457,47 @@ int main(int argc, char **argv) {
   if(params.residual_convergence > 0)
     PURIFY_MEDIUM_LOG("Convergence criteria: Residual norm is less than {}.",
                       params.residual_convergence);
+  ResumablePADMM padmm(solver_data.vis);
+  padmm.gamma(initial_gamma)
+      .relative_variation(params.relative_variation)
+      .l2ball_proximal_epsilon(epsilon)
+      .l2ball_proximal_weights(solver_data.weights.array().real())
+      .tight_frame(false)
+      .l1_proximal_tolerance(1e-3)
+      .l1_proximal_nu(1)
+      .l1_proximal_itermax(100)
+      .l1_proximal_positivity_constraint(true)
+      .l1_proximal_real_constraint(true)
+      .residual_convergence(params.residual_convergence)
+      .lagrange_update_scale(0.9)
+      .nu(1e0)
+      .Psi(Psi)
+      .Phi(solver_transform);
+  /*
+    Only the unweighted solver resumes from checkpoints, reweighting restarts its outer loop. The
+    fingerprint is that of the configured solver with its initial gamma, so a checkpoint of another
+    run is not resumed, even when its sizes match.
+  */
+  std::string const checkpoint_file = params.name + "_checkpoint";
+  auto const fingerprint = padmm.fingerprint();
+  auto const resumed
+      = params.no_reweighted ?
+            read_solver_checkpoint(checkpoint_file, fingerprint, params.width * params.height,
+                                   solver_data.vis.size()) :
+            checkpoint::SolverState();
+  t_real purify_gamma = 0;
+  std::tie(params.iter, purify_gamma) = utilities::checkpoint_log(params.name + "_diagnostic");
+  if(resumed.x.size() > 0) {
+    params.iter = resumed.iteration;
+    purify_gamma = resumed.gamma;
+  }
+  if(params.iter == 0)
+    purify_gamma = initial_gamma;
   PURIFY_MEDIUM_LOG("Gamma = {}", purify_gamma);
-  auto padmm = sopt::algorithm::ImagingProximalADMM<t_complex>(uv_data.vis)
-                   .gamma(purify_gamma)
-                   .relative_variation(params.relative_variation)
-                   .l2ball_proximal_epsilon(epsilon)
-                   .l2ball_proximal_weights(uv_data.weights.array().real())
-                   .tight_frame(false)
-                   .l1_proximal_tolerance(1e-3)
-                   .l1_proximal_nu(1)
-                   .l1_proximal_itermax(100)
-                   .l1_proximal_positivity_constraint(true)
-                   .l1_proximal_real_constraint(true)
-                   .residual_convergence(params.residual_convergence)
-                   .lagrange_update_scale(0.9)
-                   .nu(1e0)
-                   .Psi(Psi)
-                   .Phi(measurements_transform);
+  padmm.gamma(purify_gamma);
 
   auto convergence_function = [](const Vector<t_complex> &x) { return true; };
-  AlgorithmUpdate algo_update(params, uv_data, padmm, out_diagnostic, measurements, Psi);
+  AlgorithmUpdate algo_update(params, solver_data, padmm, out_diagnostic, solver_transform, Psi);
   auto lambda = [&convergence_function, &algo_update](Vector<t_complex> const &x) {
     return convergence_function(x) and algo_update(x);
   };
@@ -294,26 +509,100 @@ int main(int argc, char **argv) {
   if(params.niters != 0)
     padmm.itermax(params.niters);
   if(params.no_reweighted) {
-    auto const diagnostic = padmm(estimates);
+    /*
+      The full state of the solver, dual variables included, is saved so that a run stopped part
+      way carries on exactly as if it had not been.
+    */
+    auto state = resumed.x.size() > 0 ? resumed :
+                                         padmm.initial_state(std::get<0>(estimates),
+                                                             std::get<1>(estimates));
+    state.fingerprint = fingerprint;
+    std::unique_ptr<checkpoint::Writer> writer;
+    if(params.checkpoint_interval > 0) {
+      writer.reset(new checkpoint::Writer(checkpoint_file));
+      padmm.checkpoint(
+          [&writer](checkpoint::SolverState const &state) {
+            try {
+              writer->write(state);
+            } catch(std::exception const &e) {
+              PURIFY_ERROR("Could not write checkpoint: {}", e.what());
+            }
+          },
+          params.checkpoint_interval);
+    }
+    bool const converged = padmm.solve(state);
+    try {
+      if(writer)
+        writer->flush();
+    } catch(std::exception const &e) {
+      PURIFY_ERROR("Could not write checkpoint: {}", e.what());
+    }
+    // a converged run is final, running it again starts afresh rather than resuming
+    if(converged and utilities::file_exists(checkpoint_file))
+      std::remove(checkpoint_file.c_str());
     outfile_fits = params.name + "_solution_" + params.weighting + "_final";
     residual_fits = params.name + "_residual_" + params.weighting + "_final";
-    final_model = diagnostic.x;
+    final_model = state.x;
   } else {
-    auto const posq = sopt::algorithm::positive_quadrant(padmm);
+    auto const &padmm_base = static_cast<ResumablePADMM::PADMM const &>(padmm);
+    auto const posq = sopt::algorithm::positive_quadrant(padmm_base);
     auto const min_delta = noise_rms * std::sqrt(uv_data.vis.size())
                            / std::sqrt(9 * measurements.imsizey() * measurements.imsizex());
     // Sets weight after each padmm iteration.
     // In practice, this means replacing the proximal of the l1 objective function.
     auto const reweighted
-        = sopt::algorithm::reweighted(padmm).itermax(10).min_delta(min_delta).is_converged(
+        = sopt::algorithm::reweighted(padmm_base).itermax(10).min_delta(min_delta).is_converged(
             sopt::RelativeVariation<std::complex<t_real>>(1e-3));
     auto const diagnostic = reweighted();
     outfile_fits = params.name + "_solution_" + params.weighting + "_final_reweighted";
     residual_fits = params.name + "_residual_" + params.weighting + "_final_reweighted";
     final_model = diagnostic.algo.x;
   }
+  if(psf_operator and params.polish_iterations > 0) {
+    // a few iterations on the visibilities remove the approximations of the image domain
+    PURIFY_HIGH_LOG("Polishing with {} iterations of the full measurement operator",
+                    params.polish_iterations);
+    Vector<t_complex> const residuals = (uv_data.vis - measurements_transform * final_model).array()
+                                        * uv_data.weights.array().real();
+    // gamma of the image domain problem is scaled by the psf, it is set again for the visibilities
+    t_real const polish_gamma
+        = (Psi.adjoint()
+           * (measurements_transform.adjoint()
+              * (uv_data.weights.array() * uv_data.vis.array()).matrix()))
+              .cwiseAbs()
+              .maxCoeff()
+          * params.beta;
+    PURIFY_MEDIUM_LOG("Gamma = {}", polish_gamma);
+    padmm.gamma(polish_gamma)
+        .Phi(measurements_transform)
+        .target(uv_data.vis)
+        .l2ball_proximal_epsilon(visibility_epsilon)
+        .l2ball_proximal_weights(uv_data.weights.array().real())
+        .residual_convergence(0)
+        .itermax(params.polish_iterations)
+        .is_converged(convergence_function);
+    final_model = padmm(std::make_tuple(final_model, residuals)).x;
+    params.epsilon = visibility_epsilon;
+  }
+  log_memory("solving");
   save_final_image(outfile_fits, residual_fits, final_model, uv_data, params, measurements);
+  if(not merged_visibilities.empty())
+    save_original_residuals(original_data, merged_visibilities, final_model, params, measurements);
   out_diagnostic.close();
 
+  if(params.run_diagnostic) {
+    std::ofstream timings(params.name + "_timings");
+    instrumentation::summary(timings, uv_data.vis.size());
+  }
+  std::ostringstream summary;
+  instrumentation::summary(summary, uv_data.vis.size());
+  PURIFY_HIGH_LOG("Time spent in each stage:\n{}", summary.str());
+  if(not params.trace_file.empty()) {
+    instrumentation::enable_tracing(false);
+    instrumentation::write_trace(params.trace_file);
+    PURIFY_HIGH_LOG("Recorded {} events, wrote the timeline to {}",
+                    instrumentation::traced_events(), params.trace_file);
+  }
+
   return 0;
 }
@@ -0,0 +1,130 @@
+#include "purify/config.h"
+#include "purify/DFTOperator.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include "purify/logging.h"
+
+namespace purify {
+
+namespace {
+//! Number of visibilities each thread accumulates in registers at a time
+constexpr t_int block_size = 256;
+//! Number of components used to time the direct transform
+constexpr t_int timing_components = 16;
+//! Number of timed runs of each path, the fastest is kept
+constexpr t_int timing_repeats = 5;
+
+//! Fastest of several runs in seconds, after a first run that pays for any setup
+template <class FUNCTION> t_real best_time(FUNCTION const &function) {
+  function();
+  t_real best = std::numeric_limits<t_real>::max();
+  for(t_int i = 0; i < timing_repeats; ++i) {
+    auto const start = std::chrono::steady_clock::now();
+    function();
+    best = std::min(
+        best, std::chrono::duration<t_real>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+}
+
+DFTOperator::DFTOperator(const MeasurementOperator &measurements,
+                         const utilities::vis_params &uv_vis)
+    : measurements_(measurements) {
+  /*
+    Converts the uv coordinates the same way the measurement operator does, then calibrates the
+    direct transform against it and times both paths.
+
+    measurements:: measurement operator W G F Z S / norm
+    uv_vis:: visibilities the measurement operator was built on
+  */
+  t_int const nvis = measurements.G.rows();
+  if(uv_vis.u.size() != nvis or uv_vis.v.size() != nvis)
+    throw std::runtime_error("Visibilities do not match the measurement operator.");
+  utilities::vis_params uv_pixels = uv_vis;
+  if(uv_pixels.units == "lambda")
+    uv_pixels = utilities::set_cell_size(uv_vis, measurements.cell_x(), measurements.cell_y());
+  if(uv_pixels.units == "radians")
+    uv_pixels = utilities::uv_scale(uv_pixels, measurements.ftsizeu(), measurements.ftsizev());
+  u_.resize(nvis);
+  v_.resize(nvis);
+  for(t_int k = 0; k < nvis; ++k) {
+    u_[k] = 2 * constant::pi * uv_pixels.u(k) / measurements.ftsizeu();
+    v_[k] = 2 * constant::pi * uv_pixels.v(k) / measurements.ftsizev();
+  }
+
+  Image<t_complex> point_source
+      = Image<t_complex>::Zero(measurements.imsizey(), measurements.imsizex());
+  point_source(measurements.imsizey() / 2, measurements.imsizex() / 2) = 1;
+  centre_ = measurements.degrid(point_source);
+
+  // the primary beam and w-term are not translation invariant, a phase gradient is not enough
+  if(measurements.use_w_term() or measurements.primary_beam() != "none") {
+    PURIFY_MEDIUM_LOG("Direct fourier transform disabled for this measurement operator");
+    return;
+  }
+  std::vector<point_component> components;
+  for(t_int i = 0; i < timing_components; ++i)
+    components.push_back({i % measurements.imsizey(), i % measurements.imsizex(), 1});
+  // first calls allocate and plan, so each path is warmed up and timed at its best
+  t_real const fft_time = best_time([&measurements, &point_source]() {
+    return measurements.degrid(point_source);
+  });
+  t_real const dft_time
+      = best_time([this, &components]() { return DFTOperator::degrid(components); });
+  crossover_ = std::max<t_int>(1, std::floor(fft_time / dft_time * timing_components));
+  PURIFY_MEDIUM_LOG("Direct fourier transform used for models of up to {} components", crossover_);
+}
+
+Vector<t_complex> DFTOperator::degrid(const std::vector<point_component> &components) const {
+  /*
+    A point source at (y, x) has visibilities centre * exp(-i (u dy + v dx)), where dx and dy are
+    its offsets from the centre of the image (u runs along the rows of the fourier grid). Each
+    thread accumulates the phases of all components over a block of visibilities, so the inner
+    loop is a plain vectorisable loop over u and v.
+  */
+  t_int const nvis = u_.size();
+  t_int const x_centre = measurements_.imsizex() / 2;
+  t_int const y_centre = measurements_.imsizey() / 2;
+  Vector<t_complex> visibilities(nvis);
+#pragma omp parallel for
+  for(t_int start = 0; start < nvis; start += block_size) {
+    t_int const length = std::min(block_size, nvis - start);
+    t_real const *const u = u_.data() + start;
+    t_real const *const v = v_.data() + start;
+    t_real real[block_size] = {0};
+    t_real imag[block_size] = {0};
+    for(auto const &component : components) {
+      t_real const dx = component.x - x_centre;
+      t_real const dy = component.y - y_centre;
+      t_real const flux_real = component.flux.real();
+      t_real const flux_imag = component.flux.imag();
+#pragma omp simd
+      for(t_int k = 0; k < length; ++k) {
+        t_real const phase = u[k] * dy + v[k] * dx;
+        t_real const cosine = std::cos(phase);
+        t_real const sine = std::sin(phase);
+        real[k] += flux_real * cosine + flux_imag * sine;
+        imag[k] += flux_imag * cosine - flux_real * sine;
+      }
+    }
+    for(t_int k = 0; k < length; ++k)
+      visibilities(start + k) = centre_(start + k) * t_complex(real[k], imag[k]);
+  }
+  return visibilities;
+}
+
+Vector<t_complex> DFTOperator::degrid(const Image<t_complex> &eigen_image) const {
+  std::vector<point_component> components;
+  for(t_int x = 0; x < eigen_image.cols(); ++x)
+    for(t_int y = 0; y < eigen_image.rows(); ++y) {
+      if(eigen_image(y, x) == 0.)
+        continue;
+      if(static_cast<t_int>(components.size()) >= crossover_)
+        return measurements_.degrid(eigen_image);
+      components.push_back({y, x, eigen_image(y, x)});
+    }
+  return DFTOperator::degrid(components);
+}
+}
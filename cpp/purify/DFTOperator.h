@@ -0,0 +1,48 @@
+#ifndef PURIFY_DFT_OPERATOR_H
+#define PURIFY_DFT_OPERATOR_H
+
+#include "purify/config.h"
+#include <vector>
+#include "purify/MeasurementOperator.h"
+#include "purify/types.h"
+#include "purify/utilities.h"
+
+namespace purify {
+
+//! Point component of a sparse model, at pixel (y, x) of the image
+struct point_component {
+  t_int y;
+  t_int x;
+  t_complex flux;
+};
+
+//! \brief Direct fourier transform predictor for models made of a few point components
+//! \details The response of the measurement operator to a point source at the centre of the image
+//! is computed once with the fft. Components elsewhere only add a phase gradient to it, so each
+//! component costs O(nvis) instead of an fft and a pass over the interpolation matrix. Models
+//! with more components than the crossover measured at construction go through the fft instead.
+class DFTOperator {
+public:
+  //! Builds the predictor from a measurement operator and the visibilities it was built on
+  DFTOperator(const MeasurementOperator &measurements, const utilities::vis_params &uv_vis);
+
+  //! Visibilities of a list of point components, same scaling as MeasurementOperator::degrid
+  Vector<t_complex> degrid(const std::vector<point_component> &components) const;
+  //! Visibilities of an image, using the direct transform when the image is sparse enough
+  Vector<t_complex> degrid(const Image<t_complex> &eigen_image) const;
+  //! Number of components above which the fft is faster, zero if the direct transform is unusable
+  t_int crossover() const { return crossover_; }
+  //! Measurement operator the predictor falls back on
+  MeasurementOperator const &measurements() const { return measurements_; }
+
+protected:
+  MeasurementOperator const &measurements_;
+  //! u and v in radians per pixel of image
+  std::vector<t_real> u_;
+  std::vector<t_real> v_;
+  //! Response of the measurement operator to a unit point source at the centre of the image
+  Vector<t_complex> centre_;
+  t_int crossover_ = 0;
+};
+}
+#endif
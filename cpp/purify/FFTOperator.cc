@@ -1,5 +1,6 @@
 #include "purify/config.h"
 #include "purify/FFTOperator.h"
+#include "purify/instrumentation.h"
 
 namespace purify {
 Vector<t_complex> Fft2d::fftshift_1d(const Vector<t_complex> input) {
@@ -133,16 +134,20 @@ Matrix<t_complex> Fft2d::ishift(const Matrix<t_complex> &input) {
 }
 
 Matrix<t_complex> FFTOperator::forward(const Matrix<t_complex> &input, bool only_plan) {
+  // planning is not counted as a transform
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::fft_forward, not only_plan);
   Matrix<t_complex> dest = Matrix<t_complex>::Zero(input.rows(), input.cols());
   FFTOperator::fwd2(dest, input, fftw_flag_, only_plan);
   return dest;
 }
 Matrix<t_complex> FFTOperator::inverse(const Matrix<t_complex> &input, bool only_plan) {
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::fft_inverse, not only_plan);
   Matrix<t_complex> dest = Matrix<t_complex>::Zero(input.rows(), input.cols());
   FFTOperator::inv2(dest, input, fftw_flag_, only_plan);
   return dest;
 }
 void FFTOperator::init_plan(const Matrix<t_complex> &input) {
+  instrumentation::ScopedEvent const event("fft_plan");
   Matrix<t_complex> dest = Matrix<t_complex>::Zero(input.rows(), input.cols());
   FFTOperator::forward(dest, true);
   FFTOperator::inverse(dest, true);
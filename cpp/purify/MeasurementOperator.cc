@@ -1,5 +1,7 @@
 #include "purify/config.h"
 #include "purify/MeasurementOperator.h"
+#include <iomanip>
+#include "purify/instrumentation.h"
 #include "purify/logging.h"
 
 namespace purify {
@@ -10,6 +12,38 @@ Vector<t_complex> MeasurementOperator::degrid(const Image<t_complex> &eigen_imag
     eigen_image:: input image to be degridded
     st:: gridding parameters
   */
+  // get visibilities
+  // return (G * ft_vector).array() * W/norm;
+  Vector<t_complex> const ft_vector = MeasurementOperator::image_to_ft_grid(eigen_image);
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::degrid);
+  return utilities::sparse_multiply_matrix(G, ft_vector).array() * W / norm;
+}
+
+Image<t_complex> MeasurementOperator::grid(const Vector<t_complex> &visibilities) const {
+  /*
+    An operator that degrids an image and returns a vector of visibilities.
+
+    visibilities:: input visibilities to be gridded
+    st:: gridding parameters
+  */
+  // Matrix<t_complex> ft_vector = G.adjoint() * (visibilities.array() * W).matrix()/norm;
+  Vector<t_complex> ft_vector;
+  {
+    instrumentation::ScopedTimer const timer(instrumentation::Stage::grid);
+    ft_vector
+        = utilities::sparse_multiply_matrix(G.adjoint(), (visibilities.array() * W).matrix())
+          / norm;
+  }
+  return MeasurementOperator::ft_grid_to_image(ft_vector);
+}
+
+Vector<t_complex> MeasurementOperator::image_to_ft_grid(const Image<t_complex> &eigen_image) const {
+  /*
+    Applies the gridding correction, zero pads and Fourier transforms an image. Returns the
+    oversampled fourier grid as a vector, F Z S in the operator G F Z S.
+
+    eigen_image:: input image
+  */
   Matrix<t_complex> padded_image = Matrix<t_complex>::Zero(floor(imsizey_ * oversample_factor_),
                                                            floor(imsizex_ * oversample_factor_));
   Matrix<t_complex> ft_vector(ftsizev_, ftsizeu_);
@@ -28,26 +62,22 @@ Vector<t_complex> MeasurementOperator::degrid(const Image<t_complex> &eigen_imag
   // turn into vector
   ft_vector.resize(ftsizeu_ * ftsizev_, 1); // using conservativeResize does not work, it garbles
                                             // the image. Also, it is not what we want.
-  // get visibilities
-  // return (G * ft_vector).array() * W/norm;
-  return utilities::sparse_multiply_matrix(G, ft_vector).array() * W / norm;
+  return ft_vector;
 }
 
-Image<t_complex> MeasurementOperator::grid(const Vector<t_complex> &visibilities) const {
+Image<t_complex> MeasurementOperator::ft_grid_to_image(const Vector<t_complex> &ft_vector) const {
   /*
-    An operator that degrids an image and returns a vector of visibilities.
+    Inverse Fourier transforms the oversampled fourier grid, crops and applies the gridding
+    correction, (F Z S)^H in the operator G F Z S.
 
-    visibilities:: input visibilities to be gridded
-    st:: gridding parameters
+    ft_vector:: oversampled fourier grid as a vector
   */
-  // Matrix<t_complex> ft_vector = G.adjoint() * (visibilities.array() * W).matrix()/norm;
-  Matrix<t_complex> ft_vector
-      = utilities::sparse_multiply_matrix(G.adjoint(), (visibilities.array() * W).matrix()) / norm;
-  ft_vector.resize(ftsizev_, ftsizeu_); // using conservativeResize does not work, it garbles the
-                                        // image. Also, it is not what we want.
-  ft_vector = utilities::re_sample_ft_grid(ft_vector, 1. / resample_factor);
+  Matrix<t_complex> ft_grid = ft_vector;
+  ft_grid.resize(ftsizev_, ftsizeu_); // using conservativeResize does not work, it garbles the
+                                      // image. Also, it is not what we want.
+  ft_grid = utilities::re_sample_ft_grid(ft_grid, 1. / resample_factor);
   Image<t_complex> padded_image = fftoperator_.inverse(
-      ft_vector); // the fftshift is not needed because of the phase shift in the gridding kernel
+      ft_grid); // the fftshift is not needed because of the phase shift in the gridding kernel
   t_int x_start = floor(floor(imsizex_ * oversample_factor_) * 0.5 - imsizex_ * 0.5);
   t_int y_start = floor(floor(imsizey_ * oversample_factor_) * 0.5 - imsizey_ * 0.5);
   return utilities::parallel_multiply_image(
@@ -81,6 +111,7 @@ MeasurementOperator::init_interpolation_matrix2d(const Vector<t_real> &u, const
     ftsizeu:: size of grid along u axis
     ftsizev:: size of grid along v axis
   */
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::interpolation_matrix);
 
   t_int rows = u.size();
   t_int cols = ftsizeu_ * ftsizev_;
@@ -186,6 +217,7 @@ t_real MeasurementOperator::power_method(const t_int &niters, const t_real &rela
     niters:: max number of iterations
     relative_difference:: percentage difference at which eigen value has converged
   */
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::power_method);
   t_real estimate_eigen_value = norm;
   t_real old_value = 0;
   Image<t_complex> estimate_eigen_vector = Image<t_complex>::Random(imsizey_, imsizex_);
@@ -250,8 +282,14 @@ MeasurementOperator::MeasurementOperator() {
   // Most basic constructor
 }
 
-void MeasurementOperator::init_operator(const utilities::vis_params &uv_vis_input) {
-  // construction of linear operators in measurement operator, GFZSA
+void MeasurementOperator::init_gridding() {
+  /*
+    Sets up everything that does not depend on the visibilities: the size of the fourier grid, the
+    fft plan, the gridding kernels, and the gridding correction and primary beam, S.
+
+    The kernels capture their parameters by value, so that copies of the operator are safe.
+  */
+  instrumentation::ScopedEvent const event("init_gridding");
   ftsizeu_ = floor(imsizex_ * oversample_factor_);
   ftsizev_ = floor(imsizey_ * oversample_factor_);
   PURIFY_LOW_LOG("Planning FFT operator");
@@ -263,27 +301,18 @@ void MeasurementOperator::init_operator(const utilities::vis_params &uv_vis_inpu
     fftoperator_.fftw_flag((FFTW_ESTIMATE | FFTW_PRESERVE_INPUT));
   fftoperator_.set_up_multithread();
   fftoperator_.init_plan(Matrix<t_complex>::Zero(ftsizev_, ftsizeu_));
-  utilities::vis_params uv_vis = uv_vis_input;
-  if(uv_vis.units == "lambda")
-    uv_vis = utilities::set_cell_size(uv_vis_input, cell_x_, cell_y_);
-  if(uv_vis.units == "radians")
-    uv_vis = utilities::uv_scale(uv_vis, floor(oversample_factor_ * imsizex_),
-                                 floor(oversample_factor_ * imsizey_));
 
   PURIFY_LOW_LOG("Constructing Gridding Operator: D");
   PURIFY_MEDIUM_LOG("Oversampling Factor: {}", oversample_factor_);
-
-  std::function<t_real(t_real)> kernelu;
-  std::function<t_real(t_real)> kernelv;
-  std::function<t_real(t_real)> ftkernelu;
-  std::function<t_real(t_real)> ftkernelv;
-
   PURIFY_MEDIUM_LOG("Kernel Name: {}", kernel_name_.c_str());
-  PURIFY_MEDIUM_LOG("Number of visibilities: {}", uv_vis.u.size());
   PURIFY_MEDIUM_LOG("Number of pixels: {} x {}", imsizex_, imsizey_);
   PURIFY_MEDIUM_LOG("Ju: {}", Ju_);
   PURIFY_MEDIUM_LOG("Jv: {}", Jv_);
 
+  t_int const Ju = Ju_;
+  t_int const Jv = Jv_;
+  t_real const ftsizeu = ftsizeu_;
+  t_real const ftsizev = ftsizev_;
   S = Image<t_real>::Zero(imsizey_, imsizex_);
 
   // samples for kb_interp
@@ -297,35 +326,18 @@ void MeasurementOperator::init_operator(const utilities::vis_params &uv_vis_inpu
     const t_int total_samples = sample_density * Ju_;
     auto kb_general
         = [&](t_real x) { return kernels::kaiser_bessel_general(x, Ju_, kb_interp_alpha); };
-    Vector<t_real> samples = kernels::kernel_samples(total_samples, kb_general, Ju_);
-    auto kb_interp = [&](t_real x) { return kernels::kernel_linear_interp(samples, x, Ju_); };
-    kernelu = kb_interp;
-    kernelv = kb_interp;
-    // Since kb_interp needs the pre-samples, all calculations need to be done within scope of this
-    // if statement. Otherwise massif gets a segfault.
-    // S = MeasurementOperator::MeasurementOperator::init_correction2d_fft(kernelu, kernelv, Ju_,
-    // Jv_);
-    auto ftkb = [&](t_real x) {
-      return kernels::ft_kaiser_bessel_general(x / ftsizeu_ - 0.5, Ju_, kb_interp_alpha);
+    // shared between the kernels along u and v, and with copies of the operator
+    auto const samples = std::make_shared<const Vector<t_real>>(
+        kernels::kernel_samples(total_samples, kb_general, Ju_));
+    auto kb_interp
+        = [samples, Ju](t_real x) { return kernels::kernel_linear_interp(*samples, x, Ju); };
+    kernelu_ = kb_interp;
+    kernelv_ = kb_interp;
+    auto ftkb = [Ju, ftsizeu, kb_interp_alpha](t_real x) {
+      return kernels::ft_kaiser_bessel_general(x / ftsizeu - 0.5, Ju, kb_interp_alpha);
     };
-    ftkernelu = ftkb;
-    ftkernelv = ftkb;
-    S = MeasurementOperator::init_correction2d(
-        ftkernelu, ftkernelv); // Does gridding correction using analytic formula
-    G = MeasurementOperator::init_interpolation_matrix2d(uv_vis.u, uv_vis.v, Ju_, Jv_, kernelu,
-                                                         kernelv);
-
-    PURIFY_DEBUG("Calculating weights: W");
-    W = utilities::init_weights(uv_vis.u, uv_vis.v, uv_vis.weights, oversample_factor_,
-                                weighting_type_, R_, ftsizeu_, ftsizev_);
-    PURIFY_DEBUG("Calculating the primary beam: A");
-    auto A = MeasurementOperator::init_primary_beam(primary_beam_, cell_x_, cell_y_);
-    S = S * A;
-    PURIFY_DEBUG("Doing power method: eta_{i+1}x_{i + 1} = Psi^T Psi x_i");
-    norm = std::sqrt(MeasurementOperator::power_method(norm_iterations_));
-    PURIFY_LOW_LOG("Found a norm of eta = {}", norm);
-    PURIFY_HIGH_LOG("Gridding Operator Constructed: WGFSA");
-    return;
+    ftkernelu_ = ftkb;
+    ftkernelv_ = ftkb;
   }
 
   if((kernel_name_ == "pswf") and (Ju_ != 6 or Jv_ != 6)) {
@@ -333,14 +345,12 @@ void MeasurementOperator::init_operator(const utilities::vis_params &uv_vis_inpu
     throw std::runtime_error("Incorrect input: PSWF requires a support of 6");
   }
   if(kernel_name_ == "kb") {
-    auto kbu = [&](t_real x) { return kernels::kaiser_bessel(x, Ju_); };
-    auto kbv = [&](t_real x) { return kernels::kaiser_bessel(x, Jv_); };
-    auto ftkbu = [&](t_real x) { return kernels::ft_kaiser_bessel(x / ftsizeu_ - 0.5, Ju_); };
-    auto ftkbv = [&](t_real x) { return kernels::ft_kaiser_bessel(x / ftsizev_ - 0.5, Jv_); };
-    kernelu = kbu;
-    kernelv = kbv;
-    ftkernelu = ftkbu;
-    ftkernelv = ftkbv;
+    kernelu_ = [Ju](t_real x) { return kernels::kaiser_bessel(x, Ju); };
+    kernelv_ = [Jv](t_real x) { return kernels::kaiser_bessel(x, Jv); };
+    ftkernelu_
+        = [Ju, ftsizeu](t_real x) { return kernels::ft_kaiser_bessel(x / ftsizeu - 0.5, Ju); };
+    ftkernelv_
+        = [Jv, ftsizev](t_real x) { return kernels::ft_kaiser_bessel(x / ftsizev - 0.5, Jv); };
   }
   if(kernel_name_ == "kb_min") {
     const t_real kb_interp_alpha_Ju
@@ -351,90 +361,248 @@ void MeasurementOperator::init_operator(const utilities::vis_params &uv_vis_inpu
         = constant::pi * std::sqrt(Jv_ * Jv_ / (oversample_factor_ * oversample_factor_)
                                        * (oversample_factor_ - 0.5) * (oversample_factor_ - 0.5)
                                    - 0.8);
-    auto kbu = [&](t_real x) { return kernels::kaiser_bessel_general(x, Ju_, kb_interp_alpha_Ju); };
-    auto kbv = [&](t_real x) { return kernels::kaiser_bessel_general(x, Jv_, kb_interp_alpha_Jv); };
-    auto ftkbu = [&](t_real x) {
-      return kernels::ft_kaiser_bessel_general(x / ftsizeu_ - 0.5, Ju_, kb_interp_alpha_Ju);
+    kernelu_ = [Ju, kb_interp_alpha_Ju](t_real x) {
+      return kernels::kaiser_bessel_general(x, Ju, kb_interp_alpha_Ju);
     };
-    auto ftkbv = [&](t_real x) {
-      return kernels::ft_kaiser_bessel_general(x / ftsizev_ - 0.5, Jv_, kb_interp_alpha_Jv);
+    kernelv_ = [Jv, kb_interp_alpha_Jv](t_real x) {
+      return kernels::kaiser_bessel_general(x, Jv, kb_interp_alpha_Jv);
+    };
+    ftkernelu_ = [Ju, ftsizeu, kb_interp_alpha_Ju](t_real x) {
+      return kernels::ft_kaiser_bessel_general(x / ftsizeu - 0.5, Ju, kb_interp_alpha_Ju);
+    };
+    ftkernelv_ = [Jv, ftsizev, kb_interp_alpha_Jv](t_real x) {
+      return kernels::ft_kaiser_bessel_general(x / ftsizev - 0.5, Jv, kb_interp_alpha_Jv);
     };
-    kernelu = kbu;
-    kernelv = kbv;
-    ftkernelu = ftkbu;
-    ftkernelv = ftkbv;
   }
   if(kernel_name_ == "pswf") {
-    auto pswfu = [&](t_real x) { return kernels::pswf(x, Ju_); };
-    auto pswfv = [&](t_real x) { return kernels::pswf(x, Jv_); };
-    auto ftpswfu = [&](t_real x) { return kernels::ft_pswf(x / ftsizeu_ - 0.5, Ju_); };
-    auto ftpswfv = [&](t_real x) { return kernels::ft_pswf(x / ftsizev_ - 0.5, Jv_); };
-    kernelu = pswfu;
-    kernelv = pswfv;
-    ftkernelu = ftpswfu;
-    ftkernelv = ftpswfv;
+    kernelu_ = [Ju](t_real x) { return kernels::pswf(x, Ju); };
+    kernelv_ = [Jv](t_real x) { return kernels::pswf(x, Jv); };
+    ftkernelu_ = [Ju, ftsizeu](t_real x) { return kernels::ft_pswf(x / ftsizeu - 0.5, Ju); };
+    ftkernelv_ = [Jv, ftsizev](t_real x) { return kernels::ft_pswf(x / ftsizev - 0.5, Jv); };
   }
   if(kernel_name_ == "gauss") {
-    auto gaussu = [&](t_real x) { return kernels::gaussian(x, Ju_); };
-    auto gaussv = [&](t_real x) { return kernels::gaussian(x, Jv_); };
-    auto ftgaussu = [&](t_real x) { return kernels::ft_gaussian(x / ftsizeu_ - 0.5, Ju_); };
-    auto ftgaussv = [&](t_real x) { return kernels::ft_gaussian(x / ftsizev_ - 0.5, Jv_); };
-    kernelu = gaussu;
-    kernelv = gaussv;
-    ftkernelu = ftgaussu;
-    ftkernelv = ftgaussv;
+    kernelu_ = [Ju](t_real x) { return kernels::gaussian(x, Ju); };
+    kernelv_ = [Jv](t_real x) { return kernels::gaussian(x, Jv); };
+    ftkernelu_ = [Ju, ftsizeu](t_real x) { return kernels::ft_gaussian(x / ftsizeu - 0.5, Ju); };
+    ftkernelv_ = [Jv, ftsizev](t_real x) { return kernels::ft_gaussian(x / ftsizev - 0.5, Jv); };
   }
   if(kernel_name_ == "box") {
-    auto boxu = [&](t_real x) { return kernels::pill_box(x, Ju_); };
-    auto boxv = [&](t_real x) { return kernels::pill_box(x, Jv_); };
-    auto ftboxu = [&](t_real x) { return kernels::ft_pill_box(x / ftsizeu_ - 0.5, Ju_); };
-    auto ftboxv = [&](t_real x) { return kernels::ft_pill_box(x / ftsizev_ - 0.5, Jv_); };
-    kernelu = boxu;
-    kernelv = boxv;
-    ftkernelu = ftboxu;
-    ftkernelv = ftboxv;
+    kernelu_ = [Ju](t_real x) { return kernels::pill_box(x, Ju); };
+    kernelv_ = [Jv](t_real x) { return kernels::pill_box(x, Jv); };
+    ftkernelu_ = [Ju, ftsizeu](t_real x) { return kernels::ft_pill_box(x / ftsizeu - 0.5, Ju); };
+    ftkernelv_ = [Jv, ftsizev](t_real x) { return kernels::ft_pill_box(x / ftsizev - 0.5, Jv); };
   }
   if(kernel_name_ == "gauss_alt") {
     const t_real sigma = 1; // In units of radians, Rafael uses sigma = 2 * pi / ftsizeu_. However,
                             // this should be 1 in units of pixels.
-    auto gaussu = [&](t_real x) { return kernels::gaussian_general(x, Ju_, sigma); };
-    auto gaussv = [&](t_real x) { return kernels::gaussian_general(x, Jv_, sigma); };
-    auto ftgaussu
-        = [&](t_real x) { return kernels::ft_gaussian_general(x / ftsizeu_ - 0.5, Ju_, sigma); };
-    auto ftgaussv
-        = [&](t_real x) { return kernels::ft_gaussian_general(x / ftsizev_ - 0.5, Jv_, sigma); };
-    kernelu = gaussu;
-    kernelv = gaussv;
-    ftkernelu = ftgaussu;
-    ftkernelv = ftgaussv;
+    kernelu_ = [Ju, sigma](t_real x) { return kernels::gaussian_general(x, Ju, sigma); };
+    kernelv_ = [Jv, sigma](t_real x) { return kernels::gaussian_general(x, Jv, sigma); };
+    ftkernelu_ = [Ju, ftsizeu, sigma](t_real x) {
+      return kernels::ft_gaussian_general(x / ftsizeu - 0.5, Ju, sigma);
+    };
+    ftkernelv_ = [Jv, ftsizev, sigma](t_real x) {
+      return kernels::ft_gaussian_general(x / ftsizev - 0.5, Jv, sigma);
+    };
   }
-  if(fft_grid_correction_ == true) {
-    S = MeasurementOperator::init_correction2d_fft(kernelu, kernelv, Ju_,
+  if(not kernelu_)
+    throw std::runtime_error("Unknown gridding kernel " + kernel_name_);
+  // kb_interp always uses the analytic formula
+  if(fft_grid_correction_ == true and kernel_name_ != "kb_interp") {
+    S = MeasurementOperator::init_correction2d_fft(kernelu_, kernelv_, Ju_,
                                                    Jv_); // Does gridding correction with FFT
-  }
-  if(fft_grid_correction_ == false) {
+  } else {
     S = MeasurementOperator::init_correction2d(
-        ftkernelu, ftkernelv); // Does gridding correction using analytic formula
+        ftkernelu_, ftkernelv_); // Does gridding correction using analytic formula
   }
 
-  G = MeasurementOperator::init_interpolation_matrix2d(uv_vis.u, uv_vis.v, Ju_, Jv_, kernelu,
-                                                       kernelv);
-
-  PURIFY_DEBUG("Calculating weights: W");
-  W = utilities::init_weights(uv_vis.u, uv_vis.v, uv_vis.weights, oversample_factor_,
-                              weighting_type_, R_, ftsizeu_, ftsizev_);
-
   // It makes sense to included the primary beam at the same time the gridding correction is
   // performed.
   PURIFY_DEBUG("Calculating the primary beam: A");
   auto A = MeasurementOperator::init_primary_beam(primary_beam_, cell_x_, cell_y_);
   S = S * A;
+}
+
+utilities::vis_params MeasurementOperator::grid_units(const utilities::vis_params &uv_vis) const {
+  /*
+    Converts coordinates to pixels of the fourier grid, with the same arithmetic as set_cell_size
+    and uv_scale in init_operator. Unlike set_cell_size it neither logs nor picks a cell size from
+    the data, so it can be applied to chunks of visibilities. Requires init_gridding.
+  */
+  utilities::vis_params scaled_vis = uv_vis;
+  if(uv_vis.units == "lambda") {
+    if(cell_x_ <= 0 or cell_y_ <= 0)
+      throw std::runtime_error("Visibilities in chunks need the cell size to be given.");
+    t_real const scale_factor_u = 180 * 3600 / cell_x_ / constant::pi;
+    t_real const scale_factor_v = 180 * 3600 / cell_y_ / constant::pi;
+    scaled_vis.u = uv_vis.u / scale_factor_u * 2 * constant::pi;
+    scaled_vis.v = uv_vis.v / scale_factor_v * 2 * constant::pi;
+    scaled_vis.units = "radians";
+  }
+  if(scaled_vis.units == "radians")
+    scaled_vis = utilities::uv_scale(scaled_vis, ftsizeu_, ftsizev_);
+  return scaled_vis;
+}
+
+std::vector<t_tripletList>
+MeasurementOperator::interpolation_entries(const Vector<t_real> &u, const Vector<t_real> &v,
+                                           const t_uint first_row) const {
+  /*
+    Entries of the rows first_row, first_row + 1, ... of the interpolation matrix G, for
+    visibilities in grid units. Same values as init_interpolation_matrix2d, but chunks of
+    visibilities can be done as they arrive. Requires init_gridding.
+  */
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::interpolation_matrix);
+  t_int const rows = u.size();
+  t_int const Ju = Ju_;
+  t_int const Jv = Jv_;
+  std::vector<t_tripletList> entries(static_cast<t_uint>(rows) * Ju * Jv);
+  const t_complex I(0, 1);
+#pragma omp parallel for
+  for(t_int m = 0; m < rows; ++m) {
+    t_real const k_u = std::floor(u(m) - Ju * 0.5);
+    t_real const k_v = std::floor(v(m) - Jv * 0.5);
+    t_uint entry = static_cast<t_uint>(m) * Ju * Jv;
+    for(t_int ju = 1; ju <= Ju; ++ju) {
+      for(t_int jv = 1; jv <= Jv; ++jv) {
+        t_int const q = utilities::mod(k_u + ju, ftsizeu_);
+        t_int const p = utilities::mod(k_v + jv, ftsizev_);
+        t_int const index = utilities::sub2ind(p, q, ftsizev_, ftsizeu_);
+        entries[entry++] = t_tripletList(
+            first_row + m, index,
+            std::exp(-2 * constant::pi * I * ((k_u + ju) * 0.5 + (k_v + jv) * 0.5))
+                * kernelu_(u(m) - (k_u + ju)) * kernelv_(v(m) - (k_v + jv)));
+      }
+    }
+  }
+  return entries;
+}
+
+void MeasurementOperator::init_operator(const utilities::vis_params &uv_vis_input) {
+  // construction of linear operators in measurement operator, GFZSA
+  instrumentation::ScopedEvent const event("init_operator");
+  MeasurementOperator::init_gridding();
+  utilities::vis_params uv_vis = uv_vis_input;
+  if(uv_vis.units == "lambda")
+    uv_vis = utilities::set_cell_size(uv_vis_input, cell_x_, cell_y_);
+  if(uv_vis.units == "radians")
+    uv_vis = utilities::uv_scale(uv_vis, floor(oversample_factor_ * imsizex_),
+                                 floor(oversample_factor_ * imsizey_));
+  PURIFY_MEDIUM_LOG("Number of visibilities: {}", uv_vis.u.size());
+
+  G = MeasurementOperator::init_interpolation_matrix2d(uv_vis.u, uv_vis.v, Ju_, Jv_, kernelu_,
+                                                       kernelv_);
+
+  PURIFY_DEBUG("Calculating weights: W");
+  W = utilities::init_weights(uv_vis.u, uv_vis.v, uv_vis.weights, oversample_factor_,
+                              weighting_type_, R_, ftsizeu_, ftsizev_);
+  MeasurementOperator::init_norm();
+}
+
+void MeasurementOperator::init_operator(const Array<t_complex> &weights,
+                                        const std::vector<t_tripletList> &entries) {
+  /*
+    Finishes an operator whose interpolation entries and weights were calculated chunk by chunk,
+    after init_gridding.
+
+    weights:: weights W of all visibilities, e.g. from utilities::finalize_weights
+    entries:: entries of G from interpolation_entries, for all visibilities
+  */
+  instrumentation::ScopedEvent const event("init_operator");
+  PURIFY_MEDIUM_LOG("Number of visibilities: {}", weights.size());
+  {
+    instrumentation::ScopedTimer const timer(instrumentation::Stage::interpolation_matrix);
+    G = Sparse<t_complex>(weights.size(), ftsizeu_ * ftsizev_);
+    G.setFromTriplets(entries.begin(), entries.end());
+  }
+  W = weights;
+  MeasurementOperator::init_norm();
+}
+
+std::ostream &operator<<(std::ostream &stream, MemoryFootprint const &footprint) {
+  std::pair<std::string, t_uint> const parts[]
+      = {{"interpolation_matrix", footprint.interpolation_matrix},
+         {"gridding_correction", footprint.gridding_correction},
+         {"weights", footprint.weights},
+         {"fft_grids", footprint.fft_grids},
+         {"visibilities", footprint.visibilities},
+         {"adjoint", footprint.adjoint},
+         {"construction", footprint.construction},
+         {"solver", footprint.solver},
+         {"solver_construction", footprint.solver_construction},
+         {"persistent", footprint.persistent()},
+         {"peak", footprint.peak()}};
+  for(auto const &part : parts)
+    stream << std::left << std::setw(22) << part.first << std::right << std::setw(16)
+           << part.second << std::setw(12) << std::fixed << std::setprecision(1)
+           << part.second / 1048576. << " MB\n";
+  return stream;
+}
+
+MemoryFootprint MeasurementOperator::estimate_memory(const t_uint &visibilities, const t_int &Ju,
+                                                     const t_int &Jv, const t_int &imsizex,
+                                                     const t_int &imsizey,
+                                                     const t_real &oversample_factor) {
+  /*
+    Indices of G are ints. init_interpolation_matrix2d fills a matrix with Ju * Jv entries reserved
+    per row, which is then copied into G. Eigen's sparse assignment reserves twice the larger
+    dimension and doubles the storage whenever it is full, so G is compressed and may have up to
+    twice as many entries allocated as used. Both matrices exist during the copy. grid transposes
+    G into a compressed matrix with a row per cell of the fourier grid. degrid and grid each hold
+    about four oversampled grids at once: the padded image, fftw's output, the resampled grid and
+    the grid as a vector.
+  */
+  t_uint const cells = static_cast<t_uint>(std::floor(imsizex * oversample_factor))
+                       * static_cast<t_uint>(std::floor(imsizey * oversample_factor));
+  t_uint const entries = visibilities * Ju * Jv;
+  t_uint allocated = std::min(visibilities * cells, 2 * std::max(visibilities, cells));
+  while(allocated < entries)
+    allocated = 2 * (allocated + 1);
+  t_uint const entry_bytes = sizeof(t_complex) + sizeof(t_int);
+  MemoryFootprint footprint;
+  footprint.interpolation_matrix = allocated * entry_bytes + (visibilities + 1) * sizeof(t_int);
+  footprint.gridding_correction = static_cast<t_uint>(imsizex) * imsizey * sizeof(t_real);
+  footprint.weights = visibilities * sizeof(t_complex);
+  footprint.fft_grids = 4 * cells * sizeof(t_complex);
+  footprint.visibilities = 2 * visibilities * sizeof(t_complex);
+  footprint.adjoint = entries * entry_bytes + (cells + 1) * sizeof(t_int);
+  // u, v, w, vis and weights of the scaled copy, the grid coordinates of u and v, and the matrix
+  // with reserved rows, which also counts the entries of each row
+  footprint.construction = visibilities * (5 * sizeof(t_real) + 2 * sizeof(t_complex))
+                           + entries * entry_bytes + (2 * visibilities + 1) * sizeof(t_int);
+  return footprint;
+}
+
+MemoryFootprint MeasurementOperator::memory_footprint() const {
+  t_uint const visibilities = G.rows();
+  t_uint const cells = static_cast<t_uint>(ftsizeu_) * ftsizev_;
+  MemoryFootprint footprint;
+  // an uncompressed matrix also counts the entries of each row
+  footprint.interpolation_matrix
+      = G.data().allocatedSize() * (sizeof(t_complex) + sizeof(t_int))
+        + (G.outerSize() + 1) * sizeof(t_int)
+        + (G.isCompressed() ? 0 : G.outerSize() * sizeof(t_int));
+  footprint.gridding_correction = S.size() * sizeof(t_real);
+  footprint.weights = W.size() * sizeof(t_complex);
+  footprint.fft_grids = 4 * cells * sizeof(t_complex);
+  footprint.visibilities = 2 * visibilities * sizeof(t_complex);
+  footprint.adjoint
+      = G.nonZeros() * (sizeof(t_complex) + sizeof(t_int)) + (cells + 1) * sizeof(t_int);
+  footprint.construction = visibilities * (5 * sizeof(t_real) + 2 * sizeof(t_complex))
+                           + G.nonZeros() * (sizeof(t_complex) + sizeof(t_int))
+                           + (2 * visibilities + 1) * sizeof(t_int);
+  return footprint;
+}
+
+void MeasurementOperator::init_norm() {
   PURIFY_DEBUG("Doing power method: eta_{i+1}x_{i + 1} = Psi^T Psi x_i");
-  norm = MeasurementOperator::grid(Vector<t_complex>::Constant(uv_vis.u.size(), 1.))
-             .real()
-             .maxCoeff();
-  norm *= std::sqrt(MeasurementOperator::power_method(norm_iterations_));
-  PURIFY_DEBUG("Found a norm of eta = {}", norm);
+  if(kernel_name_ == "kb_interp") {
+    norm = std::sqrt(MeasurementOperator::power_method(norm_iterations_));
+    PURIFY_LOW_LOG("Found a norm of eta = {}", norm);
+  } else {
+    norm = MeasurementOperator::grid(Vector<t_complex>::Constant(W.size(), 1.)).real().maxCoeff();
+    norm *= std::sqrt(MeasurementOperator::power_method(norm_iterations_));
+    PURIFY_DEBUG("Found a norm of eta = {}", norm);
+  }
   PURIFY_HIGH_LOG("Gridding Operator Constructed: WGFSA");
 }
 
@@ -8,11 +8,53 @@
 #include "purify/types.h"
 #include "purify/utilities.h"
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace purify {
 
+//! \brief Bytes used by the parts of a measurement operator
+//! \details G, S and W are held by the operator. The fourier grids, visibility vectors and
+//! transpose of G only exist during a call of degrid or grid, and the copy of the coordinates while
+//! G is built. When the solver works on a reduced or psf operator built from the measurement
+//! operator, the solver parts count that operator.
+struct MemoryFootprint {
+  //! Values and indices of the interpolation matrix, G, including reserved entries
+  t_uint interpolation_matrix = 0;
+  //! Gridding correction and primary beam, S
+  t_uint gridding_correction = 0;
+  //! Weights, W
+  t_uint weights = 0;
+  //! Oversampled image and fourier grids, including the input and output of fftw
+  t_uint fft_grids = 0;
+  //! Input and output visibilities of a call
+  t_uint visibilities = 0;
+  //! Transpose of G made by each call of grid
+  t_uint adjoint = 0;
+  //! Copy of the visibilities and grid coordinates, and G before it is compressed, while G is built
+  t_uint construction = 0;
+  //! Operator the solver works on instead, with its data
+  t_uint solver = 0;
+  //! Temporaries while the solver operator is built
+  t_uint solver_construction = 0;
+
+  //! Bytes held by the operators
+  t_uint persistent() const {
+    return interpolation_matrix + gridding_correction + weights + solver;
+  }
+  //! Most bytes in use at once, while an operator is built or during a call
+  t_uint peak() const {
+    t_uint const building = std::max(construction, solver_construction);
+    return persistent() + std::max(fft_grids + visibilities + adjoint, building);
+  }
+};
+//! Table of the parts of a memory footprint, in bytes and MB
+std::ostream &operator<<(std::ostream &stream, MemoryFootprint const &footprint);
+
 //! This does something
 class MeasurementOperator {
 public:
@@ -81,12 +123,25 @@ public:
 protected:
   t_int ftsizeu_;
   t_int ftsizev_;
+  //! Gridding kernels and their fourier transforms, set by init_gridding
+  std::function<t_real(t_real)> kernelu_;
+  std::function<t_real(t_real)> kernelv_;
+  std::function<t_real(t_real)> ftkernelu_;
+  std::function<t_real(t_real)> ftkernelv_;
 
 public:
   //! Degridding operator that degrids image to visibilities
   Vector<t_complex> degrid(const Image<t_complex> &eigen_image) const;
   //! Gridding operator that grids image from visibilities
   Image<t_complex> grid(const Vector<t_complex> &visibilities) const;
+  //! Gridding correction, zero padding and FFT of an image onto the oversampled fourier grid
+  Vector<t_complex> image_to_ft_grid(const Image<t_complex> &eigen_image) const;
+  //! Adjoint of image_to_ft_grid, maps the oversampled fourier grid back to an image
+  Image<t_complex> ft_grid_to_image(const Vector<t_complex> &ft_vector) const;
+  //! Size of the oversampled fourier grid along u
+  t_int ftsizeu() const { return ftsizeu_; }
+  //! Size of the oversampled fourier grid along v
+  t_int ftsizev() const { return ftsizev_; }
 
 protected:
   //! Match uv coordinates to grid
@@ -111,13 +166,36 @@ protected:
   Image<t_real>
   init_primary_beam(const std::string &primary_beam, const t_real &cell_x, const t_real &cell_y);
 
+  //! Norm of the operator, once G and W are set
+  void init_norm();
+
 public:
   //! Construct operator
   void init_operator(const utilities::vis_params &uv_vis_input);
+  //! \brief Parts of the operator that do not depend on the visibilities
+  //! \details With grid_units, interpolation_entries and init_operator(weights, entries), the
+  //! operator can be built from chunks of visibilities while they are read.
+  void init_gridding();
+  //! Coordinates in pixels of the fourier grid, needs the cell size when in units of lambda
+  utilities::vis_params grid_units(const utilities::vis_params &uv_vis) const;
+  //! Entries of G for visibilities in grid units, starting at row first_row
+  std::vector<t_tripletList> interpolation_entries(const Vector<t_real> &u,
+                                                   const Vector<t_real> &v,
+                                                   const t_uint first_row = 0) const;
+  //! Finishes the operator from the weights and interpolation entries of all visibilities
+  void init_operator(const Array<t_complex> &weights, const std::vector<t_tripletList> &entries);
 
 public:
   //! Estiamtes norm of operator
   t_real power_method(const t_int &niters, const t_real &relative_difference = 1e-9);
+  //! \brief Predicts the memory of an operator, before building it
+  //! \details Follows init_operator, where G is built with Ju * Jv entries per visibility. The w
+  //! term does not change G, it is read with the visibilities but not projected.
+  static MemoryFootprint
+  estimate_memory(const t_uint &visibilities, const t_int &Ju, const t_int &Jv,
+                  const t_int &imsizex, const t_int &imsizey, const t_real &oversample_factor);
+  //! Memory of this operator, from the sizes of its matrices
+  MemoryFootprint memory_footprint() const;
 };
 
 //! Helper function to create a linear transform from a measurement operator
@@ -1,15 +1,86 @@
 #include "purify/config.h"
 #include "purify/PSFOperator.h"
+#include "purify/convolution.h"
 #include "purify/logging.h"
+#include "purify/utilities.h"
 
 namespace purify {
 
-PSFOperator::PSFOperator(const Image<t_complex> &point_spread_function)
-    : ftsize_u(static_cast<t_int>(point_spread_function.cols())),
-      ftsize_v(static_cast<t_int>(point_spread_function.rows())) {
-  psf_fft = fftop.forward(point_spread_function).array();
-  psf_adj_fft = fftop.forward(point_spread_function.matrix().adjoint()).array();
-  norm = std::sqrt(PSFOperator::power_method(20));
+PSFOperator::PSFOperator(const Image<t_complex> &point_spread_function, const t_int &imsizey,
+                         const t_int &imsizex, const t_int &norm_iterations)
+    : imsizex_(imsizex), imsizey_(imsizey) {
+  /*
+    Pads to a size large enough for a linear convolution, with the centre of the psf moved to the
+    origin. Eigen is column major, so fftw sees the transposed image and halves the rows.
+
+    point_spread_function:: psf centred on its middle pixel, only its real part is used
+    imsizey, imsizex:: size of the images to convolve
+    norm_iterations:: max number of iterations in power method
+  */
+  t_int const psf_rows = point_spread_function.rows();
+  t_int const psf_cols = point_spread_function.cols();
+  // a smaller psf is truncated once shifted towards the edges of the image
+  if(psf_rows < 2 * imsizey or psf_cols < 2 * imsizex)
+    PURIFY_WARN("The psf ({} x {}) is smaller than twice the image ({} x {})", psf_rows, psf_cols,
+                imsizey, imsizex);
+  ftsizev_ = convolution::fast_size(imsizey + psf_rows - 1);
+  ftsizeu_ = convolution::fast_size(imsizex + psf_cols - 1);
+  padded_ = Image<t_real>::Zero(ftsizev_, ftsizeu_);
+  spectrum_ = Matrix<t_complex>::Zero(ftsizev_ / 2 + 1, ftsizeu_);
+  auto const real = padded_.data();
+  auto const complex = reinterpret_cast<fftw_complex *>(spectrum_.data());
+  forward_plan_ = t_plan(fftw_plan_dft_r2c_2d(ftsizeu_, ftsizev_, real, complex, FFTW_ESTIMATE),
+                         fftw_destroy_plan);
+  backward_plan_ = t_plan(fftw_plan_dft_c2r_2d(ftsizeu_, ftsizev_, complex, real, FFTW_ESTIMATE),
+                          fftw_destroy_plan);
+
+  t_real const imaginary = point_spread_function.imag().abs().maxCoeff();
+  if(imaginary > 1e-6 * point_spread_function.abs().maxCoeff())
+    PURIFY_MEDIUM_LOG("Ignoring the imaginary part of the psf, up to {}", imaginary);
+  t_int const y_centre = psf_rows / 2;
+  t_int const x_centre = psf_cols / 2;
+  for(t_int x = 0; x < psf_cols; ++x)
+    for(t_int y = 0; y < psf_rows; ++y)
+      padded_(static_cast<t_int>(utilities::mod(y - y_centre, ftsizev_)),
+              static_cast<t_int>(utilities::mod(x - x_centre, ftsizeu_)))
+          = point_spread_function(y, x).real();
+  fftw_execute(forward_plan_.get());
+  // fftw's backward transform is not normalised
+  psf_fft_ = spectrum_ / (static_cast<t_real>(ftsizeu_) * ftsizev_);
+
+  norm_ = std::sqrt(PSFOperator::power_method(norm_iterations));
+  PURIFY_LOW_LOG("Found a norm of {} for the psf operator", norm_);
+}
+
+MemoryFootprint PSFOperator::estimate_memory(const t_uint &visibilities, const t_int &Ju,
+                                             const t_int &Jv, const t_int &imsizex,
+                                             const t_int &imsizey,
+                                             const t_real &oversample_factor) {
+  /*
+    The psf operator holds the transform of the psf and the spectrum, each half the padded grid,
+    and the padded real image. While it is built, the measurement operator over twice the field
+    and the psf and its response over that field exist.
+  */
+  MemoryFootprint footprint = MeasurementOperator::estimate_memory(visibilities, Ju, Jv, imsizex,
+                                                                   imsizey, oversample_factor);
+  t_uint const ftsizeu = convolution::fast_size(3 * imsizex - 1);
+  t_uint const ftsizev = convolution::fast_size(3 * imsizey - 1);
+  footprint.solver
+      = 2 * (ftsizev / 2 + 1) * ftsizeu * sizeof(t_complex) + ftsizev * ftsizeu * sizeof(t_real);
+  t_uint const field = 4 * static_cast<t_uint>(imsizex) * imsizey;
+  footprint.solver_construction
+      = MeasurementOperator::estimate_memory(visibilities, Ju, Jv, 2 * imsizex, 2 * imsizey,
+                                             oversample_factor)
+            .peak()
+        + 2 * field * sizeof(t_complex);
+  return footprint;
+}
+
+MemoryFootprint PSFOperator::memory_footprint(const MemoryFootprint &measurements) const {
+  MemoryFootprint footprint = measurements;
+  footprint.solver = (psf_fft_.size() + spectrum_.size()) * sizeof(t_complex)
+                     + padded_.size() * sizeof(t_real);
+  return footprint;
 }
 
 t_real PSFOperator::power_method(const t_int &niters, const t_real &relative_difference) {
@@ -20,43 +91,75 @@ t_real PSFOperator::power_method(const t_int &niters, const t_real &relative_dif
   */
   t_real estimate_eigen_value = 1;
   t_real old_value = 0;
-  Image<t_complex> estimate_eigen_vector
-      = Image<t_complex>::Random(floor(ftsize_v * 0.5), floor(ftsize_u * 0.5));
+  Image<t_complex> estimate_eigen_vector = Image<t_complex>::Random(imsizey_, imsizex_);
   estimate_eigen_vector = estimate_eigen_vector / estimate_eigen_vector.matrix().norm();
   for(t_int i = 0; i < niters; ++i) {
     auto new_estimate_eigen_vector
         = PSFOperator::adjoint(PSFOperator::forward(estimate_eigen_vector));
     estimate_eigen_value = new_estimate_eigen_vector.matrix().norm();
     estimate_eigen_vector = new_estimate_eigen_vector / estimate_eigen_value;
+    PURIFY_DEBUG("Iteration: {}, norm = {}", i + 1, estimate_eigen_value);
     if(relative_difference > std::abs(old_value - estimate_eigen_value) / old_value)
       break;
     old_value = estimate_eigen_value;
   }
-  return old_value;
+  return estimate_eigen_value;
 }
 
-Image<t_complex> PSFOperator::forward(const Image<t_complex> &image) {
-  return PSFOperator::convolution_with_psf(image, psf_fft) / norm;
+Image<t_complex> PSFOperator::forward(const Image<t_complex> &image) const {
+  return PSFOperator::convolution_with_psf(image, false) / norm_;
 }
 
-Image<t_complex> PSFOperator::adjoint(const Image<t_complex> &image) {
-  return PSFOperator::convolution_with_psf(image, psf_adj_fft) / norm;
+Image<t_complex> PSFOperator::adjoint(const Image<t_complex> &image) const {
+  return PSFOperator::convolution_with_psf(image, true) / norm_;
 }
-Image<t_complex> PSFOperator::convolution_with_psf(const Image<t_complex> &image,
-                                                   const Image<t_complex> &ft_of_psf) {
+
+Image<t_complex>
+PSFOperator::convolution_with_psf(const Image<t_complex> &image, const bool adjoint) const {
   /*
-          Performs convolution with point spread function
+    The psf is real, so the real and imaginary parts of the image are convolved separately with
+    real transforms, each half the cost of a complex one. Parts that are zero, e.g. the imaginary
+    part of a positive model, are skipped. The adjoint multiplies by the conjugate spectrum, i.e.
+    correlates with the psf.
   */
-  const t_int imsizex = image.cols();
-  const t_int imsizey = image.rows();
-  const t_int x_start = floor(ftsize_u * 0.5 - imsizex * 0.5);
-  const t_int y_start = floor(ftsize_v * 0.5 - imsizey * 0.5);
-  Image<t_complex> padded_image = Matrix<t_complex>::Zero(ftsize_v, ftsize_u);
-  // Zero pad image to be the same size as PSF
-  padded_image.block(y_start, x_start, imsizey, imsizex) = image;
-
-  return fftop.inverse(fftop.forward(padded_image).array() * ft_of_psf)
-      .array()
-      .block(y_start, x_start, imsizey, imsizex);
+  if(image.rows() != imsizey_ or image.cols() != imsizex_)
+    throw std::runtime_error("Image does not match the size of the psf operator.");
+  Image<t_complex> output = Image<t_complex>::Zero(imsizey_, imsizex_);
+  for(t_int part = 0; part < 2; ++part) {
+    Image<t_real> const values = part == 0 ? Image<t_real>(image.real()) : image.imag();
+    if(values.matrix().isZero(0))
+      continue;
+    padded_.setZero();
+    padded_.topLeftCorner(imsizey_, imsizex_) = values;
+    fftw_execute(forward_plan_.get());
+    if(adjoint)
+      spectrum_.array() *= psf_fft_.array().conjugate();
+    else
+      spectrum_.array() *= psf_fft_.array();
+    fftw_execute(backward_plan_.get());
+    if(part == 0)
+      output.real() = padded_.topLeftCorner(imsizey_, imsizex_);
+    else
+      output.imag() = padded_.topLeftCorner(imsizey_, imsizex_);
+  }
+  return output;
+}
+
+sopt::LinearTransform<sopt::Vector<sopt::t_complex>> linear_transform(PSFOperator const &psf) {
+  auto const height = psf.imsizey();
+  auto const width = psf.imsizex();
+  auto direct = [&psf, width, height](Vector<t_complex> &out, Vector<t_complex> const &x) {
+    assert(x.size() == width * height);
+    auto const image = Image<t_complex>::Map(x.data(), height, width);
+    out = Vector<t_complex>::Map(psf.forward(image).data(), width * height);
+  };
+  auto adjoint = [&psf, width, height](Vector<t_complex> &out, Vector<t_complex> const &x) {
+    assert(x.size() == width * height);
+    auto const image = Image<t_complex>::Map(x.data(), height, width);
+    out = Vector<t_complex>::Map(psf.adjoint(image).data(), width * height);
+  };
+  return sopt::linear_transform<Vector<t_complex>>(
+      direct, {{0, 1, static_cast<t_int>(width * height)}}, adjoint,
+      {{0, 1, static_cast<t_int>(width * height)}});
 }
 }
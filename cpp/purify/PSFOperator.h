@@ -2,39 +2,73 @@
 #define PURIFY_PSF_OPERATOR_H
 
 #include "purify/config.h"
-#include "purify/FFTOperator.h"
-#include "purify/kernels.h"
+#include <memory>
+#include <type_traits>
+#include <fftw3.h>
+#include <sopt/linear_transform.h>
+#include "purify/MeasurementOperator.h"
 #include "purify/types.h"
-#include "purify/utilities.h"
-
-#include <iostream>
-#include <string>
 
 namespace purify {
 
-//! This does something
+//! \brief Convolution with a point spread function, as a measurement operator on images
+//! \details The dirty image of well sampled data is the sky convolved with the psf, so solving on
+//! the dirty image is much cheaper per iteration than going through the visibilities. The psf is
+//! taken to be real and centred on its middle pixel, and should be twice the size of the image, as
+//! from clean::point_spread_function. The convolution is linear and cropped to the image, and uses
+//! real to complex transforms on buffers allocated once.
 class PSFOperator {
 public:
-  PSFOperator(const Image<t_complex> &point_spread_function);
+  //! Prepares the convolution of imsizey x imsizex images with the psf
+  PSFOperator(const Image<t_complex> &point_spread_function, const t_int &imsizey,
+              const t_int &imsizex, const t_int &norm_iterations = 20);
+  //! The fftw plans point to the buffers of this instance
+  PSFOperator(const PSFOperator &) = delete;
+  PSFOperator &operator=(const PSFOperator &) = delete;
 
   //! forward convolution with psf
-  Image<t_complex> forward(const Image<t_complex> &image);
+  Image<t_complex> forward(const Image<t_complex> &image) const;
   //! backward convolution with psf
-  Image<t_complex> adjoint(const Image<t_complex> &image);
+  Image<t_complex> adjoint(const Image<t_complex> &image) const;
+  //! Norm of the convolution, removed from forward and adjoint
+  t_real norm() const { return norm_; }
+  t_int imsizex() const { return imsizex_; }
+  t_int imsizey() const { return imsizey_; }
+
+  //! \brief Predicts the memory of a psf operator and of the measurement operator its psf comes
+  //! from, before building them
+  //! \details The psf is the response of a measurement operator over twice the field, built and
+  //! released while the psf operator is constructed.
+  static MemoryFootprint
+  estimate_memory(const t_uint &visibilities, const t_int &Ju, const t_int &Jv,
+                  const t_int &imsizex, const t_int &imsizey, const t_real &oversample_factor);
+  //! Memory of this operator added to the footprint of the measurement operator of its psf
+  MemoryFootprint memory_footprint(const MemoryFootprint &measurements) const;
 
 protected:
-  const t_int ftsize_u;
-  const t_int ftsize_v;
-  Image<t_complex> psf_fft;
-  Image<t_complex> psf_adj_fft;
-  FFTOperator fftop;
-  t_real norm;
-  //! Convolution operator
-  Image<t_complex>
-  convolution_with_psf(const Image<t_complex> &image, const Image<t_complex> &psf_fft);
+  typedef std::shared_ptr<std::remove_pointer<fftw_plan>::type> t_plan;
+  t_int const imsizex_;
+  t_int const imsizey_;
+  //! Size of the zero padded transforms
+  t_int ftsizeu_;
+  t_int ftsizev_;
+  //! Transform of the psf shifted onto the origin, half the fourier plane
+  Matrix<t_complex> psf_fft_;
+  //! Padded image and half spectrum, reused by each convolution
+  mutable Image<t_real> padded_;
+  mutable Matrix<t_complex> spectrum_;
+  t_plan forward_plan_;
+  t_plan backward_plan_;
+  t_real norm_ = 1;
+
+  //! Convolution of an image with the psf, or correlation for the adjoint
+  Image<t_complex> convolution_with_psf(const Image<t_complex> &image, const bool adjoint) const;
   //! power method
   t_real power_method(const t_int &niters, const t_real &relative_difference = 1e-9);
 };
+
+//! Helper function to create a linear transform from a psf operator
+sopt::LinearTransform<sopt::Vector<sopt::t_complex>> linear_transform(PSFOperator const &psf);
 }
 
 #endif
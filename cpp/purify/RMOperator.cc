@@ -3,38 +3,126 @@
 #include "purify/logging.h"
 
 namespace purify {
-Vector<t_complex> RMOperator::degrid(const Vector<t_complex> &eigen_image) {
+Vector<t_complex> RMOperator::degrid(const Vector<t_complex> &eigen_image) const {
   /*
     An operator that degrids a 1d image and returns a vector of visibilities.
 
     eigen_image:: input image to be degridded
-    st:: gridding parameters
   */
-  Vector<t_complex> padded_image = Vector<t_complex>::Zero(ftsize);
-  Vector<t_complex> ft_vector(ftsize);
-  const t_int x_start = floor(ftsize * 0.5 - imsize * 0.5);
+  return RMOperator::degrid_lines(eigen_image);
+}
 
-  // zero padding and gridding correction
-  padded_image.segment(x_start, imsize) = S * eigen_image.array();
+Vector<t_complex> RMOperator::grid(const Vector<t_complex> &visibilities) const {
+  /*
+    An operator that grids visibilities and returns a 1d image.
 
-  fft.fwd(ft_vector, padded_image);
-  return (G * ft_vector).array() * W / norm;
+    visibilities:: input visibilities to be gridded
+  */
+  return RMOperator::grid_lines(visibilities);
 }
 
-Vector<t_complex> RMOperator::grid(const Vector<t_complex> &visibilities) {
+Matrix<t_complex> RMOperator::degrid_lines(const Matrix<t_complex> &lines) const {
   /*
-    An operator that degrids an image and returns a vector of visibilities.
+    Degrids lines of sight that share the same frequency coverage. Lines are processed in blocks
+    in parallel. Each block is zero padded, transformed with a single batched FFTW plan and
+    interpolated with one sparse-dense matrix product.
 
-    visibilities:: input visibilities to be gridded
-    st:: gridding parameters
+    lines:: faraday depth profiles, one line of sight per column
   */
-  Vector<t_complex> ft_vector = G.adjoint() * (visibilities.array() * W).matrix();
-  Vector<t_complex> padded_image;
-  fft.inv(
-      padded_image,
-      ft_vector); // the fftshift is not needed because of the phase shift in the gridding kernel
-  t_int x_start = floor(ftsize * 0.5 - imsize * 0.5);
-  return S * padded_image.segment(x_start, imsize).array() / norm;
+  if(lines.rows() != imsize)
+    throw std::runtime_error("Lines of sight do not match the size of the RM operator.");
+  t_int const nlines = lines.cols();
+  Matrix<t_complex> output(G.rows(), nlines);
+  if(nlines == 0)
+    return output;
+  t_int const block = std::max(1, std::min(lines_per_block, nlines));
+  t_int const nblocks = (nlines + block - 1) / block;
+  // plans are retrieved before the parallel region, executing them from many threads is safe
+  fftw_plan const full_plan = RMOperator::fft_plans(block).first.get();
+  fftw_plan const last_plan = RMOperator::fft_plans(nlines - (nblocks - 1) * block).first.get();
+  t_int const x_start = floor(ftsize * 0.5 - imsize * 0.5);
+  Array<t_complex> const S_complex = S.cast<t_complex>();
+
+#pragma omp parallel for schedule(dynamic)
+  for(t_int b = 0; b < nblocks; ++b) {
+    t_int const start = b * block;
+    t_int const n = std::min(block, nlines - start);
+    // zero padding and gridding correction
+    Matrix<t_complex> padded_image = Matrix<t_complex>::Zero(ftsize, n);
+    padded_image.middleRows(x_start, imsize)
+        = lines.middleCols(start, n).array().colwise() * S_complex;
+    Matrix<t_complex> ft_grid(ftsize, n);
+    fftw_execute_dft(n == block ? full_plan : last_plan,
+                     reinterpret_cast<fftw_complex *>(padded_image.data()),
+                     reinterpret_cast<fftw_complex *>(ft_grid.data()));
+    Matrix<t_complex> const visibilities = G * ft_grid;
+    output.middleCols(start, n) = (visibilities.array().colwise() * W).matrix() / norm;
+  }
+  return output;
+}
+
+Matrix<t_complex> RMOperator::grid_lines(const Matrix<t_complex> &visibilities) const {
+  /*
+    Adjoint of degrid_lines, up to the normalisation of the inverse fft.
+
+    visibilities:: visibilities, one line of sight per column
+  */
+  if(visibilities.rows() != G.rows())
+    throw std::runtime_error("Visibilities do not match the size of the RM operator.");
+  t_int const nlines = visibilities.cols();
+  Matrix<t_complex> output(imsize, nlines);
+  if(nlines == 0)
+    return output;
+  t_int const block = std::max(1, std::min(lines_per_block, nlines));
+  t_int const nblocks = (nlines + block - 1) / block;
+  fftw_plan const full_plan = RMOperator::fft_plans(block).second.get();
+  fftw_plan const last_plan = RMOperator::fft_plans(nlines - (nblocks - 1) * block).second.get();
+  t_int const x_start = floor(ftsize * 0.5 - imsize * 0.5);
+  Array<t_complex> const S_complex = S.cast<t_complex>() / static_cast<t_real>(ftsize);
+  Sparse<t_complex> const G_adjoint = G.adjoint();
+
+#pragma omp parallel for schedule(dynamic)
+  for(t_int b = 0; b < nblocks; ++b) {
+    t_int const start = b * block;
+    t_int const n = std::min(block, nlines - start);
+    Matrix<t_complex> const weighted
+        = (visibilities.middleCols(start, n).array().colwise() * W).matrix();
+    Matrix<t_complex> ft_grid = G_adjoint * weighted;
+    Matrix<t_complex> padded_image(ftsize, n);
+    // the fftshift is not needed because of the phase shift in the gridding kernel
+    fftw_execute_dft(n == block ? full_plan : last_plan,
+                     reinterpret_cast<fftw_complex *>(ft_grid.data()),
+                     reinterpret_cast<fftw_complex *>(padded_image.data()));
+    output.middleCols(start, n)
+        = (padded_image.middleRows(x_start, imsize).array().colwise() * S_complex).matrix() / norm;
+  }
+  return output;
+}
+
+std::pair<RMOperator::t_plan, RMOperator::t_plan> const &
+RMOperator::fft_plans(const t_int &nlines) const {
+  /*
+    Plans one dimensional ffts over nlines contiguous columns. The plans are unaligned so that they
+    can be executed on any buffer of the same shape. Planning is serialised, since both the cache
+    and the FFTW planner are shared between threads.
+  */
+  std::lock_guard<std::mutex> lock(plans_mutex_);
+  auto const found = plans_.find(nlines);
+  if(found != plans_.end())
+    return found->second;
+  Matrix<t_complex> input = Matrix<t_complex>::Zero(ftsize, nlines);
+  Matrix<t_complex> output(ftsize, nlines);
+  auto const in = reinterpret_cast<fftw_complex *>(input.data());
+  auto const out = reinterpret_cast<fftw_complex *>(output.data());
+  int const n[] = {ftsize};
+  unsigned const flags = FFTW_ESTIMATE | FFTW_UNALIGNED;
+  t_plan const forward(fftw_plan_many_dft(1, n, nlines, in, nullptr, 1, ftsize, out, nullptr, 1,
+                                          ftsize, FFTW_FORWARD, flags),
+                       fftw_destroy_plan);
+  t_plan const backward(fftw_plan_many_dft(1, n, nlines, in, nullptr, 1, ftsize, out, nullptr, 1,
+                                           ftsize, FFTW_BACKWARD, flags),
+                        fftw_destroy_plan);
+  return plans_.emplace(nlines, std::make_pair(forward, backward)).first->second;
 }
 
 Vector<t_real> RMOperator::omega_to_k(const Vector<t_real> &omega) {
@@ -107,6 +195,7 @@ RMOperator::init_correction1d_fft(const std::function<t_real(t_real)> kernelu, c
     K(n) = kernelu(i - Ju / 2) * std::exp(-2 * constant::pi * I * (i - Ju / 2.) * 0.5);
   }
   t_int x_start = floor(ftsize * 0.5 - imsize * 0.5);
+  Eigen::FFT<t_real> fft;
   Array<t_real> S = fft.inv(K).real().segment(x_start, imsize); // probably really slow!
   return 1 / S;
 }
@@ -146,21 +235,28 @@ Array<t_complex> RMOperator::init_weights(const Vector<t_real> &u, const Vector<
   return out_weights.array();
 }
 
-t_real RMOperator::power_method(const t_int niters) {
+t_real RMOperator::power_method(const t_int niters, const t_real &relative_difference) {
   /*
    attempt at coding the power method, returns the largest eigen value of a linear operator
+    niters:: max number of iterations
+    relative_difference:: percentage difference at which eigen value has converged
   */
   t_real estimate_eigen_value = 1;
+  t_real old_value = 0;
   Vector<t_complex> estimate_eigen_vector = Vector<t_complex>::Random(imsize);
   for(t_int i = 0; i < niters; ++i) {
     auto new_estimate_eigen_vector = RMOperator::grid(RMOperator::degrid(estimate_eigen_vector));
     estimate_eigen_value = new_estimate_eigen_vector.matrix().norm();
     estimate_eigen_vector = new_estimate_eigen_vector / estimate_eigen_value;
+    PURIFY_DEBUG("Iteration: {}, norm = {}", i + 1, estimate_eigen_value);
+    if(relative_difference > std::abs(old_value - estimate_eigen_value) / old_value)
+      break;
+    old_value = estimate_eigen_value;
   }
   return estimate_eigen_value;
 }
 
-Vector<t_complex> RMOperator::covariance_calculation(const Vector<t_complex> &vector) {
+Vector<t_complex> RMOperator::covariance_calculation(const Vector<t_complex> &vector) const {
   /*
     Calculates a new representation of the covariance matrix, using propogation of uncertainty A
     Sigma A^T
@@ -171,6 +267,86 @@ Vector<t_complex> RMOperator::covariance_calculation(const Vector<t_complex> &ve
   return RMOperator::grid(covariance * RMOperator::degrid(vector).array());
 }
 
+std::tuple<std::vector<t_int>, Matrix<t_complex>> RMOperator::covariance_spectra() const {
+  /*
+    The covariance is C = S Z^T F^{-1} M F Z S / norm^2, with M = G^H diag(W Sigma W) G. Since the
+    gridding kernel has a small support, M only has a few non-zero (circular) diagonals
+    m_delta(p) = M(p, p + delta). Then
+
+      (F^{-1} M F)(k, l) = 1/N sum_delta exp(-2 pi i delta l / N) mhat_delta(k - l),
+
+    where mhat_delta is the unnormalised inverse fft of m_delta. Each diagonal is transformed once,
+    in O(N log N), and any element of the covariance then costs one sum over the diagonals.
+  */
+  Array<t_complex> const weights = W * (1. / W.real()).cast<t_complex>() * W;
+  std::map<t_int, t_int> columns;
+  std::vector<t_tripletList> entries;
+  for(t_int m = 0; m < G.outerSize(); ++m)
+    for(Sparse<t_complex>::InnerIterator p(G, m); p; ++p)
+      for(Sparse<t_complex>::InnerIterator q(G, m); q; ++q) {
+        t_int delta = utilities::mod(q.index() - p.index(), ftsize);
+        if(delta > ftsize / 2)
+          delta -= ftsize;
+        auto const column = columns.emplace(delta, columns.size()).first->second;
+        entries.emplace_back(p.index(), column, std::conj(p.value()) * weights(m) * q.value());
+      }
+  Sparse<t_complex> diagonals(ftsize, columns.size());
+  diagonals.setFromTriplets(entries.begin(), entries.end());
+
+  std::vector<t_int> deltas(columns.size());
+  for(auto const &column : columns)
+    deltas[column.second] = column.first;
+  Matrix<t_complex> input = diagonals;
+  Matrix<t_complex> spectra(ftsize, columns.size());
+  if(columns.size() > 0)
+    fftw_execute_dft(RMOperator::fft_plans(columns.size()).second.get(),
+                     reinterpret_cast<fftw_complex *>(input.data()),
+                     reinterpret_cast<fftw_complex *>(spectra.data()));
+  return std::make_tuple(deltas, spectra);
+}
+
+t_complex RMOperator::covariance_element(const t_int &i, const t_int &j,
+                                         const std::vector<t_int> &deltas,
+                                         const Matrix<t_complex> &spectra) const {
+  t_int const x_start = floor(ftsize * 0.5 - imsize * 0.5);
+  t_int const k = i + x_start;
+  t_int const l = j + x_start;
+  t_int const offset = utilities::mod(k - l, ftsize);
+  const t_complex I(0, 1);
+  t_real const phase = -2 * constant::pi * l / ftsize;
+  t_complex result = 0;
+  for(std::size_t c = 0; c < deltas.size(); ++c)
+    result += std::exp(I * phase * static_cast<t_real>(deltas[c])) * spectra(offset, c);
+  return result * S(i) * S(j) / (ftsize * norm * norm);
+}
+
+Matrix<t_complex> RMOperator::covariance_matrix() const {
+  std::vector<t_int> deltas;
+  Matrix<t_complex> spectra;
+  std::tie(deltas, spectra) = RMOperator::covariance_spectra();
+  Matrix<t_complex> covariance(imsize, imsize);
+#pragma omp parallel for
+  for(t_int j = 0; j < imsize; ++j)
+    for(t_int i = 0; i < imsize; ++i)
+      covariance(i, j) = RMOperator::covariance_element(i, j, deltas, spectra);
+  return covariance;
+}
+
+Vector<t_complex> RMOperator::covariance_diagonal() const {
+  return RMOperator::covariance_bands({0}).col(0);
+}
+
+Matrix<t_complex> RMOperator::covariance_bands(const std::vector<t_int> &offsets) const {
+  std::vector<t_int> deltas;
+  Matrix<t_complex> spectra;
+  std::tie(deltas, spectra) = RMOperator::covariance_spectra();
+  Matrix<t_complex> bands = Matrix<t_complex>::Zero(imsize, offsets.size());
+  for(std::size_t b = 0; b < offsets.size(); ++b)
+    for(t_int i = std::max(0, -offsets[b]); i < std::min(imsize, imsize - offsets[b]); ++i)
+      bands(i, b) = RMOperator::covariance_element(i, i + offsets[b], deltas, spectra);
+  return bands;
+}
+
 RMOperator::RMOperator(const utilities::rm_params &rm_vis_input, const t_int &Ju,
                        const std::string &kernel_name, const t_int &imsize,
                        const t_real &oversample_factor, const t_real &cell_size,
@@ -8,7 +8,12 @@
 #include "purify/utilities.h"
 
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <vector>
 #include <CCfits/CCfits>
 #include <unsupported/Eigen/FFT>
 
@@ -24,6 +29,8 @@ public:
   const t_real oversample_factor;
   const t_int imsize;
   const t_int ftsize;
+  //! Number of lines of sight transformed together by one batched fft plan
+  t_int lines_per_block = 256;
 
   //! \brief Generates tools/operators needed for gridding and degridding.
   //! \param[in] u: visibilities in units of ftsizeu
@@ -39,13 +46,38 @@ public:
              const t_real &cell_size = 1, const std::string &weighting_type = "none",
              const t_real &R = 0, bool fft_grid_correction = false);
 
-  //! Degridding operator that degrids image to visibilities
-  Vector<t_complex> degrid(const Vector<t_complex> &eigen_image);
-  //! Gridding operator that grids image from visibilities
-  Vector<t_complex> grid(const Vector<t_complex> &visibilities);
+  //! \brief Degridding operator that degrids image to visibilities
+  //! \details Thread safe, as degrid_lines
+  Vector<t_complex> degrid(const Vector<t_complex> &eigen_image) const;
+  //! \brief Gridding operator that grids image from visibilities
+  //! \details Thread safe, as grid_lines
+  Vector<t_complex> grid(const Vector<t_complex> &visibilities) const;
+  //! \brief Degrids many lines of sight with the same frequency coverage, one per column
+  //! \details Thread safe, the fft plans cached on first use are created under a lock
+  Matrix<t_complex> degrid_lines(const Matrix<t_complex> &lines) const;
+  //! \brief Grids the visibilities of many lines of sight, one per column
+  //! \details Thread safe, the fft plans cached on first use are created under a lock
+  Matrix<t_complex> grid_lines(const Matrix<t_complex> &visibilities) const;
+  //! Coveriance matrix column calculation, grid(Sigma degrid(vector))
+  Vector<t_complex> covariance_calculation(const Vector<t_complex> &vector) const;
+  //! Full covariance matrix of the faraday depth profile
+  Matrix<t_complex> covariance_matrix() const;
+  //! Diagonal of the covariance matrix, i.e. the variance of each faraday depth
+  Vector<t_complex> covariance_diagonal() const;
+  //! \brief Bands of the covariance matrix
+  //! \details Column b holds C(i, i + offsets[b]) for each row i, and zero where i + offsets[b] is
+  //! outside of the image
+  Matrix<t_complex> covariance_bands(const std::vector<t_int> &offsets) const;
 
 protected:
-  Eigen::FFT<t_real> fft;
+  typedef std::shared_ptr<std::remove_pointer<fftw_plan>::type> t_plan;
+  //! Batched forward and backward fft plans, keyed by the number of lines of sight
+  mutable std::map<t_int, std::pair<t_plan, t_plan>> plans_;
+  //! Guards plans_ and the FFTW planner, which is not thread safe
+  mutable std::mutex plans_mutex_;
+  //! \brief Creates or retrieves the batched fft plans for a number of lines of sight
+  //! \details The reference stays valid, since elements of a map are never moved
+  std::pair<t_plan, t_plan> const &fft_plans(const t_int &nlines) const;
   //! Match uv coordinates to grid
   Vector<t_real> omega_to_k(const Vector<t_real> &omega);
   //! Generates interpolation matrix from kernels without using w-component
@@ -60,9 +92,13 @@ protected:
                                 const t_real &oversample_factor, const std::string &weighting_type,
                                 const t_real &R);
   //! Estiamtes norm of operator
-  t_real power_method(const t_int niters);
-  //! Coveriance matrix column calculation
-  Vector<t_complex> covariance_calculation(const Vector<t_complex> &vector);
+  t_real power_method(const t_int niters, const t_real &relative_difference = 1e-9);
+  //! \brief Fourier transforms of the diagonals of G^H diag(W Sigma W) G
+  //! \details Returns the offsets of the non-zero diagonals and one transform per column
+  std::tuple<std::vector<t_int>, Matrix<t_complex>> covariance_spectra() const;
+  //! Element of the covariance matrix, given the spectra of the diagonals
+  t_complex covariance_element(const t_int &i, const t_int &j, const std::vector<t_int> &deltas,
+                               const Matrix<t_complex> &spectra) const;
 };
 }
 
@@ -0,0 +1,181 @@
+#include "purify/config.h"
+#include "purify/ReducedOperator.h"
+#include "purify/logging.h"
+
+namespace purify {
+
+ReducedOperator::ReducedOperator(const MeasurementOperator &measurements,
+                                 const utilities::vis_params &uv_vis, const t_int &norm_iterations)
+    : measurements_(measurements) {
+  /*
+    Builds the normal matrix on the fourier grid and the reduced data.
+
+    measurements:: measurement operator W G F Z S / norm
+    uv_vis:: visibilities and weights w (1/sigma) used in the l2 ball
+    norm_iterations:: max number of iterations in power method
+  */
+  Sparse<t_complex> const &G = measurements.G;
+  t_int const nvis = G.rows();
+  if(uv_vis.vis.size() != nvis or uv_vis.weights.size() != nvis)
+    throw std::runtime_error("Visibilities do not match the measurement operator.");
+  Array<t_real> const c = measurements.W.abs2() * uv_vis.weights.array().abs2()
+                          / (measurements.norm * measurements.norm);
+
+  PURIFY_LOW_LOG("Constructing reduced operator on the fourier grid");
+  // diagonal of the normal matrix, decides which cells carry data
+  Array<t_real> diagonal = Array<t_real>::Zero(G.cols());
+  for(t_int k = 0; k < G.outerSize(); ++k)
+    for(Sparse<t_complex>::InnerIterator it(G, k); it; ++it)
+      diagonal(it.index()) += c(k) * std::norm(it.value());
+  std::vector<t_int> column_map(G.cols(), -1);
+  for(t_int j = 0; j < G.cols(); ++j)
+    if(diagonal(j) > 0) {
+      column_map[j] = cells_.size();
+      cells_.push_back(j);
+    }
+
+  // interpolation matrix restricted to the cells with data
+  std::vector<t_tripletList> entries;
+  entries.reserve(G.nonZeros());
+  for(t_int k = 0; k < G.outerSize(); ++k)
+    for(Sparse<t_complex>::InnerIterator it(G, k); it; ++it)
+      if(column_map[it.index()] >= 0)
+        entries.emplace_back(k, column_map[it.index()], it.value());
+  Sparse<t_complex> reduced_G(nvis, cells_.size());
+  reduced_G.setFromTriplets(entries.begin(), entries.end());
+
+  Sparse<t_complex> const weighted_G = c.cast<t_complex>().matrix().asDiagonal() * reduced_G;
+  normal_ = Sparse<t_complex>(reduced_G.adjoint()) * weighted_G;
+  whitening_ = Array<t_real>::Zero(cells_.size());
+  for(std::size_t i = 0; i < cells_.size(); ++i)
+    whitening_(i) = 1. / std::sqrt(diagonal(cells_[i]));
+
+  Vector<t_complex> const weighted_vis
+      = (measurements.W.conjugate() * uv_vis.weights.array().abs2().cast<t_complex>()
+         * uv_vis.vis.array())
+            .matrix()
+        / measurements.norm;
+  data_ = whitening_.cast<t_complex>()
+          * utilities::sparse_multiply_matrix(Sparse<t_complex>(reduced_G.adjoint()), weighted_vis)
+                .array();
+
+  PURIFY_MEDIUM_LOG("Reduced {} visibilities to {} grid cells", nvis, cells_.size());
+  norm_ = std::sqrt(ReducedOperator::power_method(norm_iterations));
+  data_ /= norm_;
+  PURIFY_LOW_LOG("Found a norm of eta = {} for the reduced operator", norm_);
+}
+
+Vector<t_complex> ReducedOperator::degrid(const Image<t_complex> &eigen_image) const {
+  Vector<t_complex> const ft_vector = measurements_.image_to_ft_grid(eigen_image);
+  Vector<t_complex> cell_values(cells_.size());
+  for(std::size_t i = 0; i < cells_.size(); ++i)
+    cell_values(i) = ft_vector(cells_[i]);
+  return whitening_.cast<t_complex>()
+         * utilities::sparse_multiply_matrix(normal_, cell_values).array() / norm_;
+}
+
+Image<t_complex> ReducedOperator::grid(const Vector<t_complex> &reduced) const {
+  // the normal matrix is hermitian, so it is its own adjoint
+  Vector<t_complex> const cell_values
+      = utilities::sparse_multiply_matrix(normal_,
+                                          (whitening_.cast<t_complex>() * reduced.array()).matrix())
+        / norm_;
+  Vector<t_complex> ft_vector
+      = Vector<t_complex>::Zero(measurements_.ftsizeu() * measurements_.ftsizev());
+  for(std::size_t i = 0; i < cells_.size(); ++i)
+    ft_vector(cells_[i]) = cell_values(i);
+  return measurements_.ft_grid_to_image(ft_vector);
+}
+
+MemoryFootprint ReducedOperator::estimate_memory(const t_uint &visibilities, const t_int &Ju,
+                                                 const t_int &Jv, const t_int &imsizex,
+                                                 const t_int &imsizey,
+                                                 const t_real &oversample_factor) {
+  /*
+    Follows the constructor. The diagonal and the map of the columns span the whole grid. The
+    triplets, the restricted G, the weighted G and the adjoint of the restricted G exist together
+    while the normal matrix is computed. Cells are pushed back, so their vector may have twice the
+    capacity needed.
+  */
+  MemoryFootprint footprint = MeasurementOperator::estimate_memory(visibilities, Ju, Jv, imsizex,
+                                                                   imsizey, oversample_factor);
+  t_uint const grid_cells = static_cast<t_uint>(std::floor(imsizex * oversample_factor))
+                            * static_cast<t_uint>(std::floor(imsizey * oversample_factor));
+  t_uint const entries = visibilities * Ju * Jv;
+  t_uint const cells = std::min(grid_cells, entries);
+  t_uint const couplings
+      = std::min(cells, static_cast<t_uint>(2 * Ju - 1) * static_cast<t_uint>(2 * Jv - 1));
+  t_uint const entry_bytes = sizeof(t_complex) + sizeof(t_int);
+  t_uint const normal = cells * couplings * entry_bytes + (cells + 1) * sizeof(t_int);
+  footprint.solver
+      = 2 * cells * sizeof(t_int) + normal + cells * (sizeof(t_real) + sizeof(t_complex));
+  footprint.solver_construction
+      = grid_cells * (sizeof(t_real) + sizeof(t_int)) + entries * sizeof(t_tripletList)
+        + 3 * (entries * entry_bytes + (visibilities + 1) * sizeof(t_int)) + normal;
+  return footprint;
+}
+
+MemoryFootprint ReducedOperator::memory_footprint() const {
+  MemoryFootprint footprint = measurements_.memory_footprint();
+  Sparse<t_complex> const &G = measurements_.G;
+  t_uint const entry_bytes = sizeof(t_complex) + sizeof(t_int);
+  t_uint const normal
+      = normal_.data().allocatedSize() * entry_bytes + (normal_.outerSize() + 1) * sizeof(t_int);
+  footprint.solver = cells_.capacity() * sizeof(t_int) + normal
+                     + whitening_.size() * sizeof(t_real) + data_.size() * sizeof(t_complex);
+  footprint.solver_construction
+      = G.cols() * (sizeof(t_real) + sizeof(t_int))
+        + G.nonZeros() * sizeof(t_tripletList)
+        + 3 * (G.nonZeros() * entry_bytes + (G.rows() + 1) * sizeof(t_int)) + normal;
+  return footprint;
+}
+
+t_real ReducedOperator::l2_radius(const t_real &noise_rms, const t_real &n_sigma) const {
+  /*
+    The reduced noise has the same variance as the whitened visibility noise on each cell, scaled by
+    the norm of the reduced operator. noise_rms combines the real and imaginary parts.
+  */
+  return utilities::calculate_l2_radius(data_, noise_rms / std::sqrt(2) / norm_, n_sigma, "chi");
+}
+
+t_real ReducedOperator::power_method(const t_int &niters, const t_real &relative_difference) {
+  /*
+   Attempt at coding the power method, returns the largest eigen value of a linear operator
+    niters:: max number of iterations
+    relative_difference:: percentage difference at which eigen value has converged
+  */
+  t_real estimate_eigen_value = 1;
+  t_real old_value = 0;
+  Image<t_complex> estimate_eigen_vector
+      = Image<t_complex>::Random(measurements_.imsizey(), measurements_.imsizex());
+  estimate_eigen_vector = estimate_eigen_vector / estimate_eigen_vector.matrix().norm();
+  for(t_int i = 0; i < niters; ++i) {
+    auto new_estimate_eigen_vector
+        = ReducedOperator::grid(ReducedOperator::degrid(estimate_eigen_vector));
+    estimate_eigen_value = new_estimate_eigen_vector.matrix().norm();
+    estimate_eigen_vector = new_estimate_eigen_vector / estimate_eigen_value;
+    PURIFY_DEBUG("Iteration: {}, norm = {}", i + 1, estimate_eigen_value);
+    if(relative_difference > std::abs(old_value - estimate_eigen_value) / old_value)
+      break;
+    old_value = estimate_eigen_value;
+  }
+  return estimate_eigen_value;
+}
+
+sopt::LinearTransform<sopt::Vector<sopt::t_complex>>
+linear_transform(ReducedOperator const &reduced) {
+  auto const height = reduced.measurements().imsizey();
+  auto const width = reduced.measurements().imsizex();
+  auto direct = [&reduced, width, height](Vector<t_complex> &out, Vector<t_complex> const &x) {
+    assert(x.size() == width * height);
+    auto const image = Image<t_complex>::Map(x.data(), height, width);
+    out = reduced.degrid(image);
+  };
+  auto adjoint = [&reduced, width, height](Vector<t_complex> &out, Vector<t_complex> const &x) {
+    auto image = Image<t_complex>::Map(out.data(), height, width);
+    image = reduced.grid(x);
+  };
+  return sopt::linear_transform<Vector<t_complex>>(direct, {{0, 1, reduced.size()}}, adjoint,
+                                                   {{0, 1, static_cast<t_int>(width * height)}});
+}
+}
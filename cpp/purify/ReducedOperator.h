@@ -0,0 +1,69 @@
+#ifndef PURIFY_REDUCED_OPERATOR_H
+#define PURIFY_REDUCED_OPERATOR_H
+
+#include "purify/config.h"
+#include <vector>
+#include <sopt/linear_transform.h>
+#include "purify/MeasurementOperator.h"
+#include "purify/types.h"
+#include "purify/utilities.h"
+
+namespace purify {
+
+//! \brief Measurement operator posed on the oversampled fourier grid instead of the visibilities
+//! \details With c = |W|^2 w^2 and H = G^H diag(c) G / norm^2, the reduced operator is
+//! D^{-1/2} H F Z S, where D = diag(H) is restricted to the grid cells that carry data. The reduced
+//! data D^{-1/2} G^H W^H w^2 y / norm then has unit variance noise on the diagonal, and the cost
+//! of applying the operator no longer depends on the number of visibilities.
+class ReducedOperator {
+public:
+  //! Builds the reduced operator from a measurement operator and the visibilities it was built on
+  ReducedOperator(const MeasurementOperator &measurements, const utilities::vis_params &uv_vis,
+                  const t_int &norm_iterations = 20);
+
+  //! Maps an image onto the reduced data space
+  Vector<t_complex> degrid(const Image<t_complex> &eigen_image) const;
+  //! Maps reduced data back onto an image
+  Image<t_complex> grid(const Vector<t_complex> &reduced) const;
+  //! Reduced data
+  Vector<t_complex> const &data() const { return data_; }
+  //! Number of reduced measurements, i.e. grid cells with data
+  t_int size() const { return cells_.size(); }
+  //! Radius of the l2 ball for the reduced data, given the rms of the whitened visibility noise
+  t_real l2_radius(const t_real &noise_rms, const t_real &n_sigma = 2.) const;
+  //! Measurement operator the reduction is built on
+  MeasurementOperator const &measurements() const { return measurements_; }
+  //! Norm of the reduced operator, removed from operator and data
+  t_real norm() const { return norm_; }
+
+  //! \brief Predicts the memory of a reduced operator and its measurement operator, before
+  //! building them
+  //! \details An upper bound: every cell reached by the kernel of a visibility carries data, and
+  //! the normal matrix couples it with all cells within twice the support of the kernel.
+  static MemoryFootprint
+  estimate_memory(const t_uint &visibilities, const t_int &Ju, const t_int &Jv,
+                  const t_int &imsizex, const t_int &imsizey, const t_real &oversample_factor);
+  //! Memory of this operator and its measurement operator, from the sizes of their matrices
+  MemoryFootprint memory_footprint() const;
+
+protected:
+  MeasurementOperator const &measurements_;
+  //! Indices of the fourier grid cells with data
+  std::vector<t_int> cells_;
+  //! G^H diag(c) G / norm^2 restricted to the cells with data
+  Sparse<t_complex> normal_;
+  //! D^{-1/2} on the cells with data
+  Array<t_real> whitening_;
+  //! Reduced data
+  Vector<t_complex> data_;
+  t_real norm_ = 1;
+
+  //! Estimates norm of operator
+  t_real power_method(const t_int &niters, const t_real &relative_difference = 1e-9);
+};
+
+//! Helper function to create a linear transform from a reduced operator
+sopt::LinearTransform<sopt::Vector<sopt::t_complex>>
+linear_transform(ReducedOperator const &reduced);
+}
+#endif
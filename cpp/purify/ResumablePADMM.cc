@@ -0,0 +1,77 @@
+#include "purify/config.h"
+#include "purify/ResumablePADMM.h"
+#include "purify/logging.h"
+
+namespace purify {
+
+checkpoint::SolverState ResumablePADMM::initial_state(Vector<t_complex> const &x,
+                                                      Vector<t_complex> const &residual) const {
+  checkpoint::SolverState state;
+  state.gamma = gamma();
+  state.x = x;
+  state.residual = residual;
+  state.lambda = Vector<t_complex>::Zero(target().size());
+  state.z = Vector<t_complex>::Zero(target().size());
+  state.l1_weights = l1_proximal_weights();
+  return state;
+}
+
+std::uint64_t ResumablePADMM::fingerprint() const {
+  checkpoint::Fingerprint fingerprint;
+  fingerprint(target())(l2ball_proximal_epsilon())(l2ball_proximal_weights())(gamma());
+  fingerprint(nu())(lagrange_update_scale())(relative_variation())(residual_convergence());
+  fingerprint(tight_frame() ? 1. : 0.)(l1_proximal_weights())(l1_proximal_tolerance());
+  fingerprint(l1_proximal_nu())(static_cast<t_real>(l1_proximal_itermax()));
+  fingerprint(l1_proximal_positivity_constraint() ? 1. : 0.);
+  fingerprint(l1_proximal_real_constraint() ? 1. : 0.);
+  return fingerprint.value();
+}
+
+bool ResumablePADMM::solve(checkpoint::SolverState &state) {
+  /*
+    Same criteria as sopt's solver: the user's function, the weighted norm of the residual, and the
+    relative variation of the image must all be satisfied. The user's function is called on every
+    iteration, since it may update gamma.
+  */
+  if(state.x.size() == 0 or state.residual.size() != target().size()
+     or state.lambda.size() != target().size() or state.z.size() != target().size())
+    throw std::runtime_error("Solver state does not match the measurements.");
+  gamma(state.gamma);
+  if(state.l1_weights.size() > 0)
+    l1_proximal_weights(state.l1_weights);
+  PURIFY_MEDIUM_LOG("Proximal ADMM from iteration {}, gamma = {}", state.iteration, state.gamma);
+
+  bool converged = false;
+  Vector<t_complex> previous;
+  while(not converged and state.iteration < itermax()) {
+    previous = state.x;
+    iteration_step(state.x, state.residual, state.lambda, state.z);
+    ++state.iteration;
+
+    bool const user = (not is_converged()) or is_converged()(state.x);
+    auto const &weights = l2ball_proximal_weights();
+    t_real const residual_norm
+        = weights.size() == state.residual.size() ?
+              (state.residual.array() * weights.array()).matrix().stableNorm() :
+              state.residual.stableNorm() * (weights.size() == 1 ? weights(0) : 1);
+    bool const residual = residual_convergence() <= 0 or residual_norm < residual_convergence();
+    t_real const variation = (state.x - previous).stableNorm();
+    bool const relative
+        = relative_variation() <= 0 or variation < relative_variation() * previous.stableNorm();
+    converged = user and residual and relative;
+    state.gamma = gamma();
+    PURIFY_LOW_LOG("Iteration {}: residual norm = {}, variation = {}", state.iteration,
+                   residual_norm, variation);
+
+    if(checkpoint_ and not converged
+       and ((cadence_ > 0 and state.iteration % cadence_ == 0) or state.iteration == itermax()))
+      checkpoint_(state);
+  }
+  if(converged) {
+    PURIFY_MEDIUM_LOG("Proximal ADMM converged after {} iterations", state.iteration);
+  } else {
+    PURIFY_MEDIUM_LOG("Proximal ADMM did not converge within {} iterations", itermax());
+  }
+  return converged;
+}
+}
@@ -0,0 +1,51 @@
+#ifndef PURIFY_RESUMABLE_PADMM_H
+#define PURIFY_RESUMABLE_PADMM_H
+
+#include "purify/config.h"
+#include <functional>
+#include <sopt/imaging_padmm.h>
+#include "purify/checkpoint.h"
+#include "purify/types.h"
+
+namespace purify {
+
+//! \brief Proximal ADMM that can stop and carry on from its full state
+//! \details sopt keeps the dual variables local to its solver, so a run restarted from the image
+//! alone does not follow the same path. This solver runs the same iterations on a
+//! checkpoint::SolverState, which can be saved and read back to resume bit for bit.
+class ResumablePADMM : public sopt::algorithm::ImagingProximalADMM<t_complex> {
+public:
+  typedef sopt::algorithm::ImagingProximalADMM<t_complex> PADMM;
+  typedef std::function<void(checkpoint::SolverState const &)> t_Checkpoint;
+
+  template <class DERIVED>
+  ResumablePADMM(Eigen::MatrixBase<DERIVED> const &target) : PADMM(target), cadence_(0) {}
+
+  //! State before the first iteration, from an estimate of the image and its residual
+  checkpoint::SolverState
+  initial_state(Vector<t_complex> const &x, Vector<t_complex> const &residual) const;
+
+  //! \brief Hash of the target, the l2 ball, gamma and the other parameters of the solver
+  //! \details Taken before solving, with the initial gamma, since gamma can change as it iterates.
+  std::uint64_t fingerprint() const;
+
+  //! \brief Calls a function with the state every few iterations
+  //! \details and when itermax stops the solver before it converges, so that a run with more
+  //! iterations carries on from there. A converged state is final and is not handed out.
+  ResumablePADMM &checkpoint(t_Checkpoint const &function, t_uint const &cadence) {
+    checkpoint_ = function;
+    cadence_ = cadence;
+    return *this;
+  }
+
+  //! \brief Iterates from a state until convergence or itermax iterations in total
+  //! \details Gamma and the l1 weights are taken from the state, which holds the solution on exit.
+  //! \returns whether the solver converged
+  bool solve(checkpoint::SolverState &state);
+
+protected:
+  t_Checkpoint checkpoint_;
+  t_uint cadence_;
+};
+}
+#endif
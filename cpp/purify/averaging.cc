@@ -0,0 +1,268 @@
+#include "purify/averaging.h"
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include "purify/logging.h"
+
+namespace purify {
+namespace averaging {
+
+t_real smearing_limit(const t_real &tolerance, const t_real &field_of_view) {
+  /*
+    Averaging over a displacement d (wavelengths) in the uv-plane multiplies a source at distance l
+    (radians) from the phase centre by sinc(pi l d) ~ 1 - (pi l d)^2 / 6. The largest displacement
+    that keeps the amplitude loss below the tolerance at the edge of the field is returned.
+
+    tolerance:: fractional amplitude loss allowed at the edge of the field of view
+    field_of_view:: radius of the field of view in radians
+  */
+  if(tolerance < 0 or tolerance >= 1)
+    throw std::runtime_error("Smearing tolerance must be between 0 and 1.");
+  if(field_of_view <= 0)
+    throw std::runtime_error("Field of view must be positive to compute the smearing limit.");
+  return std::sqrt(6 * tolerance) / (constant::pi * field_of_view);
+}
+
+t_real field_of_view_radius(const t_int &imsizex, const t_int &imsizey, const t_real &cell_x,
+                            const t_real &cell_y) {
+  /*
+    Distance from the phase centre to the corner of the image.
+
+    imsizex, imsizey:: image size in pixels
+    cell_x, cell_y:: pixel size in arcseconds
+  */
+  t_real const arcsec_to_radians = constant::pi / (180. * 3600.);
+  t_real const width = imsizex * cell_x * arcsec_to_radians;
+  t_real const height = imsizey * cell_y * arcsec_to_radians;
+  return 0.5 * std::sqrt(width * width + height * height);
+}
+
+std::vector<t_int> baseline_dependent_groups(const utilities::vis_params &uv_vis,
+                                             const sample_params &samples,
+                                             const t_real &tolerance, const t_real &field_of_view) {
+  /*
+    Assigns an output index to each visibility. Samples share an index when they are on the same
+    baseline and the uv track they span stays within the smearing limit. The limit is split evenly
+    between bandwidth smearing (channels are blocked while |b| dnu / c stays small) and time
+    smearing (consecutive time stamps are binned while the frequency normalised uv position moves
+    less than the limit). Short baselines move slowly in the uv-plane and are averaged the most.
+
+    uv_vis:: visibilities in units of wavelengths
+    samples:: baseline, time and frequency of each visibility
+    tolerance:: fractional amplitude loss allowed at the edge of the field of view
+    field_of_view:: radius of the field of view in radians
+  */
+  t_int const nvis = uv_vis.u.size();
+  if(samples.antenna1.size() != nvis or samples.antenna2.size() != nvis
+     or samples.time.size() != nvis or samples.frequency.size() != nvis)
+    throw std::runtime_error("Sample information does not match the number of visibilities.");
+  if(uv_vis.units != "lambda")
+    throw std::runtime_error("Baseline-dependent averaging expects uv coordinates in wavelengths.");
+
+  t_real const limit = smearing_limit(tolerance, field_of_view);
+  t_real const time_limit = limit / std::sqrt(2.);
+  t_real const frequency_limit = limit / std::sqrt(2.);
+
+  std::vector<t_int> order(nvis);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&samples](t_int a, t_int b) {
+    if(samples.antenna1(a) != samples.antenna1(b))
+      return samples.antenna1(a) < samples.antenna1(b);
+    if(samples.antenna2(a) != samples.antenna2(b))
+      return samples.antenna2(a) < samples.antenna2(b);
+    if(samples.frequency(a) != samples.frequency(b))
+      return samples.frequency(a) < samples.frequency(b);
+    return samples.time(a) < samples.time(b);
+  });
+
+  std::vector<t_int> groups(nvis, 0);
+  t_int ngroups = 0;
+  std::vector<t_int> block;
+  auto baseline_start = order.begin();
+  while(baseline_start != order.end()) {
+    auto const same_baseline = [&samples, baseline_start](t_int i) {
+      return samples.antenna1(i) == samples.antenna1(*baseline_start)
+             and samples.antenna2(i) == samples.antenna2(*baseline_start);
+    };
+    auto const baseline_end = std::find_if_not(baseline_start, order.end(), same_baseline);
+    // longest projected baseline in light seconds, sets the allowed channel span
+    t_real delay = 0;
+    for(auto i = baseline_start; i != baseline_end; ++i)
+      if(samples.frequency(*i) > 0)
+        delay = std::max(delay, std::sqrt(uv_vis.u(*i) * uv_vis.u(*i) + uv_vis.v(*i) * uv_vis.v(*i))
+                                    / samples.frequency(*i));
+
+    auto block_start = baseline_start;
+    while(block_start != baseline_end) {
+      t_real const start_frequency = samples.frequency(*block_start);
+      auto block_end = block_start;
+      while(block_end != baseline_end
+            and (samples.frequency(*block_end) == start_frequency
+                 or delay * (samples.frequency(*block_end) - start_frequency) <= frequency_limit))
+        ++block_end;
+
+      // time binning on frequency normalised uv positions
+      block.assign(block_start, block_end);
+      std::stable_sort(block.begin(), block.end(), [&samples](t_int a, t_int b) {
+        return samples.time(a) < samples.time(b);
+      });
+      t_real const reference_frequency = samples.frequency(*(block_end - 1));
+      auto const scale = [&samples, reference_frequency](t_int i) {
+        return samples.frequency(i) > 0 ? reference_frequency / samples.frequency(i) : 1.;
+      };
+      t_int bin_start = block.front();
+      groups[bin_start] = ngroups;
+      for(std::size_t j = 1; j < block.size(); ++j) {
+        t_int const i = block[j];
+        t_real const du = uv_vis.u(i) * scale(i) - uv_vis.u(bin_start) * scale(bin_start);
+        t_real const dv = uv_vis.v(i) * scale(i) - uv_vis.v(bin_start) * scale(bin_start);
+        if(std::sqrt(du * du + dv * dv) > time_limit) {
+          bin_start = i;
+          ++ngroups;
+        }
+        groups[i] = ngroups;
+      }
+      ++ngroups;
+      block_start = block_end;
+    }
+    baseline_start = baseline_end;
+  }
+  return groups;
+}
+
+utilities::vis_params
+combine(const utilities::vis_params &uv_vis, const std::vector<t_int> &groups) {
+  /*
+    Combines visibilities with the same group index. Weights hold 1/sigma, so visibilities and
+    coordinates are averaged with inverse-variance weights |w|^2 and the combined weight is
+    sqrt(sum |w|^2). Groups with zero total weight are averaged uniformly and keep a zero weight.
+
+    uv_vis:: visibilities to combine
+    groups:: output index of each visibility
+  */
+  t_int const nvis = uv_vis.vis.size();
+  if(static_cast<t_int>(groups.size()) != nvis)
+    throw std::runtime_error("Group indices do not match the number of visibilities.");
+  t_int const ngroups = groups.empty() ? 0 : *std::max_element(groups.begin(), groups.end()) + 1;
+  bool const has_w = uv_vis.w.size() == nvis;
+
+  Vector<t_real> total = Vector<t_real>::Zero(ngroups);
+  Vector<t_real> counts = Vector<t_real>::Zero(ngroups);
+  for(t_int i = 0; i < nvis; ++i) {
+    total(groups[i]) += std::norm(uv_vis.weights(i));
+    counts(groups[i]) += 1;
+  }
+
+  utilities::vis_params averaged;
+  averaged.u = Vector<t_real>::Zero(ngroups);
+  averaged.v = Vector<t_real>::Zero(ngroups);
+  averaged.w = Vector<t_real>::Zero(ngroups);
+  averaged.vis = Vector<t_complex>::Zero(ngroups);
+  for(t_int i = 0; i < nvis; ++i) {
+    t_int const g = groups[i];
+    t_real const factor
+        = total(g) > 0 ? std::norm(uv_vis.weights(i)) / total(g) : 1. / counts(g);
+    averaged.u(g) += factor * uv_vis.u(i);
+    averaged.v(g) += factor * uv_vis.v(i);
+    if(has_w)
+      averaged.w(g) += factor * uv_vis.w(i);
+    averaged.vis(g) += factor * uv_vis.vis(i);
+  }
+  averaged.weights = total.array().sqrt().cast<t_complex>();
+  averaged.units = uv_vis.units;
+  averaged.ra = uv_vis.ra;
+  averaged.dec = uv_vis.dec;
+  averaged.average_frequency = uv_vis.average_frequency;
+  return averaged;
+}
+
+utilities::vis_params
+baseline_dependent_averaging(const utilities::vis_params &uv_vis, const sample_params &samples,
+                             const t_real &tolerance, const t_real &field_of_view) {
+  auto const averaged
+      = combine(uv_vis, baseline_dependent_groups(uv_vis, samples, tolerance, field_of_view));
+  PURIFY_MEDIUM_LOG("Baseline-dependent averaging reduced {} visibilities to {}", uv_vis.vis.size(),
+                    averaged.vis.size());
+  return averaged;
+}
+std::vector<t_int> uv_groups(const utilities::vis_params &uv_vis, const t_real &tolerance) {
+  /*
+    Each group is represented by its first sample, and a sample joins the earliest group whose
+    representative lies within the tolerance. Representatives are binned into cubes as wide as the
+    tolerance, so only the cube of a sample and its neighbours are searched, and samples on either
+    side of a cube boundary are still merged. Samples of a group are within the tolerance of its
+    first sample, hence within twice the tolerance of each other. A zero tolerance only groups
+    exact duplicates. Groups are numbered in order of first appearance.
+
+    uv_vis:: visibilities
+    tolerance:: largest distance between a merged sample and the first sample of its group, in the
+    units of uv_vis
+  */
+  if(tolerance < 0)
+    throw std::runtime_error("Tolerance for merging visibilities must not be negative.");
+  t_int const nvis = uv_vis.u.size();
+  bool const has_w = uv_vis.w.size() == nvis;
+  auto const key = [tolerance](t_real x) { return tolerance > 0 ? std::floor(x / tolerance) : x; };
+  auto const w = [&uv_vis, has_w](t_int i) { return has_w ? uv_vis.w(i) : 0.; };
+  t_int const reach = tolerance > 0 ? 1 : 0;
+  t_int const w_reach = has_w ? reach : 0;
+
+  std::map<std::tuple<t_real, t_real, t_real>, std::vector<t_int>> cells;
+  std::vector<t_int> representatives;
+  std::vector<t_int> groups(nvis);
+  for(t_int i = 0; i < nvis; ++i) {
+    t_real const ku = key(uv_vis.u(i));
+    t_real const kv = key(uv_vis.v(i));
+    t_real const kw = key(w(i));
+    t_int group = -1;
+    for(t_int du = -reach; du <= reach; ++du)
+      for(t_int dv = -reach; dv <= reach; ++dv)
+        for(t_int dw = -w_reach; dw <= w_reach; ++dw) {
+          auto const cell = cells.find(std::make_tuple(ku + du, kv + dv, kw + dw));
+          if(cell == cells.end())
+            continue;
+          for(auto const candidate : cell->second) {
+            t_int const j = representatives[candidate];
+            t_real const distance = std::sqrt(std::pow(uv_vis.u(i) - uv_vis.u(j), 2)
+                                              + std::pow(uv_vis.v(i) - uv_vis.v(j), 2)
+                                              + std::pow(w(i) - w(j), 2));
+            if(distance <= tolerance and (group < 0 or candidate < group))
+              group = candidate;
+          }
+        }
+    if(group < 0) {
+      group = representatives.size();
+      representatives.push_back(i);
+      cells[std::make_tuple(ku, kv, kw)].push_back(group);
+    }
+    groups[i] = group;
+  }
+  return groups;
+}
+
+std::tuple<utilities::vis_params, std::vector<t_int>>
+coalesce(const utilities::vis_params &uv_vis, const t_real &tolerance) {
+  /*
+    Samples at the same position contribute identical rows to the measurement operator, so merging
+    them with inverse-variance weights leaves the weighted least-squares problem unchanged up to
+    the displacement allowed by the tolerance.
+  */
+  auto const groups = uv_groups(uv_vis, tolerance);
+  auto const merged = combine(uv_vis, groups);
+  PURIFY_MEDIUM_LOG("Merging samples within {} {} reduced {} visibilities to {}", tolerance,
+                    uv_vis.units, uv_vis.vis.size(), merged.vis.size());
+  return std::make_tuple(merged, groups);
+}
+
+Vector<t_complex> expand(const Vector<t_complex> &merged, const std::vector<t_int> &groups) {
+  Vector<t_complex> result(groups.size());
+  for(std::size_t i = 0; i < groups.size(); ++i) {
+    if(groups[i] >= merged.size())
+      throw std::runtime_error("Mapping refers to a visibility that does not exist.");
+    result(i) = merged(groups[i]);
+  }
+  return result;
+}
+}
+}
@@ -0,0 +1,50 @@
+#ifndef PURIFY_AVERAGING_H
+#define PURIFY_AVERAGING_H
+
+#include "purify/config.h"
+#include <tuple>
+#include <vector>
+#include "purify/types.h"
+#include "purify/utilities.h"
+
+namespace purify {
+
+namespace averaging {
+//! Per visibility information needed to decide which samples can be averaged together
+struct sample_params {
+  Vector<t_int> antenna1;   // first antenna of the baseline
+  Vector<t_int> antenna2;   // second antenna of the baseline
+  Vector<t_real> time;      // time stamp in seconds
+  Vector<t_real> frequency; // frequency of the channel in Hz
+};
+
+//! Largest displacement in the uv-plane (wavelengths) that keeps smearing below tolerance
+t_real smearing_limit(const t_real &tolerance, const t_real &field_of_view);
+//! Radius of the field of view in radians, from the image size and cell size in arcseconds
+t_real field_of_view_radius(const t_int &imsizex, const t_int &imsizey, const t_real &cell_x,
+                            const t_real &cell_y);
+//! Groups visibilities on each baseline over time and frequency intervals with bounded smearing
+std::vector<t_int> baseline_dependent_groups(const utilities::vis_params &uv_vis,
+                                             const sample_params &samples,
+                                             const t_real &tolerance, const t_real &field_of_view);
+//! Combines visibilities that share a group index into a single inverse-variance weighted sample
+utilities::vis_params
+combine(const utilities::vis_params &uv_vis, const std::vector<t_int> &groups);
+//! Averages visibilities over time and frequency depending on baseline length
+utilities::vis_params
+baseline_dependent_averaging(const utilities::vis_params &uv_vis, const sample_params &samples,
+                             const t_real &tolerance, const t_real &field_of_view);
+//! \brief Groups visibilities whose uvw positions agree within the tolerance
+//! \details Each sample is within the tolerance of the first sample of its group, wherever the
+//! samples fall relative to the bins used to search for neighbours.
+std::vector<t_int> uv_groups(const utilities::vis_params &uv_vis, const t_real &tolerance);
+//! \brief Merges visibilities at (nearly) the same uvw position into single weighted visibilities
+//! \details Returns the merged visibilities and the index of the merged visibility for each input
+std::tuple<utilities::vis_params, std::vector<t_int>>
+coalesce(const utilities::vis_params &uv_vis, const t_real &tolerance);
+//! Maps values of merged visibilities back onto the original visibilities
+Vector<t_complex> expand(const Vector<t_complex> &merged, const std::vector<t_int> &groups);
+}
+}
+
+#endif
@@ -1,13 +1,294 @@
 #include "purify/config.h"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <set>
 #include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
 #include <casacore/casa/Arrays/IPosition.h>
+#include <casacore/casa/Arrays/Slicer.h>
 #include <casacore/tables/TaQL/ExprNode.h>
 #include "purify/casacore.h"
+#include "purify/instrumentation.h"
 #include "purify/logging.h"
 #include "purify/types.h"
 
 namespace purify {
 namespace casa {
+namespace {
+//! All channels of the measurement set if none are selected
+std::vector<t_int>
+selected_channels(MeasurementSet const &ms_file, std::vector<t_int> const &channels) {
+  if(not channels.empty())
+    return channels;
+  PURIFY_LOW_LOG("All Channels = {}", ms_file.size());
+  std::vector<t_int> result(ms_file.size());
+  std::iota(result.begin(), result.end(), 0);
+  return result;
+}
+
+//! Rows of the main table read at once by the single pass readers
+constexpr t_uint chunk_rows = 10000;
+
+//! Rows start to start + n of a table
+::casacore::Slicer row_slicer(t_uint start, t_uint n) {
+  return ::casacore::Slicer(::casacore::IPosition(1, start), ::casacore::IPosition(1, n));
+}
+
+//! Name of a polarisation, as understood by mscal.stokes
+std::string polarization_name(MeasurementSet::ChannelWrapper::polarization const &polarization) {
+  typedef MeasurementSet::ChannelWrapper::polarization polarization_type;
+  switch(polarization) {
+  case polarization_type::I:
+    return "I";
+  case polarization_type::Q:
+    return "Q";
+  case polarization_type::U:
+    return "U";
+  case polarization_type::V:
+    return "V";
+  case polarization_type::LL:
+    return "LL";
+  case polarization_type::RR:
+    return "RR";
+  case polarization_type::RL:
+    return "RL";
+  case polarization_type::LR:
+    return "LR";
+  case polarization_type::XX:
+    return "XX";
+  case polarization_type::YY:
+    return "YY";
+  case polarization_type::XY:
+    return "XY";
+  case polarization_type::YX:
+    return "YX";
+  }
+  throw std::runtime_error("Unknown polarization");
+}
+
+//! Rows kept by a filter, and which of their channels hold unflagged visibilities
+struct Selection {
+  //! Rows of the main table kept by the filter
+  ::casacore::Table table;
+  std::vector<t_int> channels;
+  //! Whether each selected channel of each row is unflagged in every polarisation, row major
+  std::vector<char> valid;
+  //! Number of visibilities of each selected channel in each chunk of rows, chunk major
+  std::vector<t_uint> counts;
+  //! Index in the output of the first visibility of each selected channel in each chunk
+  std::vector<t_uint> firsts;
+  t_uint total = 0;
+  t_uint size() const { return total; }
+  t_uint chunks() const { return channels.empty() ? 0 : counts.size() / channels.size(); }
+};
+
+Selection select_visibilities(MeasurementSet const &ms_file,
+                              std::vector<t_int> const &channels_input,
+                              std::string const &filter) {
+  Selection selection;
+  selection.table
+      = filter.empty()
+            ? ms_file.table()
+            : ::casacore::tableCommand("SELECT FROM $1 " + filter, ms_file.table()).table();
+  selection.channels = selected_channels(ms_file, channels_input);
+  t_uint const nrows = selection.table.nrow();
+  t_uint const nchannels = selection.channels.size();
+  selection.valid.resize(nrows * nchannels);
+  if(nrows == 0)
+    return selection;
+  ::casacore::ArrayColumn<::casacore::Bool> const flag_column(selection.table, "FLAG");
+  t_uint const npolarizations = flag_column.shape(0)(0);
+  t_uint const total_channels = flag_column.shape(0)(1);
+  for(auto const channel : selection.channels)
+    if(channel < 0 or static_cast<t_uint>(channel) >= total_channels)
+      throw std::out_of_range("Not that many channels");
+  for(t_uint start = 0; start < nrows; start += chunk_rows) {
+    auto const n = std::min(chunk_rows, nrows - start);
+    auto const flags = flag_column.getColumnRange(row_slicer(start, n));
+    auto const counts = selection.counts.insert(selection.counts.end(), nchannels, 0);
+    for(t_uint i = 0; i < n; ++i)
+      for(t_uint c = 0; c < nchannels; ++c) {
+        auto const first
+            = flags.data() + (i * total_channels + selection.channels[c]) * npolarizations;
+        bool const valid = std::none_of(first, first + npolarizations,
+                                        [](::casacore::Bool const &flag) { return flag; });
+        selection.valid[(start + i) * nchannels + c] = valid;
+        counts[c] += valid;
+      }
+  }
+  /* Visibilities are ordered by channel, then by row, as when reading one channel at a time */
+  selection.firsts.resize(selection.counts.size());
+  for(t_uint c = 0; c < nchannels; ++c)
+    for(t_uint chunk = 0; chunk < selection.chunks(); ++chunk) {
+      selection.firsts[chunk * nchannels + c] = selection.total;
+      selection.total += selection.counts[chunk * nchannels + c];
+    }
+  return selection;
+}
+
+//! Column of SPECTRAL_WINDOW, with a row per spectral window and a column per channel
+Matrix<t_real> spectral_window(MeasurementSet const &ms_file, std::string const &column) {
+  return table_column<t_real>(ms_file.table("SPECTRAL_WINDOW"), column);
+}
+
+//! Values of an array column of complex numbers, in storage order
+std::vector<t_complex> complex_values(::casacore::Table const &table, std::string const &column) {
+  if(table.tableDesc().columnDesc(column).trueDataType() == ::casacore::TpArrayComplex) {
+    auto const values = ::casacore::ArrayColumn<::casacore::Complex>(table, column).getColumn();
+    return std::vector<t_complex>(values.data(), values.data() + values.nelements());
+  }
+  auto const values = ::casacore::ArrayColumn<::casacore::DComplex>(table, column).getColumn();
+  return std::vector<t_complex>(values.data(), values.data() + values.nelements());
+}
+
+//! Values of an array column of real numbers, in storage order
+std::vector<t_real> real_values(::casacore::Table const &table, std::string const &column) {
+  if(table.tableDesc().columnDesc(column).trueDataType() == ::casacore::TpArrayFloat) {
+    auto const values = ::casacore::ArrayColumn<::casacore::Float>(table, column).getColumn();
+    return std::vector<t_real>(values.data(), values.data() + values.nelements());
+  }
+  auto const values = ::casacore::ArrayColumn<::casacore::Double>(table, column).getColumn();
+  return std::vector<t_real>(values.data(), values.data() + values.nelements());
+}
+
+//! Direction (RA, DEC) of the sources of a set of fields
+MeasurementSet::Direction fields_direction(MeasurementSet const &ms_file,
+                                           std::set<::casacore::Int> const &field_ids,
+                                           t_real tolerance = 1e-8) {
+  auto const source_ids_raw = table_column<::casacore::Int>(ms_file.table("FIELD"), "SOURCE_ID");
+  std::set<::casacore::Int> source_ids;
+  for(auto const field_id : field_ids) {
+    assert(field_id < source_ids_raw.size());
+    source_ids.insert(source_ids_raw(field_id));
+  }
+  if(source_ids.size() == 0)
+    throw std::runtime_error("Could not find sources. Cannot determine direction");
+  auto const directions = table_column<::casacore::Double>(ms_file.table("SOURCE"), "DIRECTION");
+  auto const original = directions.row(*source_ids.begin());
+  for(auto const other : source_ids)
+    if(not directions.row(other).isApprox(original, tolerance))
+      throw std::runtime_error("Found more than one direction");
+  return original;
+}
+
+//! Chunks decoded by the reader thread of read_measurementset and not yet consumed
+constexpr t_uint queued_chunks = 4;
+
+//! Decodes the selected visibilities of a measurement set, a chunk of rows at a time
+class ChunkReader {
+public:
+  ChunkReader(std::string const &filename,
+              const MeasurementSet::ChannelWrapper::polarization polarization,
+              const std::vector<t_int> &channels_input, std::string const &filter)
+      : ms_file_(filename), selection_(select_visibilities(ms_file_, channels_input, filter)),
+        frequencies_(spectral_window(ms_file_, "CHAN_FREQ")),
+        widths_(spectral_window(ms_file_, "CHAN_WIDTH")),
+        spectral_windows_(table_column<::casacore::Int>(ms_file_.table("DATA_DESCRIPTION"),
+                                                        "SPECTRAL_WINDOW_ID")),
+        name_(polarization_name(polarization)) {
+    // SIGMA of Stokes parameters is rescaled, as in the per channel reader this replaces
+    bool const is_stokes = polarization == MeasurementSet::ChannelWrapper::polarization::I
+                           or polarization == MeasurementSet::ChannelWrapper::polarization::Q
+                           or polarization == MeasurementSet::ChannelWrapper::polarization::U
+                           or polarization == MeasurementSet::ChannelWrapper::polarization::V;
+    sigma_factor_ = is_stokes ? std::sqrt(2) * 2 : 1;
+  }
+
+  //! Number of visibilities
+  t_uint size() const { return selection_.size(); }
+  t_uint chunks() const { return selection_.chunks(); }
+  MeasurementSet const &ms_file() const { return ms_file_; }
+  //! Fields of the chunks read so far
+  std::set<::casacore::Int> const &fields() const { return fields_; }
+  //! Average frequency in MHz of the chunks read so far, weighted by channel width
+  t_real average_frequency() const { return frequency_sum_ / width_sum_ / 1e6; }
+
+  //! \brief Visibilities of a chunk of rows, one piece per selected channel
+  //! \details Each piece is paired with the index of its first visibility in the output. A single
+  //! query for the polarisation of DATA and SIGMA, which mscal.stokes computes from the CORR_TYPE
+  //! of the POLARIZATION table.
+  std::vector<std::pair<t_uint, utilities::vis_params>> read(t_uint chunk) {
+    instrumentation::ScopedEvent const event("read_chunk");
+    auto const start = chunk * chunk_rows;
+    auto const nrows = std::min<t_uint>(chunk_rows, selection_.table.nrow() - start);
+    auto const slicer = row_slicer(start, nrows);
+    auto const uvw = ::casacore::ArrayColumn<::casacore::Double>(selection_.table, "UVW")
+                         .getColumnRange(slicer);
+    auto const data_desc_ids
+        = ::casacore::ScalarColumn<::casacore::Int>(selection_.table, "DATA_DESC_ID")
+              .getColumnRange(slicer);
+    auto const field_ids = ::casacore::ScalarColumn<::casacore::Int>(selection_.table, "FIELD_ID")
+                               .getColumnRange(slicer);
+    std::ostringstream sstr;
+    sstr << "USING STYLE PYTHON SELECT mscal.stokes(DATA, '" << name_
+         << "') as D, mscal.stokes(SIGMA, '" << name_ << "') as S FROM $1 LIMIT " << nrows
+         << " OFFSET " << start;
+    auto const stokes = ::casacore::tableCommand(sstr.str(), selection_.table).table();
+    auto const data = complex_values(stokes, "D");
+    auto const sigma = real_values(stokes, "S");
+    // one value per channel for each row, and one sigma per row
+    t_uint const data_stride = data.size() / nrows;
+    t_uint const sigma_stride = sigma.size() / nrows;
+
+    t_uint const nchannels = selection_.channels.size();
+    for(t_uint i = 0; i < nrows; ++i) {
+      auto const first = selection_.valid.begin() + (start + i) * nchannels;
+      if(std::find(first, first + nchannels, true) != first + nchannels)
+        fields_.insert(field_ids.data()[i]);
+    }
+    std::vector<std::pair<t_uint, utilities::vis_params>> pieces;
+    for(t_uint c = 0; c < nchannels; ++c) {
+      t_uint const size = selection_.counts[chunk * nchannels + c];
+      if(size == 0)
+        continue;
+      pieces.emplace_back(selection_.firsts[chunk * nchannels + c], utilities::vis_params());
+      auto &uv_data = pieces.back().second;
+      uv_data.u = Vector<t_real>(size);
+      uv_data.v = Vector<t_real>(size);
+      uv_data.w = Vector<t_real>(size);
+      uv_data.vis = Vector<t_complex>(size);
+      uv_data.weights = Vector<t_complex>(size);
+      auto const channel = selection_.channels[c];
+      t_uint row = 0;
+      for(t_uint i = 0; i < nrows; ++i) {
+        if(not selection_.valid[(start + i) * nchannels + c])
+          continue;
+        t_uint const window = spectral_windows_(data_desc_ids.data()[i]);
+        t_real const frequency = frequencies_(window, channel);
+        uv_data.u(row) = uvw.data()[3 * i] * frequency / constant::c;
+        uv_data.v(row) = -uvw.data()[3 * i + 1] * frequency / constant::c;
+        uv_data.w(row) = uvw.data()[3 * i + 2] * frequency / constant::c;
+        uv_data.vis(row) = data[i * data_stride + channel];
+        uv_data.weights(row) = 1. / (sigma[i * sigma_stride] * sigma_factor_);
+        frequency_sum_ += frequency * widths_(window, channel);
+        width_sum_ += widths_(window, channel);
+        ++row;
+      }
+    }
+    return pieces;
+  }
+
+protected:
+  MeasurementSet ms_file_;
+  Selection selection_;
+  Matrix<t_real> frequencies_;
+  Matrix<t_real> widths_;
+  Matrix<::casacore::Int> spectral_windows_;
+  std::string name_;
+  t_real sigma_factor_;
+  std::set<::casacore::Int> fields_;
+  t_real frequency_sum_ = 0;
+  t_real width_sum_ = 0;
+};
+}
+
 std::string const MeasurementSet::default_filter = "WHERE NOT ANY(FLAG)";
 MeasurementSet &MeasurementSet::filename(std::string const &filename) {
   clear();
@@ -106,21 +387,9 @@ Vector<t_real> MeasurementSet::ChannelWrapper::raw_spectral_window(std::string c
 MeasurementSet::Direction
 MeasurementSet::direction(t_real tolerance, std::string const &filter) const {
   auto const field_ids_raw = column<::casacore::Int>("FIELD_ID", filter);
-  auto const source_ids_raw = table_column<::casacore::Int>(table("FIELD"), "SOURCE_ID");
-  std::set<::casacore::Int> source_ids;
-  for(Eigen::DenseIndex i(0); i < field_ids_raw.size(); ++i) {
-    assert(field_ids_raw(i) < source_ids_raw.size());
-    source_ids.insert(source_ids_raw(field_ids_raw(i)));
-  }
-  if(source_ids.size() == 0)
-    throw std::runtime_error("Could not find sources. Cannot determine direction");
-  auto const directions = table_column<::casacore::Double>(table("SOURCE"), "DIRECTION");
-  auto const original = directions.row(*source_ids.begin());
-  for(auto const other : source_ids)
-    if(not directions.row(other).isApprox(original, tolerance))
-      throw std::runtime_error("Found more than one direction");
-
-  return original;
+  std::set<::casacore::Int> const field_ids(field_ids_raw.data(),
+                                            field_ids_raw.data() + field_ids_raw.size());
+  return fields_direction(*this, field_ids, tolerance);
 }
 
 MeasurementSet::const_iterator &MeasurementSet::const_iterator::operator++() {
@@ -144,124 +413,149 @@ utilities::vis_params
 read_measurementset(std::string const &filename,
                     const MeasurementSet::ChannelWrapper::polarization polarization,
                     const std::vector<t_int> &channels_input, std::string const &filter) {
+  return read_measurementset(filename, nullptr, polarization, channels_input, filter);
+}
+
+utilities::vis_params
+read_measurementset(std::string const &filename, ChunkConsumer const &consumer,
+                    const MeasurementSet::ChannelWrapper::polarization polarization,
+                    const std::vector<t_int> &channels_input, std::string const &filter) {
+  /*
+    A reader thread decodes chunks of rows into a short queue, while this thread copies them into
+    the output and hands them to the consumer, e.g. to build the measurement operator. Each chunk
+    comes as one piece per channel, contiguous in the output. casacore
+    tables are not safe to read from several threads, so all reading happens in one. Exceptions of
+    the reader are rethrown here, once it has stopped.
+  */
+  ChunkReader reader(filename, polarization, channels_input, filter);
+  auto const rows = reader.size();
+  PURIFY_LOW_LOG("Visibilities = {}", rows);
+  if(rows == 0)
+    throw std::runtime_error("No unflagged visibilities in " + filename);
 
-  auto const ms_file = purify::casa::MeasurementSet(filename);
   utilities::vis_params uv_data;
-  t_uint rows = 0;
-  std::vector<t_int> channels = channels_input;
-  if(channels.empty()) {
-    PURIFY_LOW_LOG("All Channels = {}", ms_file.size());
-    Vector<t_int> temp_vector = Vector<t_int>::Zero(ms_file.size());
-    channels = std::vector<t_int>(temp_vector.data(), temp_vector.data() + temp_vector.size());
-  }
+  uv_data.u = Vector<t_real>(rows);
+  uv_data.v = Vector<t_real>(rows);
+  uv_data.w = Vector<t_real>(rows);
+  uv_data.vis = Vector<t_complex>(rows);
+  uv_data.weights = Vector<t_complex>::Zero(rows);
 
-  // counting number of rows
-  for(auto channel_number : channels) {
-    rows += ms_file[channel_number].size();
-  }
+  std::mutex mutex;
+  std::condition_variable changed;
+  typedef std::vector<std::pair<t_uint, utilities::vis_params>> t_pieces;
+  std::deque<t_pieces> queue;
+  bool finished = false;
+  bool stop = false;
+  std::exception_ptr error;
+  std::thread producer([&]() {
+    try {
+      for(t_uint chunk = 0; chunk < reader.chunks(); ++chunk) {
+        auto decoded = reader.read(chunk);
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return stop or queue.size() < queued_chunks; });
+        if(stop)
+          break;
+        queue.push_back(std::move(decoded));
+        changed.notify_all();
+      }
+    } catch(...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = true;
+    changed.notify_all();
+  });
 
-  PURIFY_LOW_LOG("Visibilities = {}", rows);
-  uv_data.u = Vector<t_real>::Zero(rows);
-  uv_data.v = Vector<t_real>::Zero(rows);
-  uv_data.w = Vector<t_real>::Zero(rows);
-  uv_data.vis = Vector<t_complex>::Zero(rows);
-  uv_data.weights = Vector<t_complex>::Zero(rows);
-  uv_data.ra = ms_file[channels[0]].right_ascension(); // convert directions from radians to degrees
-  uv_data.dec = ms_file[channels[0]].declination();
-  // calculate average frequency
-  uv_data.average_frequency = average_frequency(ms_file, filter, channels);
+  try {
+    while(true) {
+      t_pieces pieces;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return finished or not queue.empty(); });
+        if(queue.empty())
+          break;
+        pieces = std::move(queue.front());
+        queue.pop_front();
+        changed.notify_all();
+      }
+      for(auto const &piece : pieces) {
+        auto const first = piece.first;
+        auto const n = piece.second.u.size();
+        uv_data.u.segment(first, n) = piece.second.u;
+        uv_data.v.segment(first, n) = piece.second.v;
+        uv_data.w.segment(first, n) = piece.second.w;
+        uv_data.vis.segment(first, n) = piece.second.vis;
+        uv_data.weights.segment(first, n) = piece.second.weights;
+        if(consumer) {
+          instrumentation::ScopedEvent const event("consume_chunk");
+          consumer(piece.second, first);
+        }
+      }
+    }
+  } catch(...) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+      changed.notify_all();
+    }
+    producer.join();
+    throw;
+  }
+  producer.join();
+  if(error)
+    std::rethrow_exception(error);
 
-  // add data to channel
-  t_uint row = 0;
+  auto const direction = fields_direction(reader.ms_file(), reader.fields());
+  uv_data.ra = direction(0);
+  uv_data.dec = direction(1);
+  uv_data.average_frequency = reader.average_frequency();
+  return uv_data;
+}
 
-  for(auto channel_number : channels) {
+averaging::sample_params read_measurementset_samples(std::string const &filename,
+                                                     const std::vector<t_int> &channels_input,
+                                                     std::string const &filter) {
+  auto const ms_file = purify::casa::MeasurementSet(filename);
+  auto const selection = select_visibilities(ms_file, channels_input, filter);
+  auto const frequencies = spectral_window(ms_file, "CHAN_FREQ");
+  auto const spectral_windows
+      = table_column<::casacore::Int>(ms_file.table("DATA_DESCRIPTION"), "SPECTRAL_WINDOW_ID");
+  t_uint const nchannels = selection.channels.size();
 
-    auto const channel = ms_file[channel_number];
-    if(uv_data.ra != channel.right_ascension() or uv_data.dec != channel.declination())
-      throw std::runtime_error("Channels contain multiple pointings.");
-
-    uv_data.u.segment(row, channel.size()) = channel.lambda_u();
-    uv_data.v.segment(row, channel.size()) = -channel.lambda_v();
-    uv_data.w.segment(row, channel.size()) = channel.lambda_w();
-    t_real const the_casa_factor = std::sqrt(2) * 2;
-    switch(polarization) {
-    case MeasurementSet::ChannelWrapper::polarization::I:
-      uv_data.vis.segment(row, channel.size()) = channel.I("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wI(MeasurementSet::ChannelWrapper::Sigma::OVERALL)
-            * the_casa_factor; // go for sigma rather than sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::Q:
-      uv_data.vis.segment(row, channel.size()) = channel.Q("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wQ(MeasurementSet::ChannelWrapper::Sigma::OVERALL)
-            * the_casa_factor; // go for sigma rather than sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::U:
-      uv_data.vis.segment(row, channel.size()) = channel.U("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wU(MeasurementSet::ChannelWrapper::Sigma::OVERALL)
-            * the_casa_factor; // go for sigma rather than sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::V:
-      uv_data.vis.segment(row, channel.size()) = channel.V("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wV(MeasurementSet::ChannelWrapper::Sigma::OVERALL)
-            * the_casa_factor; // go for sigma rather than sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::LL:
-      uv_data.vis.segment(row, channel.size()) = channel.LL("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wLL(MeasurementSet::ChannelWrapper::Sigma::OVERALL); // go for sigma rather than
-                                                                         // sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::LR:
-      uv_data.vis.segment(row, channel.size()) = channel.LR("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wRL(MeasurementSet::ChannelWrapper::Sigma::OVERALL); // go for sigma rather than
-                                                                         // sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::RL:
-      uv_data.vis.segment(row, channel.size()) = channel.RL("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wRL(MeasurementSet::ChannelWrapper::Sigma::OVERALL); // go for sigma rather than
-                                                                         // sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::RR:
-      uv_data.vis.segment(row, channel.size()) = channel.RR("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wRR(MeasurementSet::ChannelWrapper::Sigma::OVERALL); // go for sigma rather than
-                                                                         // sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::XX:
-      uv_data.vis.segment(row, channel.size()) = channel.XX("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wXX(MeasurementSet::ChannelWrapper::Sigma::OVERALL); // go for sigma rather than
-                                                                         // sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::XY:
-      uv_data.vis.segment(row, channel.size()) = channel.XY("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wXY(MeasurementSet::ChannelWrapper::Sigma::OVERALL); // go for sigma rather than
-                                                                         // sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::YX:
-      uv_data.vis.segment(row, channel.size()) = channel.YX("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wYX(MeasurementSet::ChannelWrapper::Sigma::OVERALL); // go for sigma rather than
-                                                                         // sigma_spectrum
-      break;
-    case MeasurementSet::ChannelWrapper::polarization::YY:
-      uv_data.vis.segment(row, channel.size()) = channel.YY("DATA");
-      uv_data.weights.segment(row, channel.size()).real()
-          = channel.wYY(MeasurementSet::ChannelWrapper::Sigma::OVERALL); // go for sigma rather than
-                                                                         // sigma_spectrum
-      break;
+  averaging::sample_params samples;
+  samples.antenna1 = Vector<t_int>(selection.size());
+  samples.antenna2 = Vector<t_int>(selection.size());
+  samples.time = Vector<t_real>(selection.size());
+  samples.frequency = Vector<t_real>(selection.size());
+  for(t_uint chunk = 0; chunk < selection.chunks(); ++chunk) {
+    auto const start = chunk * chunk_rows;
+    auto const nrows = std::min<t_uint>(chunk_rows, selection.table.nrow() - start);
+    auto const slicer = row_slicer(start, nrows);
+    auto const antenna1 = ::casacore::ScalarColumn<::casacore::Int>(selection.table, "ANTENNA1")
+                              .getColumnRange(slicer);
+    auto const antenna2 = ::casacore::ScalarColumn<::casacore::Int>(selection.table, "ANTENNA2")
+                              .getColumnRange(slicer);
+    auto const time = ::casacore::ScalarColumn<::casacore::Double>(selection.table, "TIME")
+                          .getColumnRange(slicer);
+    auto const data_desc_ids
+        = ::casacore::ScalarColumn<::casacore::Int>(selection.table, "DATA_DESC_ID")
+              .getColumnRange(slicer);
+    for(t_uint c = 0; c < nchannels; ++c) {
+      t_uint row = selection.firsts[chunk * nchannels + c];
+      for(t_uint i = 0; i < nrows; ++i) {
+        if(not selection.valid[(start + i) * nchannels + c])
+          continue;
+        samples.antenna1(row) = antenna1.data()[i];
+        samples.antenna2(row) = antenna2.data()[i];
+        samples.time(row) = time.data()[i];
+        samples.frequency(row)
+            = frequencies(spectral_windows(data_desc_ids.data()[i]), selection.channels[c]);
+        ++row;
+      }
     }
-    row += channel.size();
   }
-  uv_data.weights = 1. / uv_data.weights.array();
-  return uv_data;
+  return samples;
 }
 
 t_real average_frequency(const purify::casa::MeasurementSet &ms_file, std::string const &filter,
@@ -280,6 +574,19 @@ t_real average_frequency(const purify::casa::MeasurementSet &ms_file, std::strin
   return frequency_sum / width_sum / 1e6;
 }
 
+MeasurementSet::ChannelWrapper::polarization polarization(std::string const &name) {
+  typedef MeasurementSet::ChannelWrapper::polarization polarization;
+  std::map<std::string, polarization> const names{
+      {"i", polarization::I},   {"q", polarization::Q},   {"u", polarization::U},
+      {"v", polarization::V},   {"xx", polarization::XX}, {"yy", polarization::YY},
+      {"xy", polarization::XY}, {"yx", polarization::YX}, {"ll", polarization::LL},
+      {"rr", polarization::RR}, {"lr", polarization::LR}, {"rl", polarization::RL}};
+  std::string lower = name;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+  auto const found = names.find(lower);
+  return found == names.end() ? polarization::I : found->second;
+}
+
 t_uint MeasurementSet::ChannelWrapper::size() const {
   if(ms_.table().nrow() == 0)
     return 0;
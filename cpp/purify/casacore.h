@@ -3,6 +3,7 @@
 
 #include "purify/config.h"
 #include <exception>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -13,6 +14,7 @@
 #include <casacore/tables/Tables/ScalarColumn.h>
 #include <casacore/tables/Tables/Table.h>
 #include <sopt/utilities.h>
+#include "purify/averaging.h"
 #include "purify/types.h"
 #include "purify/utilities.h"
 
@@ -238,6 +240,12 @@ public:
   Vector<t_int> field_ids() const { return ms_.column<t_int>("FIELD_ID", filter()); }
   //! DATA_DESC_ID from table MAIN
   Vector<t_int> data_desc_id() const { return ms_.column<t_int>("DATA_DESC_ID", filter()); }
+  //! ANTENNA1 from table MAIN
+  Vector<t_int> antenna1() const { return ms_.column<t_int>("ANTENNA1", filter()); }
+  //! ANTENNA2 from table MAIN
+  Vector<t_int> antenna2() const { return ms_.column<t_int>("ANTENNA2", filter()); }
+  //! TIME from table MAIN, in seconds
+  Vector<t_real> time() const { return ms_.column<t_real>("TIME", filter()); }
 
   //! Direction (RA, DEC) in radian
   Direction direction(t_real tolerance = 1e-8) const { return ms_.direction(tolerance, filter()); }
@@ -357,15 +365,41 @@ protected:
   std::string const filter_;
   std::shared_ptr<value_type> wrapper_;
 };
-//! Read measurement set into vis_params structure
+//! \brief Read measurement set into vis_params structure
+//! \details Reads the main table once, a chunk of rows at a time. Visibilities are ordered by
+//! channel, then by row, as read by MeasurementSet::ChannelWrapper. A visibility is kept if its
+//! channel is unflagged in every polarisation. The filter is a TaQL clause on the rows, of the same
+//! form as MeasurementSet::default_filter, e.g. "WHERE FIELD_ID == 0". The average frequency is in
+//! MHz, weighted by channel width, as computed by average_frequency.
 utilities::vis_params read_measurementset(std::string const &filename,
                                           const MeasurementSet::ChannelWrapper::polarization pol
                                           = MeasurementSet::ChannelWrapper::polarization::I,
                                           const std::vector<t_int> &channels = std::vector<t_int>(),
                                           std::string const &filter = "");
-//! Return average frequency over channels
+//! Called with each chunk of visibilities and the index of its first visibility in the output
+typedef std::function<void(utilities::vis_params const &chunk, t_uint first)> ChunkConsumer;
+//! \brief Read measurement set into vis_params structure, handing out chunks as they are read
+//! \details Same output as read_measurementset, but a separate thread reads ahead while the
+//! consumer works on the chunks already read. Each chunk of rows is handed out as one piece per
+//! channel, contiguous in the output. Pieces have their coordinates in units of lambda, and no
+//! direction or average frequency.
+utilities::vis_params read_measurementset(std::string const &filename,
+                                          ChunkConsumer const &consumer,
+                                          const MeasurementSet::ChannelWrapper::polarization pol
+                                          = MeasurementSet::ChannelWrapper::polarization::I,
+                                          const std::vector<t_int> &channels = std::vector<t_int>(),
+                                          std::string const &filter = "");
+//! \brief Read baseline, time and frequency of each visibility
+//! \details Visibilities are in the same order as returned by read_measurementset
+averaging::sample_params read_measurementset_samples(std::string const &filename,
+                                                     const std::vector<t_int> &channels
+                                                     = std::vector<t_int>(),
+                                                     std::string const &filter = "");
+//! Average frequency in MHz over the unflagged visibilities of the channels, weighted by width
 t_real average_frequency(const purify::casa::MeasurementSet &ms_file, std::string const &filter,
                          const std::vector<t_int> &channels);
+//! Polarisation from its name, e.g. "I" or "xx", Stokes I if the name is not known
+MeasurementSet::ChannelWrapper::polarization polarization(std::string const &name);
 
 inline MeasurementSet::const_iterator operator+(MeasurementSet::const_iterator::difference_type n,
                                                 MeasurementSet::const_iterator const &c) {
@@ -0,0 +1,248 @@
+#include "purify/config.h"
+#include "purify/checkpoint.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+#include "purify/logging.h"
+
+namespace purify {
+namespace checkpoint {
+namespace {
+//! Header at the start of a checkpoint
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  //! 0x01020304 as written, to catch files from a machine of different endianness
+  std::uint32_t byte_order;
+  std::uint64_t iteration;
+  double gamma;
+  //! Sizes of x, of residual, lambda and z, and of l1_weights
+  std::uint64_t sizes[3];
+  std::uint64_t fingerprint;
+};
+static_assert(sizeof(Header) == 64, "The header of checkpoints is 64 bytes");
+constexpr char magic[8] = {'P', 'U', 'R', 'I', 'F', 'Y', 'C', 'P'};
+constexpr std::uint32_t version = 2;
+constexpr std::uint32_t byte_order = 0x01020304;
+
+constexpr std::uint64_t fnv_offset = 14695981039346656037ull;
+
+//! FNV-1a hash, to catch files that were altered or truncated
+std::uint64_t
+checksum(const char *data, const std::size_t &size, std::uint64_t hash = fnv_offset) {
+  for(std::size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+template <class T> void append(std::vector<char> &buffer, const T *data, const std::size_t &size) {
+  auto const bytes = reinterpret_cast<const char *>(data);
+  buffer.insert(buffer.end(), bytes, bytes + size * sizeof(T));
+}
+
+template <class VECTOR>
+void extract(VECTOR &vector, const std::vector<char> &buffer, std::size_t &offset,
+             const std::uint64_t &size) {
+  typedef typename VECTOR::Scalar Scalar;
+  vector.resize(size);
+  std::memcpy(vector.data(), buffer.data() + offset, size * sizeof(Scalar));
+  offset += size * sizeof(Scalar);
+}
+
+void swap(SolverState &a, SolverState &b) {
+  // Eigen 3.2 has no move assignment, swapping hands the buffers over without a copy
+  std::swap(a.iteration, b.iteration);
+  std::swap(a.gamma, b.gamma);
+  a.x.swap(b.x);
+  a.residual.swap(b.residual);
+  a.lambda.swap(b.lambda);
+  a.z.swap(b.z);
+  a.l1_weights.swap(b.l1_weights);
+  std::swap(a.fingerprint, b.fingerprint);
+}
+}
+
+Fingerprint::Fingerprint() : hash_(fnv_offset) {}
+
+Fingerprint &Fingerprint::bytes(const void *data, const std::size_t &size) {
+  hash_ = checksum(static_cast<const char *>(data), size, hash_);
+  return *this;
+}
+
+void write(const SolverState &state, const std::string &file_name) {
+  if(state.lambda.size() != state.residual.size() or state.z.size() != state.residual.size())
+    throw std::runtime_error("Dual variables of the solver state do not match its residual.");
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::copy(magic, magic + sizeof(magic), header.magic);
+  header.version = version;
+  header.byte_order = byte_order;
+  header.iteration = state.iteration;
+  header.gamma = state.gamma;
+  header.sizes[0] = state.x.size();
+  header.sizes[1] = state.residual.size();
+  header.sizes[2] = state.l1_weights.size();
+  header.fingerprint = state.fingerprint;
+
+  std::vector<char> buffer;
+  append(buffer, &header, 1);
+  append(buffer, state.x.data(), state.x.size());
+  append(buffer, state.residual.data(), state.residual.size());
+  append(buffer, state.lambda.data(), state.lambda.size());
+  append(buffer, state.z.data(), state.z.size());
+  append(buffer, state.l1_weights.data(), state.l1_weights.size());
+  std::uint64_t const hash = checksum(buffer.data(), buffer.size());
+  append(buffer, &hash, 1);
+
+  /*
+    The data reaches the disk before the rename, so that a crash leaves either the old or the new
+    checkpoint in place.
+  */
+  std::string const temporary = file_name + ".tmp";
+  auto const file = std::fopen(temporary.c_str(), "wb");
+  if(file == nullptr)
+    throw std::runtime_error("Could not open " + temporary);
+  bool const written = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size()
+                       and std::fflush(file) == 0 and fsync(fileno(file)) == 0;
+  if(std::fclose(file) != 0 or not written) {
+    std::remove(temporary.c_str());
+    throw std::runtime_error("Could not write the checkpoint " + temporary);
+  }
+  if(std::rename(temporary.c_str(), file_name.c_str()) != 0)
+    throw std::runtime_error("Could not replace the checkpoint " + file_name);
+  PURIFY_LOW_LOG("Wrote checkpoint of iteration {} to {}", state.iteration, file_name);
+}
+
+SolverState read(const std::string &file_name) {
+  std::ifstream file(file_name, std::ios::binary);
+  if(not file)
+    throw std::runtime_error("Could not open " + file_name);
+  std::vector<char> const buffer((std::istreambuf_iterator<char>(file)),
+                                 std::istreambuf_iterator<char>());
+  Header header;
+  if(buffer.size() < sizeof(header) + sizeof(std::uint64_t))
+    throw std::runtime_error(file_name + " is not a checkpoint");
+  std::memcpy(&header, buffer.data(), sizeof(header));
+  if(not std::equal(magic, magic + sizeof(magic), header.magic))
+    throw std::runtime_error(file_name + " is not a checkpoint");
+  if(header.byte_order != byte_order)
+    throw std::runtime_error(file_name + " was written on a machine of different endianness");
+  if(header.version != version)
+    throw std::runtime_error("Unknown version " + std::to_string(header.version) + " of "
+                             + file_name);
+  // sizes are checked one by one, so that corrupted sizes cannot overflow the total
+  std::uint64_t remaining = buffer.size() - sizeof(header) - sizeof(std::uint64_t);
+  std::uint64_t const columns[5] = {header.sizes[0], header.sizes[1], header.sizes[1],
+                                    header.sizes[1], header.sizes[2]};
+  std::uint64_t const scalars[5] = {sizeof(t_complex), sizeof(t_complex), sizeof(t_complex),
+                                    sizeof(t_complex), sizeof(t_real)};
+  for(t_int i = 0; i < 5; ++i) {
+    if(columns[i] > remaining / scalars[i])
+      throw std::runtime_error(file_name + " is truncated or corrupted");
+    remaining -= columns[i] * scalars[i];
+  }
+  if(remaining != 0)
+    throw std::runtime_error(file_name + " is truncated or corrupted");
+  std::uint64_t hash;
+  std::memcpy(&hash, buffer.data() + buffer.size() - sizeof(hash), sizeof(hash));
+  if(hash != checksum(buffer.data(), buffer.size() - sizeof(hash)))
+    throw std::runtime_error(file_name + " is corrupted");
+
+  SolverState state;
+  state.iteration = header.iteration;
+  state.gamma = header.gamma;
+  state.fingerprint = header.fingerprint;
+  std::size_t offset = sizeof(header);
+  extract(state.x, buffer, offset, header.sizes[0]);
+  extract(state.residual, buffer, offset, header.sizes[1]);
+  extract(state.lambda, buffer, offset, header.sizes[1]);
+  extract(state.z, buffer, offset, header.sizes[1]);
+  extract(state.l1_weights, buffer, offset, header.sizes[2]);
+  return state;
+}
+
+Writer::Writer(const std::string &file_name) : file_name_(file_name) {
+  thread_ = std::thread(&Writer::run, this);
+}
+
+Writer::~Writer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  thread_.join();
+  if(error_) {
+    try {
+      std::rethrow_exception(error_);
+    } catch(std::exception const &e) {
+      PURIFY_ERROR("Could not write checkpoint: {}", e.what());
+    } catch(...) {
+      PURIFY_ERROR("Could not write checkpoint");
+    }
+  }
+}
+
+void Writer::write(const SolverState &state) {
+  // copied before taking the lock, so the background thread is not held up
+  SolverState copy = state;
+  std::lock_guard<std::mutex> lock(mutex_);
+  rethrow();
+  swap(pending_, copy);
+  has_pending_ = true;
+  changed_.notify_all();
+}
+
+void Writer::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return (not has_pending_ and not writing_) or error_; });
+  rethrow();
+}
+
+t_uint Writer::written() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_;
+}
+
+void Writer::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while(true) {
+    changed_.wait(lock, [this]() { return stop_ or has_pending_; });
+    if(not has_pending_)
+      return;
+    SolverState state;
+    swap(state, pending_);
+    has_pending_ = false;
+    writing_ = true;
+    lock.unlock();
+    try {
+      checkpoint::write(state, file_name_);
+      lock.lock();
+      ++written_;
+    } catch(...) {
+      lock.lock();
+      if(not error_)
+        error_ = std::current_exception();
+    }
+    writing_ = false;
+    changed_.notify_all();
+  }
+}
+
+void Writer::rethrow() {
+  if(not error_)
+    return;
+  auto const error = error_;
+  error_ = nullptr;
+  std::rethrow_exception(error);
+}
+}
+}
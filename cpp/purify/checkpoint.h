@@ -0,0 +1,97 @@
+#ifndef PURIFY_CHECKPOINT_H
+#define PURIFY_CHECKPOINT_H
+
+#include "purify/config.h"
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "purify/types.h"
+
+namespace purify {
+
+//! \brief Binary checkpoints of the state of the solver
+//! \details A file holds a 64 byte header, the vectors of the state in native byte order, and a
+//! checksum of all that precedes it. Files are written to a temporary file which is then renamed,
+//! so a checkpoint is either the previous one or the new one, never a partial file.
+namespace checkpoint {
+//! Everything PADMM needs to carry on exactly where it stopped
+struct SolverState {
+  //! Iterations done so far
+  t_uint iteration = 0;
+  //! Step size, which can be adapted during the first iterations
+  t_real gamma = 0;
+  //! Image
+  Vector<t_complex> x;
+  //! Residual of the data
+  Vector<t_complex> residual;
+  //! Dual variables of the l2 ball constraint
+  Vector<t_complex> lambda;
+  Vector<t_complex> z;
+  //! Weights of the l1 norm set by reweighting, empty when not reweighting
+  Vector<t_real> l1_weights;
+  //! Fingerprint of the run the state belongs to
+  std::uint64_t fingerprint = 0;
+};
+
+//! \brief Hash of the inputs of a run
+//! \details A checkpoint whose fingerprint differs comes from another run, even if its sizes match.
+class Fingerprint {
+public:
+  Fingerprint();
+  Fingerprint &operator()(t_real const &value) { return bytes(&value, sizeof(value)); }
+  template <class T> Fingerprint &operator()(Vector<T> const &values) {
+    return bytes(values.data(), values.size() * sizeof(T));
+  }
+  std::uint64_t value() const { return hash_; }
+
+protected:
+  std::uint64_t hash_;
+  Fingerprint &bytes(const void *data, const std::size_t &size);
+};
+
+//! Writes a checkpoint atomically
+void write(const SolverState &state, const std::string &file_name);
+//! Reads a checkpoint, throws if it is corrupted or from an incompatible machine
+SolverState read(const std::string &file_name);
+
+//! \brief Writes checkpoints on a background thread
+//! \details Only the latest state is kept: a state queued before the previous one was written
+//! replaces it.
+class Writer {
+public:
+  Writer(const std::string &file_name);
+  //! Writes what is still waiting
+  ~Writer();
+  Writer(const Writer &) = delete;
+  Writer &operator=(const Writer &) = delete;
+
+  //! Queues a copy of the state
+  void write(const SolverState &state);
+  //! Waits until the queued state is written
+  void flush();
+  //! Number of checkpoints written
+  t_uint written() const;
+
+protected:
+  std::string const file_name_;
+  SolverState pending_;
+  bool has_pending_ = false;
+  bool writing_ = false;
+  bool stop_ = false;
+  t_uint written_ = 0;
+  std::exception_ptr error_;
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::thread thread_;
+
+  //! Loop of the background thread
+  void run();
+  //! Rethrows an error of the background thread, with the lock held
+  void rethrow();
+};
+}
+}
+#endif
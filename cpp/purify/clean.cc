@@ -1,66 +1,383 @@
 #include "purify/config.h"
 #include "purify/clean.h"
+#include <algorithm>
+#include <memory>
+#include "purify/DFTOperator.h"
+#include "purify/convolution.h"
+#include "purify/instrumentation.h"
 #include "purify/logging.h"
 
 namespace purify {
 
 namespace clean {
+namespace {
+//! Fraction of the peak below which the restoring beam is cropped
+constexpr t_real beam_threshold = 1e-6;
+
+t_int clark_minor_cycle(Image<t_complex> &res_image, Image<t_complex> &cycle_model,
+                        const Image<t_complex> &psf, const convolution::Kernel &psf_kernel,
+                        const t_real &threshold, const t_real &gain, const t_int &half_patch,
+                        const t_int &max_components) {
+  /*
+          Clark minor cycle. Components are found among the active pixels only, and subtracted from
+          them with a truncated psf. The components are then removed from the whole residual image
+          with a single fft convolution. Returns the number of components.
+  */
+  instrumentation::ScopedEvent const event("clark_minor_cycle");
+  t_int const y_centre = psf.rows() / 2;
+  t_int const x_centre = psf.cols() / 2;
+  t_complex const psf_peak = psf(y_centre, x_centre);
+  t_int const y_half
+      = std::min({half_patch, y_centre, static_cast<t_int>(psf.rows() - 1 - y_centre)});
+  t_int const x_half
+      = std::min({half_patch, x_centre, static_cast<t_int>(psf.cols() - 1 - x_centre)});
+  std::vector<t_int> active;
+  for(t_int j = 0; j < res_image.size(); ++j)
+    if(std::abs(res_image(j)) >= threshold)
+      active.push_back(j);
+  Vector<t_complex> values(active.size());
+  for(std::size_t a = 0; a < active.size(); ++a)
+    values(a) = res_image(active[a]);
+
+  Image<t_complex> components = Image<t_complex>::Zero(res_image.rows(), res_image.cols());
+  t_int n = 0;
+  for(; n < max_components and values.size() > 0; ++n) {
+    t_int strongest;
+    if(values.cwiseAbs2().maxCoeff(&strongest) < threshold * threshold)
+      break;
+    t_int const y = active[strongest] % res_image.rows();
+    t_int const x = active[strongest] / res_image.rows();
+    t_complex const component = gain * values(strongest) / psf_peak;
+    components(y, x) += component;
+    for(std::size_t a = 0; a < active.size(); ++a) {
+      t_int const dy = active[a] % res_image.rows() - y;
+      t_int const dx = active[a] / res_image.rows() - x;
+      if(std::abs(dy) <= y_half and std::abs(dx) <= x_half)
+        values(a) -= component * psf(y_centre + dy, x_centre + dx);
+    }
+  }
+  cycle_model += components;
+  res_image -= psf_kernel(components);
+  return n;
+}
+}
+
 Image<t_complex> clean(MeasurementOperator &op, const utilities::vis_params &uv_vis,
                        const t_int &niters, const t_real &gain, const std::string &mode,
-                       const t_real clip) {
+                       const t_real clip, const t_real cycle_fraction, const t_int patch_size) {
   /*
-          hogbom and sdi clean algorithm
+          hogbom, clark and sdi clean algorithm, with major and minor cycles
+
+          Minor cycles work on the residual image only, subtracting shifted copies of the point
+          spread function. The visibilities are only used in the major cycle, to compute the
+          residual image of the accumulated model exactly.
   */
+  instrumentation::ScopedEvent const event("clean");
+  if(mode == "multiscale")
+    return clean::multiscale_clean(op, uv_vis, niters, {0, 2, 4, 8}, gain, cycle_fraction);
+  if((mode == "clark" or mode == "steer") and (clip <= 0 or clip > 1))
+    throw std::runtime_error("Clip of clean must be in (0, 1].");
   PURIFY_HIGH_LOG("Starting Clean...");
+  Image<t_complex> const psf = clean::point_spread_function(op, uv_vis);
+  t_complex const psf_peak = psf(psf.rows() / 2, psf.cols() / 2);
+  std::unique_ptr<convolution::Kernel> const psf_kernel(
+      mode == "clark" ? new convolution::Kernel(psf, op.imsizey(), op.imsizex()) : nullptr);
+  // cycle models are sparse, their visibilities are cheaper to predict directly
+  DFTOperator const predictor(op, uv_vis);
   Vector<t_complex> residual = uv_vis.vis.array() * uv_vis.weights.array();
-  Image<t_complex> res_image = op.grid(residual);
-  Image<t_complex> clean_model = res_image * 0;
-  Image<t_complex> temp_model = clean_model * 0;
+  Image<t_complex> clean_model = Image<t_complex>::Zero(op.imsizey(), op.imsizex());
+  Image<t_complex> cycle_model = clean_model;
+  Image<t_complex> temp_model = clean_model;
 
   // should add a method to calculate clean sdi clip automatically
-  PURIFY_MEDIUM_LOG("Will run for %d iterations", niters);
-  for(t_int i = 0; i < niters; ++i) {
-    // finding peak in residual image
+  PURIFY_MEDIUM_LOG("Will run for {} iterations", niters);
+  t_int i = 0;
+  t_int major_cycles = 0;
+  while(i < niters) {
+    // major cycle: residual image of the current model from the visibilities
+    Image<t_complex> res_image = op.grid(residual);
     t_int max_x;
     t_int max_y;
-    res_image = op.grid(residual);
-    res_image.abs().maxCoeff(&max_y, &max_x);
-    if(i % 50 == 0)
-      PURIFY_LOW_LOG("Iteration: %d, Max: %f, RMS: %f", i, std::abs(res_image(max_y, max_x)),
-                     utilities::standard_deviation(
-                         Image<t_complex>::Map(res_image.data(), res_image.size(), 1)));
-    // generating clean model
-    if(mode == "hogbom")
-      temp_model(max_y, max_x) = gain * res_image(max_y, max_x);
-
-    if(mode == "steer") {
-      t_real max = std::abs(res_image(max_y, max_x));
-      temp_model = res_image;
-      // clipping residual map for clean model
-      for(t_int i = 0; i < temp_model.size(); ++i) {
-        if(std::abs(temp_model(i)) < max * clip)
-          temp_model(i) = 0;
+    t_real const threshold = cycle_fraction * clean::peak(res_image, max_y, max_x);
+    ++major_cycles;
+    cycle_model.setZero();
+    while(i < niters) {
+      // finding peak in residual image
+      t_real const max = clean::peak(res_image, max_y, max_x);
+      if(max < threshold or max == 0)
+        break;
+      if(i % 50 == 0)
+        PURIFY_LOW_LOG("Iteration: {}, Max: {}, RMS: {}", i, max,
+                       utilities::standard_deviation(
+                           Image<t_complex>::Map(res_image.data(), res_image.size(), 1)));
+      // generating clean model
+      if(mode == "clark") {
+        t_int const components
+            = clark_minor_cycle(res_image, cycle_model, psf, *psf_kernel,
+                                std::max(threshold, clip * max), gain, patch_size / 2, niters - i);
+        // nothing left above the threshold, go back to a major cycle
+        if(components == 0)
+          break;
+        i += components;
+        continue;
+      }
+      if(mode == "hogbom") {
+        t_complex const component = gain * res_image(max_y, max_x) / psf_peak;
+        cycle_model(max_y, max_x) += component;
+        clean::subtract_psf(res_image, psf, component, max_y, max_x);
+      }
+
+      if(mode == "steer") {
+        temp_model = res_image;
+        // clipping residual map for clean model
+        for(t_int j = 0; j < temp_model.size(); ++j) {
+          if(std::abs(temp_model(j)) < max * clip)
+            temp_model(j) = 0;
+        }
+        // dirty image of the clipped model, from shifted copies of the psf
+        Image<t_complex> dirty_model = Image<t_complex>::Zero(op.imsizey(), op.imsizex());
+        for(t_int x = 0; x < temp_model.cols(); ++x)
+          for(t_int y = 0; y < temp_model.rows(); ++y)
+            if(std::abs(temp_model(y, x)) > 0)
+              clean::subtract_psf(dirty_model, psf, -temp_model(y, x), y, x);
+        // need to write in correction factor for beam volume, eta
+        t_complex eta = (res_image * dirty_model.conjugate()).sum()
+                        / (dirty_model * dirty_model.conjugate()).sum();
+        // empirical way to stop a semi-infinite loop, following miriad
+        if(std::abs(eta) > 0 and std::abs(eta) < 0.02)
+          eta = 0.02 * eta / std::abs(eta);
+
+        cycle_model = cycle_model + eta * gain * temp_model;
+        res_image = res_image - eta * gain * dirty_model;
       }
-      // need to write in correction factor for beam volume, eta
-      auto dirty_model = op.grid(op.degrid(temp_model));
-      t_complex eta = (res_image * dirty_model.conjugate()).sum()
-                      / (dirty_model * dirty_model.conjugate()).sum();
-      if(0 < std::abs(eta) < 0.02)
-        eta = 0.02 * eta
-              / std::abs(eta); // imperical way to stop a semi-infinite loop, following miriad
-
-      temp_model = eta * gain * temp_model;
+      ++i;
     }
-    // add components to clean model
-    clean_model = clean_model + temp_model;
-    // subtract model from data
-    residual = residual - (op.degrid(temp_model).array() * uv_vis.weights.array()).matrix();
-    // clear temp model for next iteration
-    temp_model = temp_model * 0;
+    if(cycle_model.matrix().isZero(0))
+      break;
+    // add components to clean model and subtract them from data
+    clean_model = clean_model + cycle_model;
+    residual = residual - (predictor.degrid(cycle_model).array() * uv_vis.weights.array()).matrix();
   }
+  PURIFY_MEDIUM_LOG("Clean finished after {} iterations and {} major cycles", i, major_cycles);
   return clean_model;
 }
 
+Image<t_complex> multiscale_clean(MeasurementOperator &op, const utilities::vis_params &uv_vis,
+                                  const t_int &niters, const std::vector<t_real> &scales,
+                                  const t_real &gain, const t_real cycle_fraction) {
+  /*
+          Multi-scale clean. The residual image and the psf are convolved with each scale kernel
+          once per major cycle. In the minor cycle, the scale with the largest biased peak gets a
+          component, and every scale residual is updated with the psf convolved with both scale
+          kernels, so no convolution is needed per component.
+  */
+  instrumentation::ScopedEvent const event("multiscale_clean");
+  if(scales.empty())
+    throw std::runtime_error("Multi-scale clean needs at least one scale.");
+  PURIFY_HIGH_LOG("Starting multi-scale Clean with {} scales...", scales.size());
+  t_int const nscales = scales.size();
+  t_int const rows = op.imsizey();
+  t_int const cols = op.imsizex();
+  t_real const largest = *std::max_element(scales.begin(), scales.end());
+  Image<t_complex> const psf = clean::point_spread_function(op, uv_vis);
+
+  std::vector<Image<t_complex>> kernels(nscales);
+  std::vector<convolution::Kernel> scale_convolutions;
+  std::vector<convolution::Kernel> psf_convolutions;
+  std::vector<Image<t_complex>> scale_psfs(nscales);
+  for(t_int s = 0; s < nscales; ++s) {
+    // unit peak, so that residuals of extended emission grow with the scale
+    kernels[s] = clean::scale_kernel(scales[s], rows, cols);
+    kernels[s] /= kernels[s](rows / 2, cols / 2);
+    scale_convolutions.emplace_back(kernels[s], rows, cols);
+    psf_convolutions.emplace_back(kernels[s], psf.rows(), psf.cols());
+    scale_psfs[s] = psf_convolutions[s](psf);
+  }
+  // psf convolved with both kernels, updates scale s after a component at scale t
+  std::vector<std::vector<Image<t_complex>>> cross_psfs(nscales,
+                                                        std::vector<Image<t_complex>>(nscales));
+  for(t_int s = 0; s < nscales; ++s)
+    for(t_int t = 0; t <= s; ++t) {
+      cross_psfs[s][t] = psf_convolutions[t](scale_psfs[s]);
+      cross_psfs[t][s] = cross_psfs[s][t];
+    }
+  std::vector<t_complex> peaks(nscales);
+  std::vector<t_real> biases(nscales);
+  for(t_int s = 0; s < nscales; ++s) {
+    peaks[s] = cross_psfs[s][s](psf.rows() / 2, psf.cols() / 2);
+    biases[s] = largest > 0 ? 1 - 0.6 * scales[s] / largest : 1;
+  }
+
+  DFTOperator const predictor(op, uv_vis);
+  Vector<t_complex> residual = uv_vis.vis.array() * uv_vis.weights.array();
+  Image<t_complex> clean_model = Image<t_complex>::Zero(rows, cols);
+  Image<t_complex> cycle_model = clean_model;
+  std::vector<Image<t_complex>> scale_residuals(nscales);
+  std::vector<t_real> maxima(nscales);
+  std::vector<t_int> max_x(nscales), max_y(nscales);
+  PURIFY_MEDIUM_LOG("Will run for {} iterations", niters);
+  t_int i = 0;
+  t_int major_cycles = 0;
+  while(i < niters) {
+    // major cycle: residual image from the visibilities, convolved with each scale
+    Image<t_complex> const res_image = op.grid(residual);
+    for(t_int s = 0; s < nscales; ++s)
+      scale_residuals[s] = scale_convolutions[s](res_image);
+    t_real threshold = 0;
+    for(t_int s = 0; s < nscales; ++s)
+      threshold = std::max(threshold, biases[s] * clean::peak(scale_residuals[s], max_y[s],
+                                                                max_x[s]));
+    threshold *= cycle_fraction;
+    ++major_cycles;
+    cycle_model.setZero();
+    for(; i < niters; ++i) {
+#pragma omp parallel for
+      for(t_int s = 0; s < nscales; ++s)
+        maxima[s] = biases[s] * clean::peak(scale_residuals[s], max_y[s], max_x[s]);
+      t_int const t = std::max_element(maxima.begin(), maxima.end()) - maxima.begin();
+      if(maxima[t] < threshold or maxima[t] == 0)
+        break;
+      if(i % 50 == 0)
+        PURIFY_LOW_LOG("Iteration: {}, Max: {} at scale {}", i, maxima[t], scales[t]);
+      t_complex const component = gain * scale_residuals[t](max_y[t], max_x[t]) / peaks[t];
+      clean::subtract_psf(cycle_model, kernels[t], -component, max_y[t], max_x[t]);
+#pragma omp parallel for
+      for(t_int s = 0; s < nscales; ++s)
+        clean::subtract_psf(scale_residuals[s], cross_psfs[s][t], component, max_y[t], max_x[t]);
+    }
+    if(cycle_model.matrix().isZero(0))
+      break;
+    clean_model = clean_model + cycle_model;
+    residual = residual - (predictor.degrid(cycle_model).array() * uv_vis.weights.array()).matrix();
+  }
+  PURIFY_MEDIUM_LOG("Multi-scale clean finished after {} iterations and {} major cycles", i,
+                    major_cycles);
+  return clean_model;
+}
+
+Image<t_complex> scale_kernel(const t_real &scale, const t_int &rows, const t_int &cols) {
+  /*
+          Tapered paraboloid 1 - (r / scale)^2, normalised to a unit sum. A scale of zero gives a
+          single pixel.
+  */
+  Image<t_complex> kernel = Image<t_complex>::Zero(rows, cols);
+  t_int const y_centre = rows / 2;
+  t_int const x_centre = cols / 2;
+  if(scale <= 0) {
+    kernel(y_centre, x_centre) = 1;
+    return kernel;
+  }
+  for(t_int x = 0; x < cols; ++x)
+    for(t_int y = 0; y < rows; ++y) {
+      t_real const r2 = ((x - x_centre) * (x - x_centre) + (y - y_centre) * (y - y_centre))
+                        / (scale * scale);
+      if(r2 < 1)
+        kernel(y, x) = 1 - r2;
+    }
+  return kernel / kernel.sum();
+}
+
+Image<t_complex>
+point_spread_function(const MeasurementOperator &op, const utilities::vis_params &uv_vis) {
+  /*
+          Response of the weighted gridding operator to a point source at the centre of a field
+          twice the size of the image, so that the psf shifted onto any pixel of the image still
+          covers the whole image. It comes from an operator with the same cell size and kernels
+          over the larger field, scaled to the peak of the response of op itself. Visibilities in
+          grid units are stretched with the fourier grid. The weights W of op are reused as they
+          are: binned again on the larger grid, uniform and robust weights would differ.
+  */
+  auto const response = [&uv_vis](const MeasurementOperator &measurements) {
+    Image<t_complex> point_source
+        = Image<t_complex>::Zero(measurements.imsizey(), measurements.imsizex());
+    point_source(measurements.imsizey() / 2, measurements.imsizex() / 2) = 1;
+    return measurements.grid(
+        (measurements.degrid(point_source).array() * uv_vis.weights.array()).matrix());
+  };
+  utilities::vis_params padded_vis = uv_vis;
+  if(uv_vis.units == "lambda")
+    padded_vis = utilities::set_cell_size(uv_vis, op.cell_x(), op.cell_y());
+  else if(uv_vis.units != "radians") {
+    padded_vis.u = 2 * uv_vis.u;
+    padded_vis.v = 2 * uv_vis.v;
+  }
+  MeasurementOperator padded;
+  padded.Ju(op.Ju())
+      .Jv(op.Jv())
+      .kernel_name(op.kernel_name())
+      .imsizex(2 * op.imsizex())
+      .imsizey(2 * op.imsizey())
+      .norm_iterations(0)
+      .oversample_factor(op.oversample_factor())
+      .cell_x(op.cell_x())
+      .cell_y(op.cell_y())
+      .weighting_type("none")
+      .use_w_term(op.use_w_term())
+      .energy_fraction(op.energy_fraction())
+      .primary_beam(op.primary_beam())
+      .fft_grid_correction(op.fft_grid_correction());
+  padded.init_gridding();
+  auto const scaled = padded.grid_units(padded_vis);
+  padded.init_operator(op.W, padded.interpolation_entries(scaled.u, scaled.v));
+  // the norm is not estimated with no power iterations, the scale is set from op below
+  padded.norm = op.norm;
+  Image<t_complex> const psf = response(padded);
+  t_complex const peak = response(op)(op.imsizey() / 2, op.imsizex() / 2);
+  return psf * (peak / psf(op.imsizey(), op.imsizex()));
+}
+
+t_real peak(const Image<t_complex> &image, t_int &y, t_int &x) {
+  /*
+          Largest absolute value and its position. Each thread scans a contiguous chunk of the real
+          and imaginary parts, so no temporary image is created.
+  */
+  t_real const *const data = reinterpret_cast<t_real const *>(image.data());
+  t_int const size = image.size();
+  t_int best_index = 0;
+  t_real best = -1;
+#pragma omp parallel
+  {
+    t_int local_index = 0;
+    t_real local = -1;
+#pragma omp for nowait
+    for(t_int j = 0; j < size; ++j) {
+      t_real const value = data[2 * j] * data[2 * j] + data[2 * j + 1] * data[2 * j + 1];
+      if(value > local) {
+        local = value;
+        local_index = j;
+      }
+    }
+#pragma omp critical
+    if(local > best or (local == best and local_index < best_index)) {
+      best = local;
+      best_index = local_index;
+    }
+  }
+  if(size > 0) {
+    y = best_index % image.rows();
+    x = best_index / image.rows();
+  }
+  return size > 0 ? std::sqrt(best) : 0;
+}
+
+void subtract_psf(Image<t_complex> &residual, const Image<t_complex> &psf,
+                  const t_complex &amplitude, const t_int &y, const t_int &x) {
+  /*
+          Subtracts the psf shifted onto pixel (y, x). The psf is centred on its middle pixel and
+          truncated at the edges of the image.
+  */
+  t_int const y_shift = y - psf.rows() / 2;
+  t_int const x_shift = x - psf.cols() / 2;
+  t_int const y_start = std::max(0, y_shift);
+  t_int const x_start = std::max(0, x_shift);
+  t_int const height = std::min<t_int>(residual.rows(), y_shift + psf.rows()) - y_start;
+  t_int const width = std::min<t_int>(residual.cols(), x_shift + psf.cols()) - x_start;
+  if(height <= 0 or width <= 0)
+    return;
+  residual.block(y_start, x_start, height, width)
+      -= amplitude * psf.block(y_start - y_shift, x_start - x_shift, height, width);
+}
+
 Image<t_complex> model_estimate(const Image<t_complex> &dirty_image,
                                 const Image<t_complex> &dirty_beam, const t_int &niters,
                                 const t_real &gain, const t_real clip) {
@@ -72,8 +389,7 @@ Image<t_complex> model_estimate(const Image<t_complex> &dirty_image,
   Image<t_complex> clean_model = res_image * 0;
   Image<t_complex> temp_model = clean_model * 0;
 
-  FFTOperator fft;
-  const Image<t_complex> dirty_beam_fft = fft.forward(dirty_beam);
+  convolution::Kernel const beam(dirty_beam, dirty_image.rows(), dirty_image.cols());
   // should add a method to calculate clean steer clip automatically
 
   for(t_int i = 0; i < niters; ++i) {
@@ -93,13 +409,13 @@ Image<t_complex> model_estimate(const Image<t_complex> &dirty_image,
         temp_model(i) = 0;
     }
     // convolve beam with temp model to create dirty model
-    Image<t_complex> dirty_model = fft.inverse(fft.forward(temp_model).array() * dirty_beam_fft);
+    Image<t_complex> const dirty_model = beam(temp_model);
     // need to write in correction factor for beam volume, eta
     t_complex eta = (res_image * dirty_model.conjugate()).sum()
                     / (dirty_model * dirty_model.conjugate()).sum();
-    if(0 < std::abs(eta) < 0.02)
-      eta = 0.02 * eta
-            / std::abs(eta); // empirical way to stop a semi-infinite loop, following miriad
+    // empirical way to stop a semi-infinite loop, following miriad
+    if(std::abs(eta) > 0 and std::abs(eta) < 0.02)
+      eta = 0.02 * eta / std::abs(eta);
 
     temp_model = eta * gain * temp_model;
     // subtract model from data
@@ -113,25 +429,27 @@ Image<t_complex> model_estimate(const Image<t_complex> &dirty_image,
 }
 Image<t_complex>
 convolve_model(const Image<t_complex> &clean_model, const Image<t_complex> &gaussian) {
-  Fft2d fft;
-  const Image<t_complex> fft_point_source = fft.forward(gaussian);
-  const Image<t_complex> clean_model_fft = fft.forward(clean_model);
-  return fft.inverse(clean_model_fft.array() * fft_point_source.array()).array();
+  return convolution::Kernel(gaussian, clean_model.rows(), clean_model.cols(), beam_threshold)(
+      clean_model);
 }
 Image<t_complex> fit_gaussian(MeasurementOperator &op, const utilities::vis_params &uv_vis) {
-  Image<t_real> psf = op.grid(uv_vis.weights).real();
+  return clean::fit_gaussian(clean::point_spread_function(op, uv_vis));
+}
+Image<t_complex> fit_gaussian(const Image<t_complex> &psf) {
+  /*
+          Fits a gaussian to the main lobe of the psf, and returns it with a unit sum and centred on
+          the middle pixel of the image.
+  */
   t_int psf_x;
   t_int psf_y;
-  t_real max = psf.maxCoeff(&psf_x, &psf_y);
-  PURIFY_LOW_LOG("PSF max pixel at (%d, %d)", psf_y, psf_x);
-  psf = psf / max;
-  Image<t_complex> gaussian = Image<t_complex>::Zero(op.imsizey(), op.imsizex());
+  t_real const max = psf.real().maxCoeff(&psf_y, &psf_x);
+  PURIFY_LOW_LOG("PSF max pixel at ({}, {})", psf_y, psf_x);
   // choice of parameters
-  auto const fit = utilities::fit_fwhm(psf, 3);
+  auto const fit = utilities::fit_fwhm(psf.real() / max, 3);
   auto fwhm_x = fit(0) * 2 * std::sqrt(2 * std::log(2));
   auto fwhm_y = fit(1) * 2 * std::sqrt(2 * std::log(2));
   auto theta = fit(2);
-  PURIFY_MEDIUM_LOG("Fitted a Beam of %f x %f , %f", fwhm_x, fwhm_y, theta / constant::pi * 180);
+  PURIFY_MEDIUM_LOG("Fitted a Beam of {} x {} , {}", fwhm_x, fwhm_y, theta / constant::pi * 180);
   // setting up Gaussian calculation
   t_real const sigma_x = fwhm_x / (2 * std::sqrt(2 * std::log(2)));
   t_real const sigma_y = fwhm_y / (2 * std::sqrt(2 * std::log(2)));
@@ -142,37 +460,35 @@ Image<t_complex> fit_gaussian(MeasurementOperator &op, const utilities::vis_para
                    + std::sin(2 * theta) / (4 * sigma_y * sigma_y);
   t_real const c = std::pow(std::sin(theta), 2) / (2 * sigma_x * sigma_x)
                    + std::pow(std::cos(theta), 2) / (2 * sigma_y * sigma_y);
-  auto x0 = op.imsizex() * 0.5;
-  auto y0 = op.imsizey() * 0.5;
-  for(t_int i = 0; i < op.imsizex(); ++i) {
-    for(t_int j = 0; j < op.imsizey(); ++j) {
-      t_real x = i - x0;
-      t_real y = j - y0;
-      gaussian(j, i) = std::exp(-a * x * x + 2 * b * x * y - c * y * y)
-                       / (2 * constant::pi * sigma_x * sigma_y);
-    }
-  }
-  t_int gaussian_x;
-  t_int gaussian_y;
-  PURIFY_DEBUG("{}", gaussian.abs().maxCoeff(&gaussian_x, &gaussian_y));
-  PURIFY_LOW_LOG("Gaussian max pixel at (%d, %d)", gaussian_y, gaussian_x);
-  return gaussian;
+  t_int const rows = psf.rows();
+  t_int const cols = psf.cols();
+  Array<t_real> const x = Array<t_real>::LinSpaced(cols, 0, cols - 1) - cols / 2;
+  Array<t_real> const y = Array<t_real>::LinSpaced(rows, 0, rows - 1) - rows / 2;
+  Image<t_real> const xx = x.transpose().replicate(rows, 1);
+  Image<t_real> const yy = y.replicate(1, cols);
+  Image<t_real> const gaussian = (-a * xx * xx + 2 * b * xx * yy - c * yy * yy).exp()
+                                 / (2 * constant::pi * sigma_x * sigma_y);
+  return gaussian.cast<t_complex>();
 }
 Image<t_complex> restore(MeasurementOperator &op, const utilities::vis_params &uv_vis,
                          const Image<t_complex> &clean_model) {
+  Image<t_complex> const beam = clean::fit_gaussian(clean::point_spread_function(op, uv_vis));
+  return clean::restore(op, uv_vis, clean_model,
+                        convolution::Kernel(beam, op.imsizey(), op.imsizex(), beam_threshold));
+}
+Image<t_complex> restore(MeasurementOperator &op, const utilities::vis_params &uv_vis,
+                         const Image<t_complex> &clean_model, const convolution::Kernel &beam) {
   /*
-          Produces the final image given a clean model
+          Produces the final image given a clean model and the restoring beam, so that the psf and
+          beam can be computed once and reused for several models.
   */
-
-  const Image<t_complex> final_model
-      = clean::convolve_model(clean_model, clean::fit_gaussian(op, uv_vis));
   // need to workout correction factor to multiply residuals by...
   t_real residual_correction_factor = 1.;
   // add convolved clean model to residual image
   auto residual = uv_vis.vis - op.degrid(clean_model);
   Image<t_complex> restored_image
       = op.grid(residual.array() * uv_vis.weights.array()).array() * residual_correction_factor
-        + final_model;
+        + beam(clean_model);
   return restored_image;
 }
 }
@@ -6,29 +6,63 @@
 #include <iostream>
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include "purify/FFTOperator.h"
 #include "purify/MeasurementOperator.h"
+#include "purify/convolution.h"
 #include "purify/types.h"
 
 namespace purify {
 
 namespace clean {
-// basic clean algorithms, returns a clean model
+//! \brief basic clean algorithms (hogbom, clark, steer or multiscale), returns a clean model
+//! \details Minor cycles subtract the point spread function in the image domain, a major cycle
+//! recomputes the residual image from the visibilities once the peak residual drops below
+//! cycle_fraction of its value at the start of the cycle. In clark and steer modes, clip is the
+//! fraction of the peak above which pixels are active or selected, in (0, 1]. Clark minor
+//! iterations use the central patch_size x patch_size pixels of the psf. Visibilities of the
+//! components found in a cycle are predicted with a direct fourier transform while there are few
+//! of them.
 Image<t_complex> clean(MeasurementOperator &op, const utilities::vis_params &uv_vis,
                        const t_int &niters, const t_real &gain = 0.1,
-                       const std::string &mode = "hogbom", const t_real clip = 0.9);
+                       const std::string &mode = "hogbom", const t_real clip = 0.9,
+                       const t_real cycle_fraction = 0.5, const t_int patch_size = 51);
+//! \brief Multi-scale clean, returns a clean model
+//! \details Components are tapered paraboloids with the given radii in pixels, a radius of 0 being
+//! a point source. Larger scales are biased against, following Cornwell (2008).
+Image<t_complex> multiscale_clean(MeasurementOperator &op, const utilities::vis_params &uv_vis,
+                                  const t_int &niters,
+                                  const std::vector<t_real> &scales = {0, 2, 4, 8},
+                                  const t_real &gain = 0.1, const t_real cycle_fraction = 0.5);
+//! Tapered paraboloid of unit sum and given radius in pixels, centred on the image
+Image<t_complex> scale_kernel(const t_real &scale, const t_int &rows, const t_int &cols);
+//! \brief Dirty image of a unit point source, over twice the size of the image along each axis
+//! \details Centred on pixel (imsizey, imsizex), so that shifted onto any pixel of the image it is
+//! never truncated. Builds a second operator over the larger field.
+Image<t_complex>
+point_spread_function(const MeasurementOperator &op, const utilities::vis_params &uv_vis);
+//! Largest absolute value in an image, with its position
+t_real peak(const Image<t_complex> &image, t_int &y, t_int &x);
+//! Subtracts the point spread function, centred on pixel (y, x) and scaled by amplitude
+void subtract_psf(Image<t_complex> &residual, const Image<t_complex> &psf,
+                  const t_complex &amplitude, const t_int &y, const t_int &x);
 // uses computationally cheap version of steer clean to generate initial model for purify.
 Image<t_complex> model_estimate(const Image<t_complex> &dirty_image,
-                                const Image<t_complex> dirty_beam_fft, const t_int &niters,
+                                const Image<t_complex> &dirty_beam, const t_int &niters,
                                 const t_real &gain = 0.1, const t_real clip = 0.9);
 //! convolves clean components with gaussian
 Image<t_complex>
 convolve_model(const Image<t_complex> &clean_model, const Image<t_complex> &gaussian);
 //! fits gaussian to psf and returns a gaussian
 Image<t_complex> fit_gaussian(MeasurementOperator &op, const utilities::vis_params &uv_vis);
+//! fits gaussian to a psf centred on the image and returns a gaussian
+Image<t_complex> fit_gaussian(const Image<t_complex> &psf);
 // restores an image from a given clean model
 Image<t_complex> restore(MeasurementOperator &op, const utilities::vis_params &uv_vis,
                          const Image<t_complex> &clean_model);
+//! restores an image from a given clean model, with a prepared restoring beam
+Image<t_complex> restore(MeasurementOperator &op, const utilities::vis_params &uv_vis,
+                         const Image<t_complex> &clean_model, const convolution::Kernel &beam);
 }
 }
 
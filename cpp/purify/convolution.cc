@@ -0,0 +1,205 @@
+#include "purify/config.h"
+#include "purify/convolution.h"
+#include <cmath>
+#include <vector>
+#include "purify/FFTOperator.h"
+#include "purify/logging.h"
+
+namespace purify {
+
+namespace convolution {
+namespace {
+//! Kernels with at most this many pixels are convolved directly by convolution::full
+constexpr t_int direct_size = 25;
+
+//! Tile sizes worth trying along one axis, with the padded size of their transform
+std::vector<std::pair<t_int, t_int>> tile_candidates(const t_int &size, const t_int &kernel_size) {
+  // the whole image as one tile, padded to a size fftw handles well
+  std::vector<std::pair<t_int, t_int>> candidates{{size, fast_size(size + kernel_size - 1)}};
+  for(t_int padded = 16; padded < size + kernel_size - 1; padded *= 2)
+    if(padded - kernel_size + 1 >= kernel_size)
+      candidates.emplace_back(padded - kernel_size + 1, padded);
+  return candidates;
+}
+
+//! Rough number of floating point operations of a forward and inverse fft and a product
+t_real fft_cost(const t_int &rows, const t_int &cols) {
+  t_real const size = static_cast<t_real>(rows) * cols;
+  return 10 * size * std::log2(std::max<t_real>(size, 2)) + 6 * size;
+}
+}
+
+t_int fast_size(const t_int &size) {
+  for(t_int candidate = std::max<t_int>(size, 1);; ++candidate) {
+    t_int remainder = candidate;
+    for(t_int factor : {2, 3, 5, 7})
+      while(remainder % factor == 0)
+        remainder /= factor;
+    if(remainder == 1)
+      return candidate;
+  }
+}
+
+Image<t_complex> full(const Image<t_complex> &a, const Image<t_complex> &b) {
+  t_int const rows = a.rows() + b.rows() - 1;
+  t_int const cols = a.cols() + b.cols() - 1;
+  if(a.size() == 0 or b.size() == 0)
+    return Image<t_complex>::Zero(std::max<t_int>(rows, 0), std::max<t_int>(cols, 0));
+  if(std::min(a.size(), b.size()) <= direct_size) {
+    // one shifted copy of the larger image per pixel of the smaller one
+    Image<t_complex> const &small = a.size() <= b.size() ? a : b;
+    Image<t_complex> const &large = a.size() <= b.size() ? b : a;
+    Image<t_complex> output = Image<t_complex>::Zero(rows, cols);
+    for(t_int j = 0; j < small.cols(); ++j)
+      for(t_int i = 0; i < small.rows(); ++i)
+        output.block(i, j, large.rows(), large.cols()) += small(i, j) * large;
+    return output;
+  }
+  FFTOperator fft;
+  Image<t_complex> padded_a = Image<t_complex>::Zero(rows, cols);
+  Image<t_complex> padded_b = Image<t_complex>::Zero(rows, cols);
+  padded_a.topLeftCorner(a.rows(), a.cols()) = a;
+  padded_b.topLeftCorner(b.rows(), b.cols()) = b;
+  return fft.inverse(fft.forward(padded_a).array() * fft.forward(padded_b).array());
+}
+
+Image<t_complex> direct(const Image<t_complex> &image, const Image<t_complex> &kernel) {
+  /*
+    Adds a shifted copy of the image for each nonzero value of the kernel, so the inner loops are
+    plain block operations.
+  */
+  t_int const rows = image.rows();
+  t_int const cols = image.cols();
+  t_int const y_centre = kernel.rows() / 2;
+  t_int const x_centre = kernel.cols() / 2;
+  Image<t_complex> output = Image<t_complex>::Zero(rows, cols);
+  for(t_int j = 0; j < kernel.cols(); ++j)
+    for(t_int i = 0; i < kernel.rows(); ++i) {
+      t_int const dy = i - y_centre;
+      t_int const dx = j - x_centre;
+      if(kernel(i, j) == 0. or std::abs(dy) >= rows or std::abs(dx) >= cols)
+        continue;
+      t_int const height = rows - std::abs(dy);
+      t_int const width = cols - std::abs(dx);
+      output.block(std::max(0, dy), std::max(0, dx), height, width)
+          += kernel(i, j) * image.block(std::max(0, -dy), std::max(0, -dx), height, width);
+    }
+  return output;
+}
+
+Image<t_complex> crop(const Image<t_complex> &kernel, const t_real &threshold) {
+  /*
+    The box is symmetric about the middle pixel, so that it stays the centre of the cropped kernel.
+    Parts of the box outside the kernel, e.g. the last row of an even sized kernel, are zero.
+  */
+  t_int const y_centre = kernel.rows() / 2;
+  t_int const x_centre = kernel.cols() / 2;
+  t_real const cutoff = threshold * kernel.abs().maxCoeff();
+  t_int y_half = 0;
+  t_int x_half = 0;
+  for(t_int x = 0; x < kernel.cols(); ++x)
+    for(t_int y = 0; y < kernel.rows(); ++y)
+      if(std::abs(kernel(y, x)) > cutoff) {
+        y_half = std::max(y_half, std::abs(y - y_centre));
+        x_half = std::max(x_half, std::abs(x - x_centre));
+      }
+  Image<t_complex> cropped = Image<t_complex>::Zero(2 * y_half + 1, 2 * x_half + 1);
+  t_int const y_start = std::max(0, y_centre - y_half);
+  t_int const x_start = std::max(0, x_centre - x_half);
+  t_int const height = std::min<t_int>(kernel.rows(), y_centre + y_half + 1) - y_start;
+  t_int const width = std::min<t_int>(kernel.cols(), x_centre + x_half + 1) - x_start;
+  cropped.block(y_start - y_centre + y_half, x_start - x_centre + x_half, height, width)
+      = kernel.block(y_start, x_start, height, width);
+  return cropped;
+}
+
+Kernel::Kernel(const Image<t_complex> &kernel, const t_int &rows, const t_int &cols,
+               const t_real &threshold)
+    : kernel_(crop(kernel, threshold)), rows_(rows), cols_(cols) {
+  /*
+    Picks the cheapest of a direct convolution and overlap-add with each candidate tile size, from
+    rough operation counts. The whole image as a single tile is the plain padded fft convolution.
+
+    kernel:: kernel centred on its middle pixel
+    rows, cols:: size of the images to convolve
+    threshold:: values below threshold * peak are cropped from the edges of the kernel
+  */
+  t_int const nonzeros = (kernel_.abs() > 0).count();
+  t_real best = 8. * rows * cols * nonzeros;
+  t_int padded_rows = 0;
+  t_int padded_cols = 0;
+  for(auto const &tile_y : tile_candidates(rows, kernel_.rows()))
+    for(auto const &tile_x : tile_candidates(cols, kernel_.cols())) {
+      t_real const ntiles = std::ceil(static_cast<t_real>(rows) / tile_y.first)
+                            * std::ceil(static_cast<t_real>(cols) / tile_x.first);
+      t_real const cost = ntiles * fft_cost(tile_y.second, tile_x.second);
+      if(cost < best) {
+        best = cost;
+        tile_rows_ = tile_y.first;
+        tile_cols_ = tile_x.first;
+        padded_rows = tile_y.second;
+        padded_cols = tile_x.second;
+      }
+    }
+  if(tile_rows_ == 0) {
+    PURIFY_DEBUG("Convolving with a {}x{} kernel directly", kernel_.rows(), kernel_.cols());
+    return;
+  }
+  PURIFY_DEBUG("Convolving with a {}x{} kernel on {}x{} tiles", kernel_.rows(), kernel_.cols(),
+               tile_rows_, tile_cols_);
+  Image<t_complex> padded = Image<t_complex>::Zero(padded_rows, padded_cols);
+  Image<t_complex> spectrum(padded_rows, padded_cols);
+  auto const in = reinterpret_cast<fftw_complex *>(padded.data());
+  auto const out = reinterpret_cast<fftw_complex *>(spectrum.data());
+  // column major, so fftw sees the transposed image
+  unsigned const flags = FFTW_ESTIMATE | FFTW_UNALIGNED;
+  forward_plan_ = t_plan(
+      fftw_plan_dft_2d(padded_cols, padded_rows, in, out, FFTW_FORWARD, flags), fftw_destroy_plan);
+  backward_plan_ = t_plan(
+      fftw_plan_dft_2d(padded_cols, padded_rows, in, out, FFTW_BACKWARD, flags), fftw_destroy_plan);
+  padded.topLeftCorner(kernel_.rows(), kernel_.cols()) = kernel_;
+  fftw_execute_dft(forward_plan_.get(), in, out);
+  // fftw's backward transform is not normalised
+  kernel_fft_ = spectrum / static_cast<t_real>(spectrum.size());
+}
+
+Image<t_complex> Kernel::operator()(const Image<t_complex> &image) const {
+  /*
+    Overlap-add: the linear convolution of each tile is computed with the cached kernel transform
+    and added back at the position of the tile, shifted by the centre of the kernel.
+  */
+  if(image.rows() != rows_ or image.cols() != cols_)
+    throw std::runtime_error("Image does not match the size the convolution was prepared for.");
+  if(tile_rows_ == 0)
+    return direct(image, kernel_);
+  t_int const y_centre = kernel_.rows() / 2;
+  t_int const x_centre = kernel_.cols() / 2;
+  Image<t_complex> output = Image<t_complex>::Zero(rows_, cols_);
+  Image<t_complex> padded(kernel_fft_.rows(), kernel_fft_.cols());
+  Image<t_complex> tile(kernel_fft_.rows(), kernel_fft_.cols());
+  auto const padded_data = reinterpret_cast<fftw_complex *>(padded.data());
+  auto const tile_data = reinterpret_cast<fftw_complex *>(tile.data());
+  for(t_int x = 0; x < cols_; x += tile_cols_)
+    for(t_int y = 0; y < rows_; y += tile_rows_) {
+      t_int const height = std::min(tile_rows_, rows_ - y);
+      t_int const width = std::min(tile_cols_, cols_ - x);
+      if(image.block(y, x, height, width).matrix().isZero(0))
+        continue;
+      padded.setZero();
+      padded.topLeftCorner(height, width) = image.block(y, x, height, width);
+      fftw_execute_dft(forward_plan_.get(), padded_data, tile_data);
+      padded = tile * kernel_fft_;
+      fftw_execute_dft(backward_plan_.get(), padded_data, tile_data);
+      // pixel (i, j) of the tile lands on (y + i - y_centre, x + j - x_centre)
+      t_int const y_start = std::max(0, y - y_centre);
+      t_int const x_start = std::max(0, x - x_centre);
+      t_int const y_end = std::min<t_int>(rows_, y + height + kernel_.rows() - 1 - y_centre);
+      t_int const x_end = std::min<t_int>(cols_, x + width + kernel_.cols() - 1 - x_centre);
+      output.block(y_start, x_start, y_end - y_start, x_end - x_start)
+          += tile.block(y_start - y + y_centre, x_start - x + x_centre, y_end - y_start,
+                        x_end - x_start);
+    }
+  return output;
+}
+}
+}
@@ -0,0 +1,58 @@
+#ifndef PURIFY_CONVOLUTION_H
+#define PURIFY_CONVOLUTION_H
+
+#include "purify/config.h"
+#include <memory>
+#include <type_traits>
+#include <fftw3.h>
+#include "purify/types.h"
+
+namespace purify {
+
+namespace convolution {
+//! Smallest size at least as large as size with only 2, 3, 5 and 7 as prime factors
+t_int fast_size(const t_int &size);
+//! Linear convolution of two images, of size a + b - 1 along each axis
+Image<t_complex> full(const Image<t_complex> &a, const Image<t_complex> &b);
+//! Convolution with a kernel centred on its middle pixel, evaluated directly, same size as image
+Image<t_complex> direct(const Image<t_complex> &image, const Image<t_complex> &kernel);
+//! Smallest box centred on the middle pixel of a kernel holding all values above threshold * peak
+Image<t_complex> crop(const Image<t_complex> &kernel, const t_real &threshold = 0);
+
+//! \brief Convolution of images of a fixed size with a fixed kernel centred on its middle pixel
+//! \details The kernel is cropped to its support and the transform of the padded kernel is cached.
+//! Tiny kernels are applied directly, others with overlap-add over tiles, the whole image being a
+//! single tile when that is cheapest. Tiles without signal are skipped. The output has the size of
+//! the input. The fftw plans are made once and executed on buffers local to each call, so one
+//! instance can convolve from several threads at once.
+class Kernel {
+public:
+  //! Prepares the convolution of rows x cols images with kernel, cropped at threshold * peak
+  Kernel(const Image<t_complex> &kernel, const t_int &rows, const t_int &cols,
+         const t_real &threshold = 0);
+
+  //! Convolves an image with the kernel
+  Image<t_complex> operator()(const Image<t_complex> &image) const;
+  //! Kernel cropped to its support
+  Image<t_complex> const &kernel() const { return kernel_; }
+  //! Height of the overlap-add tiles, zero when the kernel is applied directly
+  t_int tile_rows() const { return tile_rows_; }
+  //! Width of the overlap-add tiles, zero when the kernel is applied directly
+  t_int tile_cols() const { return tile_cols_; }
+
+protected:
+  Image<t_complex> kernel_;
+  t_int rows_;
+  t_int cols_;
+  t_int tile_rows_ = 0;
+  t_int tile_cols_ = 0;
+  typedef std::shared_ptr<std::remove_pointer<fftw_plan>::type> t_plan;
+  //! Transform of the kernel zero padded to the tile size plus the kernel size, over its size
+  Image<t_complex> kernel_fft_;
+  //! Unaligned plans, so that they can be executed on any buffer of the padded size
+  t_plan forward_plan_;
+  t_plan backward_plan_;
+};
+}
+}
+#endif
@@ -0,0 +1,456 @@
+#include "purify/config.h"
+#include "purify/instrumentation.h"
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "purify/logging.h"
+
+namespace purify {
+namespace instrumentation {
+namespace {
+//! Totals of a stage, updated by timers on any thread
+struct Counters {
+  std::atomic<std::uint64_t> calls{0};
+  std::atomic<std::uint64_t> nanoseconds{0};
+  //! cycles, instructions and cache misses
+  std::atomic<std::uint64_t> hardware[3];
+};
+
+std::array<Counters, number_of_stages> &counters() {
+  static std::array<Counters, number_of_stages> result;
+  return result;
+}
+
+Counters &counters(Stage const &stage) { return counters()[static_cast<t_uint>(stage)]; }
+
+//! Names of the stages, also used as names of their events
+const char *const stage_names[number_of_stages]
+    = {"interpolation_matrix", "fft_forward",  "fft_inverse", "degrid",  "grid",
+       "weighting",            "power_method", "fits_io",     "wavelets"};
+
+std::atomic<bool> &tracing_flag() {
+  static std::atomic<bool> flag{false};
+  return flag;
+}
+
+//! Times of events are relative to the first use of the instrumentation
+std::chrono::steady_clock::time_point const &epoch() {
+  static auto const start = std::chrono::steady_clock::now();
+  return start;
+}
+
+std::uint64_t nanoseconds(std::chrono::steady_clock::time_point const &time) {
+  // a timer may have started before tracing, and so before the epoch
+  auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch()).count();
+  return elapsed > 0 ? elapsed : 0;
+}
+
+struct Event {
+  const char *name;
+  std::uint64_t begin;
+  std::uint64_t end;
+};
+
+//! Ring buffer of events, written by a single thread
+struct ThreadEvents {
+  ThreadEvents(t_uint thread_id) : thread_id(thread_id), events(events_per_thread) {}
+  t_uint const thread_id;
+  std::vector<Event> events;
+  std::atomic<std::uint64_t> count{0};
+};
+
+//! Buffers of all threads that recorded events, kept after the threads end
+std::mutex &threads_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+std::vector<std::shared_ptr<ThreadEvents>> &threads() {
+  static std::vector<std::shared_ptr<ThreadEvents>> buffers;
+  return buffers;
+}
+
+//! Buffer of the calling thread, registered the first time it records an event
+ThreadEvents &thread_events() {
+  thread_local std::shared_ptr<ThreadEvents> buffer;
+  if(not buffer) {
+    std::lock_guard<std::mutex> lock(threads_mutex());
+    buffer = std::make_shared<ThreadEvents>(threads().size());
+    threads().push_back(buffer);
+  }
+  return *buffer;
+}
+
+//! \brief perf_event counters of every thread of the process
+//! \details Counters are opened once, when enabled. Each thread running at that time gets a group
+//! of three counters, inherited by the threads it starts later, and reading a group sums the
+//! counts of these threads. The group of the enabling thread is read without a lock. Groups of the
+//! other threads are closed once their threads have exited, keeping their counts. Threads they
+//! started that are still running are then no longer counted.
+class HardwareCounters {
+public:
+  ~HardwareCounters() {
+    close_group(leader_);
+    for(auto const &group : others_)
+      close_group(group);
+  }
+
+  bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+
+  bool enable() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(enabled())
+      return true;
+    std::string error;
+    if(not open_group(current_thread(), leader_, error)) {
+      PURIFY_HIGH_LOG("Hardware counters are not available: {}", error);
+      return false;
+    }
+    open_other_threads();
+    had_others_ = not others_.empty();
+    enabled_.store(true, std::memory_order_release);
+    return true;
+  }
+
+  //! Counts summed over all threads so far
+  void read(std::uint64_t (&counts)[3]) {
+    std::fill(counts, counts + 3, 0);
+    add_group(leader_, counts);
+    if(not had_others_)
+      return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(auto group = others_.begin(); group != others_.end();) {
+      if(not has_exited(*group)) {
+        add_group(*group, counts);
+        ++group;
+        continue;
+      }
+      // the last counts of an exited group are kept with the retired ones
+      add_group(*group, retired_);
+      close_group(*group);
+      group = others_.erase(group);
+    }
+    for(t_uint i = 0; i < 3; ++i)
+      counts[i] += retired_[i];
+  }
+
+protected:
+  //! Counters of a thread and of the threads it starts
+  struct Group {
+    long thread = 0;
+    int fds[3] = {-1, -1, -1};
+  };
+  Group leader_;
+  std::vector<Group> others_;
+  //! Counts of closed groups
+  std::uint64_t retired_[3] = {0, 0, 0};
+  std::mutex mutex_;
+  std::atomic<bool> enabled_{false};
+  //! Whether other threads were running when enabled, set before enabled_
+  bool had_others_ = false;
+
+  static void close_group(Group const &group) {
+    for(auto const fd : group.fds)
+      close_counter(fd);
+  }
+  static void add_group(Group const &group, std::uint64_t (&counts)[3]) {
+    std::uint64_t values[4];
+    if(group.fds[0] < 0 or not read_group(group.fds[0], values))
+      return;
+    for(t_uint i = 0; i < 3 and i < values[0]; ++i)
+      counts[i] += values[i + 1];
+  }
+
+#ifdef __linux__
+  static long current_thread() { return syscall(SYS_gettid); }
+  static void close_counter(int fd) {
+    if(fd >= 0)
+      close(fd);
+  }
+  static bool read_group(int fd, std::uint64_t (&values)[4]) {
+    return ::read(fd, values, sizeof(values)) >= static_cast<ssize_t>(2 * sizeof(std::uint64_t));
+  }
+  //! Signal 0 only checks that the thread is still there
+  static bool has_exited(Group const &group) {
+    return syscall(SYS_tgkill, getpid(), group.thread, 0) != 0 and errno == ESRCH;
+  }
+
+  static int open_counter(long thread, std::uint64_t config, int group) {
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.inherit = 1;
+    attributes.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attributes, thread, -1, group, 0);
+  }
+
+  static bool open_group(long thread, Group &group, std::string &error) {
+    group.thread = thread;
+    std::uint64_t const configs[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                      PERF_COUNT_HW_CACHE_MISSES};
+    for(t_uint i = 0; i < 3; ++i) {
+      group.fds[i] = open_counter(thread, configs[i], i == 0 ? -1 : group.fds[0]);
+      if(group.fds[i] < 0) {
+        error = std::strerror(errno);
+        close_group(group);
+        group = Group();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //! Opens groups for the other threads already running, e.g. a pool of OpenMP threads
+  void open_other_threads() {
+    auto const directory = opendir("/proc/self/task");
+    if(directory == nullptr)
+      return;
+    long const current = current_thread();
+    while(auto const entry = readdir(directory)) {
+      char *end = nullptr;
+      long const thread = std::strtol(entry->d_name, &end, 10);
+      if(end == entry->d_name or *end != '\0' or thread == current)
+        continue;
+      Group group;
+      std::string error;
+      // threads that end in the meantime cannot be opened, and are skipped
+      if(open_group(thread, group, error))
+        others_.push_back(group);
+    }
+    closedir(directory);
+  }
+#else
+  static long current_thread() { return 0; }
+  static void close_counter(int) {}
+  static bool read_group(int, std::uint64_t (&)[4]) { return false; }
+  static bool has_exited(Group const &) { return false; }
+  static bool open_group(long, Group &, std::string &error) {
+    error = "hardware counters are only read on Linux";
+    return false;
+  }
+  void open_other_threads() {}
+#endif
+};
+
+HardwareCounters &hardware() {
+  static HardwareCounters counters;
+  return counters;
+}
+
+void record(const char *name, std::chrono::steady_clock::time_point const &begin,
+            std::chrono::steady_clock::time_point const &end) {
+  auto &buffer = thread_events();
+  auto const n = buffer.count.load(std::memory_order_relaxed);
+  buffer.events[n % events_per_thread] = Event{name, nanoseconds(begin), nanoseconds(end)};
+  buffer.count.store(n + 1, std::memory_order_release);
+}
+}
+
+std::string name(Stage const &stage) {
+  if(stage == Stage::number_of_stages)
+    throw std::runtime_error("Unknown stage");
+  return stage_names[static_cast<t_uint>(stage)];
+}
+
+StageStatistics statistics(Stage const &stage) {
+  StageStatistics result;
+  result.calls = counters(stage).calls.load(std::memory_order_relaxed);
+  result.seconds = counters(stage).nanoseconds.load(std::memory_order_relaxed) * 1e-9;
+  result.cycles = counters(stage).hardware[0].load(std::memory_order_relaxed);
+  result.instructions = counters(stage).hardware[1].load(std::memory_order_relaxed);
+  result.cache_misses = counters(stage).hardware[2].load(std::memory_order_relaxed);
+  return result;
+}
+
+void reset() {
+  for(auto &stage : counters()) {
+    stage.calls = 0;
+    stage.nanoseconds = 0;
+    for(auto &count : stage.hardware)
+      count = 0;
+  }
+}
+
+std::string column_names() {
+  std::ostringstream sstr;
+  for(t_uint i = 0; i < number_of_stages; ++i)
+    sstr << (i == 0 ? "" : " ") << name(static_cast<Stage>(i)) << "(sec)";
+  return sstr.str();
+}
+
+std::string columns() {
+  std::ostringstream sstr;
+  for(t_uint i = 0; i < number_of_stages; ++i)
+    sstr << (i == 0 ? "" : " ") << statistics(static_cast<Stage>(i)).seconds;
+  return sstr.str();
+}
+
+void summary(std::ostream &stream, t_uint visibilities) {
+  bool const counted = hardware_counters();
+  stream << std::left << std::setw(22) << "stage" << std::right << std::setw(10) << "calls"
+         << std::setw(14) << "total(sec)" << std::setw(14) << "mean(sec)";
+  if(counted) {
+    stream << std::setw(10) << "IPC" << std::setw(14) << "GB/s";
+    if(visibilities > 0)
+      stream << std::setw(14) << "misses/vis";
+  }
+  stream << '\n';
+  for(t_uint i = 0; i < number_of_stages; ++i) {
+    auto const stage = static_cast<Stage>(i);
+    auto const stats = statistics(stage);
+    if(stats.calls == 0)
+      continue;
+    stream << std::left << std::setw(22) << name(stage) << std::right << std::setw(10)
+           << stats.calls << std::setw(14) << stats.seconds << std::setw(14)
+           << stats.seconds / stats.calls;
+    if(counted) {
+      stream << std::setw(10) << stats.ipc() << std::setw(14) << stats.bytes_per_second() * 1e-9;
+      // per call, so that stages called once per iteration can be compared
+      if(visibilities > 0)
+        stream << std::setw(14)
+               << static_cast<t_real>(stats.cache_misses) / stats.calls / visibilities;
+    }
+    stream << '\n';
+  }
+}
+
+bool enable_hardware_counters() { return hardware().enable(); }
+
+bool hardware_counters() { return hardware().enabled(); }
+
+t_uint resident_bytes() {
+#ifdef __linux__
+  // second field of statm, in pages
+  std::ifstream statm("/proc/self/statm");
+  t_uint size = 0;
+  t_uint resident = 0;
+  if(statm >> size >> resident)
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+  return 0;
+}
+
+t_uint peak_resident_bytes() {
+#if defined(__linux__) || defined(__APPLE__)
+  rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  t_uint const peak = usage.ru_maxrss;
+#else
+  // in kilobytes on linux
+  t_uint const peak = static_cast<t_uint>(usage.ru_maxrss) * 1024;
+#endif
+  // the kernel updates the peak lazily, it can lag behind the current resident memory
+  return std::max(peak, resident_bytes());
+#else
+  return 0;
+#endif
+}
+
+void enable_tracing(bool enable) {
+  epoch();
+  tracing_flag().store(enable, std::memory_order_relaxed);
+}
+
+bool tracing() { return tracing_flag().load(std::memory_order_relaxed); }
+
+t_uint traced_events() {
+  std::lock_guard<std::mutex> lock(threads_mutex());
+  t_uint result = 0;
+  for(auto const &buffer : threads())
+    result += buffer->count.load(std::memory_order_acquire);
+  return result;
+}
+
+void write_trace(std::ostream &stream) {
+  std::lock_guard<std::mutex> lock(threads_mutex());
+  auto const precision = stream.precision(3);
+  auto const flags = stream.setf(std::ios::fixed, std::ios::floatfield);
+  stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  for(auto const &buffer : threads()) {
+    auto const n = buffer->count.load(std::memory_order_acquire);
+    for(auto i = n > events_per_thread ? n - events_per_thread : 0; i < n; ++i) {
+      auto const &event = buffer->events[i % events_per_thread];
+      stream << (first ? "" : ",") << "\n{\"name\": \"" << event.name
+             << "\", \"cat\": \"purify\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+             << buffer->thread_id << ", \"ts\": " << event.begin * 1e-3
+             << ", \"dur\": " << (event.end - event.begin) * 1e-3 << "}";
+      first = false;
+    }
+  }
+  stream << "\n]}\n";
+  stream.precision(precision);
+  stream.flags(flags);
+}
+
+void write_trace(std::string const &file_name) {
+  std::ofstream stream(file_name);
+  if(not stream)
+    throw std::runtime_error("Could not open " + file_name);
+  write_trace(stream);
+}
+
+ScopedTimer::ScopedTimer(Stage const &stage, bool const &enabled)
+    : stage_(stage), enabled_(enabled),
+      start_(enabled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()),
+      counted_(enabled and hardware_counters()) {
+  if(counted_)
+    hardware().read(start_counts_);
+}
+
+ScopedTimer::~ScopedTimer() {
+  if(not enabled_)
+    return;
+  auto const end = std::chrono::steady_clock::now();
+  auto &stage = counters(stage_);
+  if(counted_) {
+    std::uint64_t end_counts[3];
+    hardware().read(end_counts);
+    for(t_uint i = 0; i < 3; ++i)
+      if(end_counts[i] > start_counts_[i])
+        stage.hardware[i].fetch_add(end_counts[i] - start_counts_[i], std::memory_order_relaxed);
+  }
+  stage.calls.fetch_add(1, std::memory_order_relaxed);
+  stage.nanoseconds.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count(),
+      std::memory_order_relaxed);
+  if(tracing())
+    record(stage_names[static_cast<t_uint>(stage_)], start_, end);
+}
+
+ScopedEvent::ScopedEvent(const char *name)
+    : name_(name), traced_(tracing()),
+      start_(traced_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {
+}
+
+ScopedEvent::~ScopedEvent() {
+  if(traced_)
+    record(name_, start_, std::chrono::steady_clock::now());
+}
+}
+}
@@ -0,0 +1,135 @@
+#ifndef PURIFY_INSTRUMENTATION_H
+#define PURIFY_INSTRUMENTATION_H
+
+#include "purify/config.h"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "purify/types.h"
+
+namespace purify {
+
+//! \brief Wall clock time and number of calls of the main stages of purify
+//! \details Scoped timers add to totals kept per stage for the whole process, which can be queried
+//! at any time. A timer costs two reads of a steady clock and two atomic additions, so it is meant
+//! for stages doing a fair amount of work, e.g. an fft rather than a single visibility. Stages can
+//! nest: the power method includes the ffts and sparse multiplications of its iterations.
+namespace instrumentation {
+//! Stages that are timed
+enum class Stage {
+  interpolation_matrix, //!< construction of G
+  fft_forward,
+  fft_inverse,
+  degrid, //!< sparse multiplication by G
+  grid,   //!< sparse multiplication by G^H
+  weighting,
+  power_method,
+  fits_io,
+  wavelets, //!< analysis and synthesis with the SARA dictionary
+  number_of_stages
+};
+//! Number of timed stages
+constexpr t_uint number_of_stages = static_cast<t_uint>(Stage::number_of_stages);
+
+//! Totals of a stage
+struct StageStatistics {
+  t_uint calls = 0;
+  //! Wall clock time, summed over calls
+  t_real seconds = 0;
+  //! Hardware counts of all threads of the process, zero without hardware counters
+  std::uint64_t cycles = 0;
+  std::uint64_t instructions = 0;
+  std::uint64_t cache_misses = 0;
+
+  //! Instructions per cycle
+  t_real ipc() const { return cycles > 0 ? static_cast<t_real>(instructions) / cycles : 0; }
+  //! Bytes brought in from memory per second, counting a cache line for each last level miss
+  t_real bytes_per_second() const { return seconds > 0 ? cache_misses * 64. / seconds : 0; }
+};
+
+//! Name of a stage, without spaces
+std::string name(Stage const &stage);
+//! Totals of a stage so far
+StageStatistics statistics(Stage const &stage);
+//! Sets all totals to zero
+void reset();
+//! Stage names as columns, e.g. for the header of the diagnostic file
+std::string column_names();
+//! Seconds spent in each stage so far, in the same order as column_names
+std::string columns();
+//! \brief Writes a table of calls, total and mean time for each stage that was called
+//! \details With hardware counters, the table also has the instructions per cycle, the memory
+//! bandwidth from last level cache misses, and, given the number of visibilities, the misses per
+//! visibility and call.
+void summary(std::ostream &stream, t_uint visibilities = 0);
+
+//! \brief Starts counting cycles, instructions and last level cache misses during timed stages
+//! \details Uses the perf_event interface of Linux, counting in user space on every thread of the
+//! process, so that OpenMP and fftw threads are included. The counters are opened once, and threads
+//! started later inherit them, so reading them needs no lock on the calling thread. Counts of
+//! stages that overlap on different threads include each other. Returns false, and leaves counting
+//! off, when the counters cannot be opened, e.g. on other systems, in some virtual machines, or
+//! when /proc/sys/kernel/perf_event_paranoid forbids it.
+bool enable_hardware_counters();
+//! Whether hardware counters are read around timed stages
+bool hardware_counters();
+
+//! Resident memory of the process in bytes, 0 where it cannot be read
+t_uint resident_bytes();
+//! Most resident memory of the process so far in bytes, 0 where it cannot be read
+t_uint peak_resident_bytes();
+
+//! \brief Starts or stops recording a timeline of events
+//! \details While tracing, timers and scoped events record when they begin and end, and on which
+//! thread. Each thread writes to its own ring buffer, so recording takes no lock, and a buffer
+//! keeps the latest events_per_thread events. When tracing is off, an event costs a relaxed atomic
+//! load.
+void enable_tracing(bool enable = true);
+//! Whether events are being recorded
+bool tracing();
+//! Events kept by the ring buffer of each thread
+constexpr t_uint events_per_thread = 1 << 16;
+//! Number of events recorded so far, including those overwritten in the ring buffers
+t_uint traced_events();
+//! \brief Writes the recorded events in the Chrome trace format
+//! \details The json can be opened with chrome://tracing or Perfetto. Threads still recording
+//! events while it is written may leave a partial event, so it is best written once they stop.
+void write_trace(std::ostream &stream);
+void write_trace(std::string const &file_name);
+
+//! Adds the time between its construction and destruction to a stage
+class ScopedTimer {
+public:
+  //! A disabled timer reads no clock and adds nothing, e.g. to leave out fft planning
+  ScopedTimer(Stage const &stage, bool const &enabled = true);
+  ~ScopedTimer();
+  ScopedTimer(ScopedTimer const &) = delete;
+  ScopedTimer &operator=(ScopedTimer const &) = delete;
+
+protected:
+  Stage const stage_;
+  bool const enabled_;
+  std::chrono::steady_clock::time_point const start_;
+  bool const counted_;
+  //! Hardware counts when the stage started
+  std::uint64_t start_counts_[3];
+};
+
+//! Region of the timeline, recorded only while tracing
+class ScopedEvent {
+public:
+  //! The name is kept as a pointer, e.g. to a string literal
+  ScopedEvent(const char *name);
+  ~ScopedEvent();
+  ScopedEvent(ScopedEvent const &) = delete;
+  ScopedEvent &operator=(ScopedEvent const &) = delete;
+
+protected:
+  const char *const name_;
+  bool const traced_;
+  std::chrono::steady_clock::time_point const start_;
+};
+}
+}
+#endif
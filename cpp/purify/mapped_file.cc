@@ -0,0 +1,38 @@
+#include "purify/config.h"
+#include "purify/mapped_file.h"
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace purify {
+
+MappedFile::MappedFile(const std::string &file_name, const bool &sequential) {
+  auto const descriptor = open(file_name.c_str(), O_RDONLY);
+  if(descriptor < 0)
+    throw std::runtime_error("Could not open " + file_name);
+  struct stat status;
+  if(fstat(descriptor, &status) != 0) {
+    close(descriptor);
+    throw std::runtime_error("Could not stat " + file_name);
+  }
+  size_ = static_cast<std::size_t>(status.st_size);
+  if(size_ > 0) {
+    auto const mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if(mapped == MAP_FAILED) {
+      close(descriptor);
+      throw std::runtime_error("Could not map " + file_name);
+    }
+    data_ = static_cast<const char *>(mapped);
+    if(sequential)
+      madvise(mapped, size_, MADV_SEQUENTIAL);
+  }
+  close(descriptor);
+}
+
+MappedFile::~MappedFile() {
+  if(data_)
+    munmap(const_cast<char *>(data_), size_);
+}
+}
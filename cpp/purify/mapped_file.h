@@ -0,0 +1,29 @@
+#ifndef PURIFY_MAPPED_FILE_H
+#define PURIFY_MAPPED_FILE_H
+
+#include "purify/config.h"
+#include <cstddef>
+#include <string>
+
+namespace purify {
+
+//! \brief Read-only memory map of a whole file, unmapped on destruction
+//! \details The descriptor is closed once the file is mapped. Empty files are not mapped, data()
+//! is then null. Throws if the file cannot be opened or mapped.
+class MappedFile {
+public:
+  //! Maps a file, hinting the kernel to read ahead when it is read from start to end
+  MappedFile(const std::string &file_name, const bool &sequential = false);
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  const char *data() const { return data_; }
+  std::size_t size() const { return size_; }
+
+private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+}
+#endif
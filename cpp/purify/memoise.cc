@@ -0,0 +1,47 @@
+#include "purify/config.h"
+#include "purify/memoise.h"
+#include <algorithm>
+#include <memory>
+
+namespace purify {
+namespace {
+//! Last input and output of the forward direction of a transform
+struct Memo {
+  bool valid = false;
+  Vector<t_complex> input;
+  Vector<t_complex> output;
+};
+
+//! Applies a transform, unless the input is the same as last time
+void apply(Memo &memo, sopt::LinearTransform<Vector<t_complex>> const &transform,
+           Vector<t_complex> &out, Vector<t_complex> const &x) {
+  bool const same = memo.valid and memo.input.size() == x.size()
+                    and std::equal(x.data(), x.data() + x.size(), memo.input.data());
+  if(not same) {
+    memo.valid = false;
+    memo.output = transform * x;
+    memo.input = x;
+    memo.valid = true;
+  }
+  out = memo.output;
+}
+}
+
+sopt::LinearTransform<sopt::Vector<sopt::t_complex>>
+memoised_linear_transform(sopt::LinearTransform<sopt::Vector<sopt::t_complex>> const &transform) {
+  /*
+    Only the forward direction repeats its input, the adjoint is applied to a new residual at each
+    iteration, so remembering it would only cost a copy of its input and output.
+  */
+  auto const adjoint_transform = transform.adjoint();
+  auto const direct_memo = std::make_shared<Memo>();
+  auto direct = [transform, direct_memo](Vector<t_complex> &out, Vector<t_complex> const &x) {
+    apply(*direct_memo, transform, out, x);
+  };
+  auto adjoint = [adjoint_transform](Vector<t_complex> &out, Vector<t_complex> const &x) {
+    out = adjoint_transform * x;
+  };
+  return sopt::linear_transform<Vector<t_complex>>(direct, transform.sizes(), adjoint,
+                                                   adjoint_transform.sizes());
+}
+}
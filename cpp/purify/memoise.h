@@ -0,0 +1,17 @@
+#ifndef PURIFY_MEMOISE_H
+#define PURIFY_MEMOISE_H
+
+#include "purify/config.h"
+#include <sopt/linear_transform.h>
+#include "purify/types.h"
+
+namespace purify {
+
+//! \brief Linear transform that returns its last result when applied to the same input again
+//! \details The forward direction keeps its last input and output, shared by all copies of the
+//! transform. For instance, the convergence check of the solver applies the measurement operator to
+//! the image the solver has just applied it to. The adjoint is applied as is.
+sopt::LinearTransform<sopt::Vector<sopt::t_complex>>
+memoised_linear_transform(sopt::LinearTransform<sopt::Vector<sopt::t_complex>> const &transform);
+}
+#endif
@@ -1,5 +1,8 @@
 #include "purify/config.h"
 #include "purify/pfitsio.h"
+#include <algorithm>
+#include "purify/instrumentation.h"
+#include "purify/logging.h"
 
 namespace purify {
 namespace pfitsio {
@@ -14,6 +17,7 @@ void write2d_header(const Image<t_real> &eigen_image, const pfitsio::header_para
         overwrite:: if true, overwrites old fits file with same name
 
   */
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::fits_io);
 
   if(overwrite == true) {
     remove(header.fits_name.c_str());
@@ -78,6 +82,7 @@ void write2d(const Image<t_real> &eigen_image, const std::string &fits_name,
     dec:: centre pixel coordinate in dec
 
   */
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::fits_io);
   if(overwrite == true) {
     remove(fits_name.c_str());
   };
@@ -99,6 +104,7 @@ Image<t_complex> read2d(const std::string &fits_name) {
 
     fits_name:: name of fits file
   */
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::fits_io);
 
   std::auto_ptr<CCfits::FITS> pInfile(new CCfits::FITS(fits_name, CCfits::Read, true));
   std::valarray<t_real> contents;
@@ -110,5 +116,106 @@ Image<t_complex> read2d(const std::string &fits_name) {
   std::copy(&contents[0], &contents[0] + eigen_image.size(), eigen_image.data());
   return eigen_image;
 }
+
+AsyncWriter::AsyncWriter(const t_uint max_pending)
+    : max_pending_(std::max<t_uint>(max_pending, 1)) {}
+
+AsyncWriter::~AsyncWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  changed_.notify_all();
+  if(thread_.joinable())
+    thread_.join();
+  if(error_) {
+    try {
+      std::rethrow_exception(error_);
+    } catch(std::exception const &e) {
+      PURIFY_ERROR("Could not write fits file: {}", e.what());
+    } catch(...) {
+      PURIFY_ERROR("Could not write fits file");
+    }
+  }
+}
+
+void AsyncWriter::write2d_header(Image<t_real> &&image, const header_params &header) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  rethrow();
+  auto const waiting = pending_.find(header.fits_name);
+  if(waiting != pending_.end()) {
+    // Eigen 3.2 has no move assignment, swapping hands the buffer over without a copy
+    waiting->second.image.swap(image);
+    waiting->second.header = header;
+    ++coalesced_;
+    image.resize(0, 0);
+    return;
+  }
+  changed_.wait(lock, [this]() { return pending_.size() < max_pending_ or error_; });
+  rethrow();
+  // the thread starts with the first image, so runs that write none do not pay for it
+  if(not thread_.joinable())
+    thread_ = std::thread(&AsyncWriter::run, this);
+  Pending &slot = pending_[header.fits_name];
+  slot.image.swap(image);
+  slot.header = header;
+  order_.push_back(header.fits_name);
+  changed_.notify_all();
+}
+
+void AsyncWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return (order_.empty() and not writing_) or error_; });
+  rethrow();
+}
+
+t_uint AsyncWriter::written() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_;
+}
+
+t_uint AsyncWriter::coalesced() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return coalesced_;
+}
+
+void AsyncWriter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while(true) {
+    changed_.wait(lock, [this]() { return stop_ or not order_.empty(); });
+    if(order_.empty())
+      return;
+    auto const name = order_.front();
+    order_.pop_front();
+    // Eigen 3.2 has no move constructor, the image is swapped out of the map instead
+    Pending snapshot;
+    Pending &waiting = pending_[name];
+    snapshot.image.swap(waiting.image);
+    snapshot.header = waiting.header;
+    pending_.erase(name);
+    writing_ = true;
+    changed_.notify_all();
+    lock.unlock();
+    try {
+      pfitsio::write2d_header(snapshot.image, snapshot.header);
+      lock.lock();
+      ++written_;
+    } catch(...) {
+      lock.lock();
+      if(not error_)
+        error_ = std::current_exception();
+    }
+    writing_ = false;
+    changed_.notify_all();
+  }
+}
+
+void AsyncWriter::rethrow() {
+  if(not error_)
+    return;
+  auto const error = error_;
+  error_ = nullptr;
+  std::rethrow_exception(error);
+}
 }
 }
@@ -4,7 +4,13 @@
 #include "purify/config.h"
 #include "purify/types.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <CCfits/CCfits>
 #include "purify/utilities.h"
 
@@ -39,6 +45,53 @@ void write2d(const Image<t_real> &image, const std::string &fits_name,
              const std::string &pix_units = "Jy/Beam", const bool &overwrite = true);
 //! Read image from fits file
 Image<t_complex> read2d(const std::string &fits_name);
+
+//! \brief Writes fits files from a background thread
+//! \details Images are moved into the writer and the caller carries on. Each file has at most one
+//! image waiting: queueing a file that is still waiting replaces its image, so a writer that falls
+//! behind only writes the latest snapshot of each file. Errors of the writer are rethrown by the
+//! next call to write2d_header or flush. The thread is started by the first image queued.
+class AsyncWriter {
+public:
+  //! At most max_pending files wait to be written, before write2d_header blocks
+  AsyncWriter(const t_uint max_pending = 8);
+  //! Writes what is still waiting
+  ~AsyncWriter();
+  AsyncWriter(const AsyncWriter &) = delete;
+  AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+  //! Queues an image for header.fits_name, the image is left empty
+  void write2d_header(Image<t_real> &&image, const header_params &header);
+  //! Waits until all queued images are written
+  void flush();
+  //! Number of images written
+  t_uint written() const;
+  //! Number of images replaced by a newer one before they were written
+  t_uint coalesced() const;
+
+protected:
+  struct Pending {
+    Image<t_real> image;
+    header_params header;
+  };
+  //! Image waiting for each file, and the order in which files were first queued
+  std::map<std::string, Pending> pending_;
+  std::deque<std::string> order_;
+  t_uint const max_pending_;
+  bool writing_ = false;
+  bool stop_ = false;
+  t_uint written_ = 0;
+  t_uint coalesced_ = 0;
+  std::exception_ptr error_;
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::thread thread_;
+
+  //! Loop of the background thread
+  void run();
+  //! Rethrows an error of the background thread, with the lock held
+  void rethrow();
+};
 }
 }
 
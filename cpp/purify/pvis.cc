@@ -0,0 +1,121 @@
+#include "purify/config.h"
+#include "purify/pvis.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "purify/instrumentation.h"
+#include "purify/logging.h"
+
+namespace purify {
+namespace pvis {
+namespace {
+static_assert(sizeof(Header) == 128, "The header of binary visibility files is 128 bytes");
+//! First bytes of a binary visibility file
+constexpr char magic[8] = {'P', 'U', 'R', 'I', 'F', 'Y', 'V', 'S'};
+constexpr std::uint32_t version = 1;
+constexpr std::uint32_t byte_order = 0x01020304;
+//! Columns start on multiples of this many bytes
+constexpr std::uint64_t alignment = 64;
+
+std::uint64_t aligned(const std::uint64_t &offset) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+//! Size in bytes of each column
+std::uint64_t column_bytes(const t_int &column, const std::uint64_t &size) {
+  return size * (column < 3 ? sizeof(t_real) : sizeof(t_complex));
+}
+}
+
+void write(const utilities::vis_params &uv_vis, const std::string &file_name) {
+  auto const size = static_cast<std::uint64_t>(uv_vis.u.size());
+  if(uv_vis.v.size() != uv_vis.u.size() or uv_vis.vis.size() != uv_vis.u.size()
+     or uv_vis.weights.size() != uv_vis.u.size())
+    throw std::runtime_error("Columns of the visibilities have different sizes.");
+  if(uv_vis.units.size() >= sizeof(Header::units))
+    throw std::runtime_error("Units " + uv_vis.units + " do not fit in a binary visibility file");
+  // files without w, e.g. read from text without a w column, get zeros
+  Vector<t_real> const w
+      = uv_vis.w.size() == uv_vis.u.size() ? uv_vis.w : Vector<t_real>::Zero(size);
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::copy(magic, magic + sizeof(magic), header.magic);
+  header.version = version;
+  header.byte_order = byte_order;
+  header.size = size;
+  header.ra = uv_vis.ra;
+  header.dec = uv_vis.dec;
+  header.average_frequency = uv_vis.average_frequency;
+  std::copy(uv_vis.units.begin(), uv_vis.units.end(), header.units);
+  std::uint64_t offset = sizeof(header);
+  for(t_int column = 0; column < 5; ++column) {
+    header.offsets[column] = aligned(offset);
+    offset = header.offsets[column] + column_bytes(column, size);
+  }
+
+  std::ofstream out(file_name, std::ios::binary);
+  if(not out)
+    throw std::runtime_error("Could not open " + file_name);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  const char *const columns[5] = {reinterpret_cast<const char *>(uv_vis.u.data()),
+                                  reinterpret_cast<const char *>(uv_vis.v.data()),
+                                  reinterpret_cast<const char *>(w.data()),
+                                  reinterpret_cast<const char *>(uv_vis.vis.data()),
+                                  reinterpret_cast<const char *>(uv_vis.weights.data())};
+  char const zeros[alignment] = {0};
+  offset = sizeof(header);
+  for(t_int column = 0; column < 5; ++column) {
+    out.write(zeros, header.offsets[column] - offset);
+    out.write(columns[column], column_bytes(column, size));
+    offset = header.offsets[column] + column_bytes(column, size);
+  }
+  if(not out)
+    throw std::runtime_error("Could not write visibilities to " + file_name);
+  PURIFY_LOW_LOG("Wrote {} visibilities to {}", size, file_name);
+}
+
+utilities::vis_params read(const std::string &file_name) {
+  instrumentation::ScopedEvent const event("read_pvis");
+  return MappedVisibilities(file_name).vis_params();
+}
+
+MappedVisibilities::MappedVisibilities(const std::string &file_name)
+    : file_(std::make_shared<const MappedFile>(file_name)) {
+  auto const file_size = file_->size();
+  if(file_size < sizeof(Header))
+    throw std::runtime_error(file_name + " is not a binary visibility file");
+  std::memcpy(&header_, file_->data(), sizeof(header_));
+
+  if(not std::equal(magic, magic + sizeof(magic), header_.magic))
+    throw std::runtime_error(file_name + " is not a binary visibility file");
+  if(header_.byte_order != byte_order)
+    throw std::runtime_error(file_name + " was written on a machine of different endianness");
+  if(header_.version != version)
+    throw std::runtime_error("Unknown version " + std::to_string(header_.version) + " of "
+                             + file_name);
+  if(header_.units[sizeof(header_.units) - 1] != '\0')
+    throw std::runtime_error("Corrupted header in " + file_name);
+  if(header_.size > file_size)
+    throw std::runtime_error(file_name + " is truncated or corrupted");
+  for(t_int column = 0; column < 5; ++column)
+    if(header_.offsets[column] % alignment != 0
+       or header_.offsets[column] + column_bytes(column, header_.size) > file_size)
+      throw std::runtime_error(file_name + " is truncated or corrupted");
+}
+
+utilities::vis_params MappedVisibilities::vis_params() const {
+  utilities::vis_params uv_vis;
+  uv_vis.u = u();
+  uv_vis.v = v();
+  uv_vis.w = w();
+  uv_vis.vis = vis();
+  uv_vis.weights = weights();
+  uv_vis.units = units();
+  uv_vis.ra = ra();
+  uv_vis.dec = dec();
+  uv_vis.average_frequency = average_frequency();
+  return uv_vis;
+}
+}
+}
@@ -0,0 +1,83 @@
+#ifndef PURIFY_PVIS_H
+#define PURIFY_PVIS_H
+
+#include "purify/config.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "purify/mapped_file.h"
+#include "purify/types.h"
+#include "purify/utilities.h"
+
+namespace purify {
+
+//! \brief Binary visibility files
+//! \details A 128 byte header with the metadata of utilities::vis_params, followed by the u, v, w,
+//! vis and weights columns in native byte order. Each column starts on a 64 byte boundary, so it
+//! can be used in place once the file is mapped into memory. v is stored as in vis_params, i.e.
+//! without the reflection of the text format.
+namespace pvis {
+//! Header at the start of a binary visibility file
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  //! 0x01020304 as written, to catch files from a machine of different endianness
+  std::uint32_t byte_order;
+  std::uint64_t size;
+  double ra;
+  double dec;
+  double average_frequency;
+  char units[16];
+  //! Byte offsets of the u, v, w, vis and weights columns
+  std::uint64_t offsets[5];
+  char padding[24];
+};
+
+//! Writes visibilities to a binary file
+void write(const utilities::vis_params &uv_vis, const std::string &file_name);
+//! Reads visibilities from a binary file
+utilities::vis_params read(const std::string &file_name);
+
+//! \brief Binary visibility file mapped into memory
+//! \details The columns are maps onto the pages of the file, nothing is copied. Copies of this
+//! object share the mapping, which is released with the last one.
+class MappedVisibilities {
+public:
+  typedef Eigen::Map<const Vector<t_real>, Eigen::Aligned> RealColumn;
+  typedef Eigen::Map<const Vector<t_complex>, Eigen::Aligned> ComplexColumn;
+
+  //! Maps a file and checks its header
+  MappedVisibilities(const std::string &file_name);
+
+  //! Number of visibilities
+  t_int size() const { return header_.size; }
+  RealColumn u() const { return real_column(0); }
+  RealColumn v() const { return real_column(1); }
+  RealColumn w() const { return real_column(2); }
+  ComplexColumn vis() const { return complex_column(3); }
+  ComplexColumn weights() const { return complex_column(4); }
+  std::string units() const { return std::string(header_.units); }
+  t_real ra() const { return header_.ra; }
+  t_real dec() const { return header_.dec; }
+  t_real average_frequency() const { return header_.average_frequency; }
+
+  //! Copies the columns and metadata into a vis_params structure
+  utilities::vis_params vis_params() const;
+
+protected:
+  Header header_;
+  std::shared_ptr<const MappedFile> file_;
+
+  RealColumn real_column(const t_int &column) const {
+    return RealColumn(reinterpret_cast<const t_real *>(file_->data() + header_.offsets[column]),
+                      header_.size);
+  }
+  ComplexColumn complex_column(const t_int &column) const {
+    return ComplexColumn(
+        reinterpret_cast<const t_complex *>(file_->data() + header_.offsets[column]),
+        header_.size);
+  }
+};
+}
+}
+#endif
@@ -0,0 +1,56 @@
+#include "purify/config.h"
+#include "purify/sara.h"
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "purify/instrumentation.h"
+
+namespace purify {
+
+sopt::LinearTransform<sopt::Vector<sopt::t_complex>>
+linear_transform(sopt::wavelets::SARA const &sara, t_uint const &rows, t_uint const &cols) {
+  /*
+    Bases of longer filters cost more, so they are handed out dynamically. The bases are summed in
+    the same order as sopt, which keeps the results identical to its serial transform.
+  */
+  t_int const bases = sara.size();
+  t_int const height = rows;
+  t_int const width = cols;
+  t_int const pixels = height * width;
+  t_real const normalisation = std::sqrt(static_cast<t_real>(bases));
+  // synthesis, from coefficients to an image
+  auto direct = [sara, bases, height, width, pixels, normalisation](
+      Vector<t_complex> &out, Vector<t_complex> const &coefficients) {
+    assert(coefficients.size() == bases * pixels);
+    instrumentation::ScopedTimer const timer(instrumentation::Stage::wavelets);
+    std::vector<Image<t_complex>> images(bases);
+#pragma omp parallel for schedule(dynamic)
+    for(t_int i = 0; i < bases; ++i)
+      images[i] = sara[i].indirect(
+          Image<t_complex>::Map(coefficients.data() + i * pixels, height, width));
+    out.resize(pixels);
+#pragma omp parallel for
+    for(t_int col = 0; col < width; ++col) {
+      auto column = out.segment(col * height, height);
+      column = images[0].col(col).matrix();
+      for(t_int i = 1; i < bases; ++i)
+        column += images[i].col(col).matrix();
+      column /= normalisation;
+    }
+  };
+  // analysis, from an image to coefficients
+  auto adjoint = [sara, bases, height, width, pixels, normalisation](
+      Vector<t_complex> &out, Vector<t_complex> const &x) {
+    assert(x.size() == pixels);
+    instrumentation::ScopedTimer const timer(instrumentation::Stage::wavelets);
+    auto const image = Image<t_complex>::Map(x.data(), height, width);
+    out.resize(bases * pixels);
+#pragma omp parallel for schedule(dynamic)
+    for(t_int i = 0; i < bases; ++i)
+      out.segment(i * pixels, pixels)
+          = Vector<t_complex>::Map(sara[i].direct(image).data(), pixels) / normalisation;
+  };
+  return sopt::linear_transform<Vector<t_complex>>(direct, {{1, bases, 0}}, adjoint,
+                                                   {{bases, 1, 0}});
+}
+}
@@ -0,0 +1,20 @@
+#ifndef PURIFY_SARA_H
+#define PURIFY_SARA_H
+
+#include "purify/config.h"
+#include <sopt/linear_transform.h>
+#include <sopt/wavelets/sara.h>
+#include "purify/types.h"
+
+namespace purify {
+
+//! \brief SARA dictionary as a linear transform, with its bases evaluated in parallel
+//! \details Gives the same coefficients as sopt's transform: the i-th block of rows * cols
+//! coefficients belongs to the i-th basis, and both directions are scaled by one over the square
+//! root of the number of bases. Each basis is transformed on its own thread, directly into its
+//! block of coefficients, and the images synthesised by each basis are summed in parallel over
+//! columns. The dictionary is copied into the transform.
+sopt::LinearTransform<sopt::Vector<sopt::t_complex>>
+linear_transform(sopt::wavelets::SARA const &sara, t_uint const &rows, t_uint const &cols);
+}
+#endif
@@ -1,6 +1,15 @@
 #include "purify/config.h"
+#include "purify/convolution.h"
+#include "purify/instrumentation.h"
 #include "purify/logging.h"
+#include "purify/mapped_file.h"
 #include "purify/utilities.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <thread>
+#include <vector>
 
 namespace purify {
 namespace utilities {
@@ -37,85 +46,187 @@ random_sample_density(const t_int &vis_num, const t_real &mean, const t_real &st
   uv_vis.average_frequency = 0;
   return uv_vis;
 }
+namespace {
+//! Number of pieces a visibility file is split into per thread, to balance uneven lines
+constexpr t_int chunks_per_thread = 4;
+//! Number of lines formatted by each task when writing visibilities
+constexpr t_int lines_per_chunk = 1 << 16;
+
+t_int number_of_threads() {
+  return std::max<t_int>(1, static_cast<t_int>(std::thread::hardware_concurrency()));
+}
+
+bool is_blank(const char &c) { return c == ' ' or c == '\t' or c == '\r'; }
+
+//! True if the line [begin, end) has something other than whitespace
+bool has_entries(const char *begin, const char *const end) {
+  for(; begin != end; ++begin)
+    if(not is_blank(*begin))
+      return true;
+  return false;
+}
+
+//! Parses the next whitespace separated number, false if there is none or it is malformed
+bool next_number(const char *&position, const char *const end, t_real &value) {
+  while(position != end and is_blank(*position))
+    ++position;
+  auto const start = position;
+  while(position != end and not is_blank(*position))
+    ++position;
+  // the map is not null terminated, so strtod works on a copy of the entry
+  char entry[64];
+  auto const length = static_cast<std::size_t>(position - start);
+  if(length == 0 or length >= sizeof(entry))
+    return false;
+  std::copy(start, position, entry);
+  entry[length] = '\0';
+  char *parsed;
+  value = std::strtod(entry, &parsed);
+  return parsed == entry + length;
+}
+
+//! Fills row of the visibilities from a line, false if the line is malformed
+bool parse_line(const char *position, const char *const end, const bool w_term,
+                utilities::vis_params &uv_vis, const t_int row) {
+  t_real u, v, w = 0, real, imag, sigma = 1;
+  if(not(next_number(position, end, u) and next_number(position, end, v)
+         and (not w_term or next_number(position, end, w)) and next_number(position, end, real)
+         and next_number(position, end, imag)))
+    return false;
+  // some files, e.g. simulations, have no noise column
+  if(has_entries(position, end) and not next_number(position, end, sigma))
+    return false;
+  uv_vis.u(row) = u;
+  // found that a reflection is needed for the orientation of the gridded image to be correct
+  uv_vis.v(row) = -v;
+  uv_vis.w(row) = w;
+  uv_vis.vis(row) = t_complex(real, imag);
+  uv_vis.weights(row) = 1 / sigma;
+  return true;
+}
+}
+
 utilities::vis_params read_visibility(const std::string &vis_name, const bool w_term) {
   /*
-    Reads an csv file with u, v, visibilities and returns the vectors.
-
-    vis_name:: name of input text file containing [u, v, real(V), imag(V)] (separated by ' ').
+    Reads a text file with u, v, [w,] visibilities and the noise of each visibility, one per line
+    and separated by spaces. The file is mapped into memory and cut into chunks ending on a new
+    line. A first parallel pass counts the lines of each chunk, which gives the row each chunk
+    starts at, and a second pass parses every chunk straight into the output vectors. Blank lines
+    are skipped, and the weights are one when there is no sigma column.
+
+    vis_name:: name of input text file containing [u, v, [w,] real(V), imag(V), [sigma]]
+    w_term:: whether the file has a w column
   */
-  std::ifstream temp_file(vis_name);
-  t_int row = 0;
-  std::string line;
-  // counts size of vis file
-  while(std::getline(temp_file, line))
-    ++row;
-  Vector<t_real> utemp = Vector<t_real>::Zero(row);
-  Vector<t_real> vtemp = Vector<t_real>::Zero(row);
-  Vector<t_real> wtemp = Vector<t_real>::Zero(row);
-  Vector<t_complex> vistemp = Vector<t_complex>::Zero(row);
-  Vector<t_complex> weightstemp = Vector<t_complex>::Zero(row);
-  std::ifstream vis_file(vis_name);
-
-  // reads in vis file
-  row = 0;
-  t_real real;
-  t_real imag;
-  std::string s;
-  std::string entry;
-  while(vis_file) {
-    if(!std::getline(vis_file, s))
-      break;
-    std::istringstream ss(s);
-    std::getline(ss, entry, ' ');
-    utemp(row) = std::stod(entry);
-    std::getline(ss, entry, ' ');
-    vtemp(row) = std::stod(entry);
+  instrumentation::ScopedEvent const event("read_visibility");
+  MappedFile const file(vis_name, true);
+  const char *const data = file.data();
+  auto const size = file.size();
+
+  t_int const nchunks = std::max<t_int>(
+      1, std::min<t_int>(number_of_threads() * chunks_per_thread, size / 4096 + 1));
+  std::vector<std::size_t> bounds(nchunks + 1, size);
+  bounds.front() = 0;
+  for(t_int i = 1; i < nchunks; ++i) {
+    std::size_t position = std::max(bounds[i - 1], size / nchunks * i);
+    while(position < size and data[position - 1] != '\n')
+      ++position;
+    bounds[i] = position;
+  }
 
-    if(w_term) {
-      std::getline(ss, entry, ' ');
-      wtemp(row) = std::stod(entry);
+  std::vector<t_int> first_row(nchunks + 1, 0);
+#pragma omp parallel for schedule(dynamic)
+  for(t_int i = 0; i < nchunks; ++i) {
+    t_int lines = 0;
+    for(auto line = data + bounds[i]; line < data + bounds[i + 1];) {
+      auto const end = std::find(line, data + bounds[i + 1], '\n');
+      if(has_entries(line, end))
+        ++lines;
+      line = end + 1;
     }
-
-    std::getline(ss, entry, ' ');
-    real = std::stod(entry);
-    std::getline(ss, entry, ' ');
-    imag = std::stod(entry);
-    vistemp(row) = t_complex(real, imag);
-    std::getline(ss, entry, ' ');
-    weightstemp(row) = 1 / std::stod(entry);
-    ++row;
+    first_row[i + 1] = lines;
   }
+  std::partial_sum(first_row.begin(), first_row.end(), first_row.begin());
+
+  t_int const rows = first_row.back();
   utilities::vis_params uv_vis;
-  uv_vis.u = utemp;
-  uv_vis.v = -vtemp; // found that a reflection is needed for the orientation of the gridded image
-                     // to be correct
-  uv_vis.w = wtemp;
-  uv_vis.vis = vistemp;
-  uv_vis.weights = weightstemp;
+  uv_vis.u = Vector<t_real>(rows);
+  uv_vis.v = Vector<t_real>(rows);
+  uv_vis.w = Vector<t_real>(rows);
+  uv_vis.vis = Vector<t_complex>(rows);
+  uv_vis.weights = Vector<t_complex>(rows);
   uv_vis.ra = 0;
   uv_vis.dec = 0;
   uv_vis.average_frequency = 0;
 
+  // first malformed line, as a row of the output
+  t_int bad_row = rows;
+#pragma omp parallel for schedule(dynamic)
+  for(t_int i = 0; i < nchunks; ++i) {
+    t_int row = first_row[i];
+    for(auto line = data + bounds[i]; line < data + bounds[i + 1];) {
+      auto const end = std::find(line, data + bounds[i + 1], '\n');
+      if(has_entries(line, end)) {
+        if(not parse_line(line, end, w_term, uv_vis, row)) {
+#pragma omp critical
+          bad_row = std::min(bad_row, row);
+          break;
+        }
+        ++row;
+      }
+      line = end + 1;
+    }
+  }
+  if(bad_row < rows)
+    throw std::runtime_error("Could not read entry " + std::to_string(bad_row + 1) + " of "
+                             + vis_name);
+  PURIFY_LOW_LOG("Read {} visibilities from {}", rows, vis_name);
   return uv_vis;
 }
 
 void write_visibility(const utilities::vis_params &uv_vis, const std::string &file_name,
                       const bool w_term) {
   /*
-          writes visibilities to output text file (currently ignores w-component)
-          uv_vis:: input uv data
-          file_name:: name of output text file
+    Writes visibilities to an output text file, in the format read by read_visibility. Blocks of
+    lines are formatted in parallel into buffers, which are then written in order, so the file is
+    not flushed line by line.
+
+    uv_vis:: input uv data
+    file_name:: name of output text file
+    w_term:: whether to write the w column
   */
-  std::ofstream out(file_name);
-  out.precision(13);
-  for(t_int i = 0; i < uv_vis.u.size(); ++i) {
-    out << uv_vis.u(i) << " " << -uv_vis.v(i) << " ";
-    if(w_term)
-      out << uv_vis.w(i) << " ";
-    out << std::real(uv_vis.vis(i)) << " " << std::imag(uv_vis.vis(i)) << " "
-        << 1. / std::real(uv_vis.weights(i)) << std::endl;
+  std::ofstream out(file_name, std::ios::binary);
+  if(not out)
+    throw std::runtime_error("Could not open " + file_name);
+  t_int const nlines = uv_vis.u.size();
+  t_int const nbuffers = number_of_threads();
+  std::vector<std::string> buffers(nbuffers);
+  for(t_int start = 0; start < nlines; start += nbuffers * lines_per_chunk) {
+#pragma omp parallel for schedule(dynamic)
+    for(t_int i = 0; i < nbuffers; ++i) {
+      auto &buffer = buffers[i];
+      buffer.clear();
+      t_int const first = start + i * lines_per_chunk;
+      t_int const last = std::min(nlines, first + lines_per_chunk);
+      // six numbers of at most 21 characters with %.13g, and their separators
+      char line[160];
+      for(t_int j = first; j < last; ++j) {
+        auto const length
+            = w_term ? std::snprintf(line, sizeof(line), "%.13g %.13g %.13g %.13g %.13g %.13g\n",
+                                     uv_vis.u(j), -uv_vis.v(j), uv_vis.w(j),
+                                     std::real(uv_vis.vis(j)), std::imag(uv_vis.vis(j)),
+                                     1. / std::real(uv_vis.weights(j)))
+                     : std::snprintf(line, sizeof(line), "%.13g %.13g %.13g %.13g %.13g\n",
+                                     uv_vis.u(j), -uv_vis.v(j), std::real(uv_vis.vis(j)),
+                                     std::imag(uv_vis.vis(j)),
+                                     1. / std::real(uv_vis.weights(j)));
+        buffer.append(line, length);
+      }
+    }
+    for(auto const &buffer : buffers)
+      out.write(buffer.data(), buffer.size());
   }
-  out.close();
+  if(not out)
+    throw std::runtime_error("Could not write visibilities to " + file_name);
 }
 
 utilities::vis_params
@@ -276,26 +387,15 @@ t_real mod(const t_real &x, const t_real &y) {
 
 Image<t_complex> convolution_operator(const Image<t_complex> &a, const Image<t_complex> &b) {
   /*
-  returns the convolution of images a with images b
+  returns the convolution of images a with images b, padded with a row and column of zeros
   a:: vector a, which is shifted
   b:: vector b, which is fixed
   */
-
-  // size of a image
-  t_int a_y = a.rows();
-  t_int a_x = a.cols();
-  // size of b image
-  t_int b_y = b.rows();
-  t_int b_x = b.cols();
-
-  Image<t_complex> output = Image<t_complex>::Zero(a_y + b_y, a_x + b_x);
-
-  for(t_int l = 0; l < b.cols(); ++l) {
-    for(t_int k = 0; k < b.rows(); ++k) {
-      output(k, l) = (a * b.block(k, l, a_y, a_x)).sum();
-    }
-  }
-
+  Image<t_complex> output = Image<t_complex>::Zero(a.rows() + b.rows(), a.cols() + b.cols());
+  if(a.size() == 0 or b.size() == 0)
+    return output;
+  output.topLeftCorner(a.rows() + b.rows() - 1, a.cols() + b.cols() - 1)
+      = convolution::full(a, b);
   return output;
 }
 
@@ -485,14 +585,37 @@ t_real dynamic_range(const Image<t_complex> &model, const Image<t_complex> &resi
          * model.cwiseAbs().maxCoeff();
 }
 
-Array<t_complex> init_weights(const Vector<t_real> &u, const Vector<t_real> &v,
-                              const Vector<t_complex> &weights, const t_real &oversample_factor,
-                              const std::string &weighting_type, const t_real &R,
-                              const t_int &ftsizeu, const t_int &ftsizev) {
+void accumulate_weights(Matrix<t_complex> &gridded_weights, const Vector<t_real> &u,
+                        const Vector<t_real> &v, const t_real &oversample_factor) {
   /*
-    Calculate the weights to be applied to the visibilities in the measurement operator.
-    It does none, whiten, natural, uniform, and robust.
+    Counts the visibilities that fall in each cell of the weighting grid. The grid can be
+    accumulated over chunks of visibilities, before calling finalize_weights on all of them.
+
+    gridded_weights:: grid of size ftsizev x ftsizeu
+    u, v:: coordinates in units of pixels of the oversampled grid
+  */
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::weighting);
+  t_real scale = 1. / oversample_factor; // scale for fov, controlling the region of sidelobe supression
+  t_int const ftsizeu = gridded_weights.cols();
+  t_int const ftsizev = gridded_weights.rows();
+  for(t_int i = 0; i < u.size(); ++i) {
+    t_int q = utilities::mod(floor(u(i) * scale), ftsizeu);
+    t_int p = utilities::mod(floor(v(i) * scale), ftsizev);
+    gridded_weights(p, q) += 1 * 1; // I get better results assuming all the weights are the same.
+                                    // It looks like miriad does this as well.
+  }
+}
+
+Array<t_complex>
+finalize_weights(const Matrix<t_complex> &gridded_weights, const Vector<t_real> &u,
+                 const Vector<t_real> &v, const Vector<t_complex> &weights,
+                 const t_real &oversample_factor, const std::string &weighting_type,
+                 const t_real &R) {
+  /*
+    Calculate the weights to be applied to the visibilities in the measurement operator, given the
+    weighting grid of all of them. It does none, whiten, natural, uniform, and robust.
   */
+  instrumentation::ScopedTimer const timer(instrumentation::Stage::weighting);
   Vector<t_complex> out_weights(weights.size());
   if(weighting_type == "none") {
     out_weights = weights.array() * 0 + 1;
@@ -500,32 +623,44 @@ Array<t_complex> init_weights(const Vector<t_real> &u, const Vector<t_real> &v,
     out_weights = weights;
   } else {
     t_real scale = 1. / oversample_factor; // scale for fov, controlling the region of sidelobe supression
-    Matrix<t_complex> gridded_weights = Matrix<t_complex>::Zero(ftsizev, ftsizeu);
-    for(t_int i = 0; i < weights.size(); ++i) {
-      t_int q = utilities::mod(floor(u(i) * scale), ftsizeu);
-      t_int p = utilities::mod(floor(v(i) * scale), ftsizev);
-      gridded_weights(p, q) += 1 * 1; // I get better results assuming all the weights are the same.
-                                  // It looks like miriad does this as well.
-    }
+    t_int const ftsizeu = gridded_weights.cols();
+    t_int const ftsizev = gridded_weights.rows();
     t_complex const sum_weights = (weights.array() * weights.array()).sum();
     t_complex const sum_grid_weights2 = (gridded_weights.array() * gridded_weights.array()).sum();
     t_complex const robust_scale
         = sum_weights / sum_grid_weights2 * 25.
           * std::pow(10, -2 * R); // Following standard formula, a bit different from miriad.
-    gridded_weights = gridded_weights.array().sqrt();
+    Matrix<t_complex> const root_weights = gridded_weights.array().sqrt();
     for(t_int i = 0; i < weights.size(); ++i) {
       t_int q = utilities::mod(floor(u(i) * scale), ftsizeu);
       t_int p = utilities::mod(floor(v(i) * scale), ftsizev);
       if(weighting_type == "uniform")
-        out_weights(i) = weights(i) / gridded_weights(p, q);
+        out_weights(i) = weights(i) / root_weights(p, q);
       if(weighting_type == "robust") {
-        out_weights(i) = weights(i) / std::sqrt(1. + robust_scale * gridded_weights(p, q) * gridded_weights(p, q));
+        out_weights(i) = weights(i) / std::sqrt(1. + robust_scale * root_weights(p, q) * root_weights(p, q));
       }
     }
   }
   return out_weights.array();
 }
 
+Array<t_complex> init_weights(const Vector<t_real> &u, const Vector<t_real> &v,
+                              const Vector<t_complex> &weights, const t_real &oversample_factor,
+                              const std::string &weighting_type, const t_real &R,
+                              const t_int &ftsizeu, const t_int &ftsizev) {
+  /*
+    Calculate the weights to be applied to the visibilities in the measurement operator.
+    It does none, whiten, natural, uniform, and robust.
+  */
+  // the grid is only needed by uniform and robust weighting
+  Matrix<t_complex> gridded_weights;
+  if(weighting_type != "none" and weighting_type != "natural") {
+    gridded_weights = Matrix<t_complex>::Zero(ftsizev, ftsizeu);
+    accumulate_weights(gridded_weights, u, v, oversample_factor);
+  }
+  return finalize_weights(gridded_weights, u, v, weights, oversample_factor, weighting_type, R);
+}
+
 Vector<t_complex> sparse_multiply_matrix(const Sparse<t_complex> &M, const Vector<t_complex> &x) {
   Vector<t_complex> y = Vector<t_complex>::Zero(M.rows());
 // parallel sparse matrix multiplication with vector.
@@ -40,9 +40,9 @@ struct rm_params {
 //! Generates a random visibility coverage
 utilities::vis_params
 random_sample_density(const t_int &vis_num, const t_real &mean, const t_real &standard_deviation);
-//! Reads in visibility file
+//! Reads in visibility file, parsing chunks of the file in parallel
 utilities::vis_params read_visibility(const std::string &vis_name, const bool w_term = false);
-//! Writes visibilities to txt
+//! Writes visibilities to txt, formatting blocks of lines in parallel
 void write_visibility(const utilities::vis_params &uv_vis, const std::string &file_name,
                       const bool w_term = false);
 //! Scales visibilities to a given pixel size in arcseconds
@@ -97,6 +97,15 @@ t_real median(const Vector<t_real> &input);
 //! Calculate the dynamic range between the model and residuals
 t_real dynamic_range(const Image<t_complex> &model, const Image<t_complex> &residuals,
                      const t_real &operator_norm = 1);
+//! Adds the number of visibilities in each cell to the grid used by uniform and robust weighting
+void accumulate_weights(Matrix<t_complex> &gridded_weights, const Vector<t_real> &u,
+                        const Vector<t_real> &v, const t_real &oversample_factor);
+//! Calculate weightings from a grid accumulated over all visibilities
+Array<t_complex>
+finalize_weights(const Matrix<t_complex> &gridded_weights, const Vector<t_real> &u,
+                 const Vector<t_real> &v, const Vector<t_complex> &weights,
+                 const t_real &oversample_factor, const std::string &weighting_type,
+                 const t_real &R);
 //! Calculate weightings
 Array<t_complex> init_weights(const Vector<t_real> &u, const Vector<t_real> &v,
                               const Vector<t_complex> &weights, const t_real &oversample_factor,
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "purify/casacore.h"
+#include "purify/logging.h"
+#include "purify/pvis.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+namespace {
+void usage() {
+  std::cout << "Converts visibilities from a measurement set or a text .vis file to the binary "
+               "format read by purify.\n\n"
+               "purify_pvis [--w_term] [--stokes I] input output.pvis\n\n"
+               "--w_term: the text file has a w column\n"
+               "--stokes: polarisation read from a measurement set (default: I)\n";
+}
+}
+
+int main(int argc, char **argv) {
+  purify::logging::initialize();
+  purify::logging::set_level("info");
+
+  bool w_term = false;
+  std::string stokes = "I";
+  std::vector<std::string> files;
+  for(int i = 1; i < argc; ++i) {
+    std::string const argument = argv[i];
+    if(argument == "--w_term")
+      w_term = true;
+    else if(argument == "--stokes" and i + 1 < argc)
+      stokes = argv[++i];
+    else if(argument == "--help" or argument == "-h") {
+      usage();
+      return 0;
+    } else
+      files.push_back(argument);
+  }
+  if(files.size() != 2) {
+    usage();
+    return 1;
+  }
+  std::string const &input = files.front();
+  std::string const &output = files.back();
+
+  std::string format = input.substr(std::min(input.find_last_of("."), input.size()));
+  std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+  try {
+    auto const uv_data = (format == ".ms")
+                             ? casa::read_measurementset(input, casa::polarization(stokes))
+                             : utilities::read_visibility(input, w_term);
+    pvis::write(uv_data, output);
+  } catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
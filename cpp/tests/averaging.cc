@@ -0,0 +1,143 @@
+#include <set>
+#include "catch.hpp"
+#include "purify/averaging.h"
+#include "purify/types.h"
+
+using namespace purify;
+
+namespace {
+//! Two baselines tracing circles of different radii in the uv-plane
+std::tuple<utilities::vis_params, averaging::sample_params> circular_tracks() {
+  t_int const ntimes = 100;
+  t_real const radii[] = {100, 10000};
+  t_real const rate = 1e-3;
+  utilities::vis_params uv_vis;
+  averaging::sample_params samples;
+  uv_vis.u = Vector<t_real>::Zero(2 * ntimes);
+  uv_vis.v = Vector<t_real>::Zero(2 * ntimes);
+  uv_vis.w = Vector<t_real>::Zero(2 * ntimes);
+  uv_vis.vis = Vector<t_complex>::Constant(2 * ntimes, t_complex(2, -1));
+  uv_vis.weights = Vector<t_complex>::Ones(2 * ntimes);
+  samples.antenna1 = Vector<t_int>::Zero(2 * ntimes);
+  samples.antenna2 = Vector<t_int>::Zero(2 * ntimes);
+  samples.time = Vector<t_real>::Zero(2 * ntimes);
+  samples.frequency = Vector<t_real>::Constant(2 * ntimes, 1e9);
+  for(t_int b = 0; b < 2; ++b)
+    for(t_int t = 0; t < ntimes; ++t) {
+      t_int const i = b * ntimes + t;
+      uv_vis.u(i) = radii[b] * std::cos(rate * t);
+      uv_vis.v(i) = radii[b] * std::sin(rate * t);
+      samples.antenna2(i) = b + 1;
+      samples.time(i) = 10 * t;
+    }
+  return std::make_tuple(uv_vis, samples);
+}
+}
+
+TEST_CASE("averaging [combine]", "[combine]") {
+  utilities::vis_params uv_vis;
+  uv_vis.u = Vector<t_real>::Zero(4);
+  uv_vis.v = Vector<t_real>::Zero(4);
+  uv_vis.w = Vector<t_real>::Zero(4);
+  uv_vis.vis = Vector<t_complex>::Zero(4);
+  uv_vis.weights = Vector<t_complex>::Zero(4);
+  uv_vis.u << 1, 3, 0, 4;
+  uv_vis.v << 2, 2, 1, 1;
+  uv_vis.vis << t_complex(1, 0), t_complex(3, 0), t_complex(0, 1), t_complex(0, 5);
+  uv_vis.weights << 1, 1, 1, 3;
+  auto const averaged = averaging::combine(uv_vis, {0, 0, 1, 1});
+
+  REQUIRE(averaged.vis.size() == 2);
+  CHECK(std::abs(averaged.u(0) - 2) < 1e-12);
+  CHECK(std::abs(averaged.v(0) - 2) < 1e-12);
+  CHECK(std::abs(averaged.vis(0) - t_complex(2, 0)) < 1e-12);
+  CHECK(std::abs(averaged.weights(0) - std::sqrt(2.)) < 1e-12);
+  // inverse-variance weights are 1 and 9
+  CHECK(std::abs(averaged.u(1) - 3.6) < 1e-12);
+  CHECK(std::abs(averaged.vis(1) - t_complex(0, 4.6)) < 1e-12);
+  CHECK(std::abs(averaged.weights(1) - std::sqrt(10.)) < 1e-12);
+}
+
+TEST_CASE("averaging [smearing]", "[smearing]") {
+  t_real const tolerance = 0.01;
+  t_real const field_of_view = 0.01;
+  t_real const limit = averaging::smearing_limit(tolerance, field_of_view);
+  CHECK(std::abs(limit - std::sqrt(6 * tolerance) / (constant::pi * field_of_view)) < 1e-12);
+  CHECK_THROWS_AS(averaging::smearing_limit(-1, field_of_view), std::runtime_error);
+  CHECK_THROWS_AS(averaging::smearing_limit(tolerance, 0), std::runtime_error);
+  CHECK(std::abs(averaging::field_of_view_radius(2, 2, 3600 * 180 / constant::pi,
+                                                  3600 * 180 / constant::pi)
+                 - std::sqrt(2.))
+        < 1e-12);
+}
+
+TEST_CASE("averaging [baseline dependent]", "[baseline dependent]") {
+  utilities::vis_params uv_vis;
+  averaging::sample_params samples;
+  std::tie(uv_vis, samples) = circular_tracks();
+  t_real const tolerance = 0.01;
+  t_real const field_of_view = 0.01;
+  auto const groups
+      = averaging::baseline_dependent_groups(uv_vis, samples, tolerance, field_of_view);
+
+  std::set<t_int> short_groups, long_groups;
+  for(t_int i = 0; i < uv_vis.u.size(); ++i)
+    (samples.antenna2(i) == 1 ? short_groups : long_groups).insert(groups[i]);
+  CHECK(short_groups.size() < 10);
+  CHECK(long_groups.size() == 100);
+
+  // samples in a group stay within the smearing limit of each other
+  t_real const limit = averaging::smearing_limit(tolerance, field_of_view);
+  for(t_int i = 0; i < uv_vis.u.size(); ++i)
+    for(t_int j = 0; j < uv_vis.u.size(); ++j)
+      if(groups[i] == groups[j]) {
+        CHECK(samples.antenna2(i) == samples.antenna2(j));
+        CHECK(std::hypot(uv_vis.u(i) - uv_vis.u(j), uv_vis.v(i) - uv_vis.v(j)) <= limit);
+      }
+
+  auto const averaged
+      = averaging::baseline_dependent_averaging(uv_vis, samples, tolerance, field_of_view);
+  CHECK(averaged.vis.size() == short_groups.size() + long_groups.size());
+  CHECK(averaged.vis.isApprox(Vector<t_complex>::Constant(averaged.vis.size(), t_complex(2, -1))));
+  CHECK(std::abs(averaged.weights.squaredNorm() - uv_vis.weights.squaredNorm()) < 1e-8);
+}
+
+TEST_CASE("averaging [coalesce]", "[coalesce]") {
+  utilities::vis_params uv_vis;
+  uv_vis.u = Vector<t_real>::Zero(4);
+  uv_vis.v = Vector<t_real>::Zero(4);
+  uv_vis.w = Vector<t_real>::Zero(4);
+  uv_vis.vis = Vector<t_complex>::Zero(4);
+  uv_vis.weights = Vector<t_complex>::Ones(4);
+  uv_vis.u << 1, 1.001, 5, 1;
+  uv_vis.v << 2, 2.001, 2, 2;
+  uv_vis.vis << t_complex(1, 1), t_complex(3, 1), t_complex(0, 1), t_complex(2, 1);
+
+  SECTION("Exact duplicates") {
+    auto const groups = averaging::uv_groups(uv_vis, 0);
+    CHECK(groups == std::vector<t_int>({0, 1, 2, 0}));
+  }
+  SECTION("Within tolerance") {
+    utilities::vis_params merged;
+    std::vector<t_int> groups;
+    std::tie(merged, groups) = averaging::coalesce(uv_vis, 0.1);
+    REQUIRE(merged.vis.size() == 2);
+    CHECK(groups[0] == groups[1]);
+    CHECK(groups[0] == groups[3]);
+    CHECK(groups[0] != groups[2]);
+    CHECK(std::abs(merged.vis(groups[0]) - t_complex(2, 1)) < 1e-12);
+    CHECK(std::abs(merged.weights(groups[0]) - std::sqrt(3.)) < 1e-12);
+    CHECK(std::abs(merged.vis(groups[2]) - t_complex(0, 1)) < 1e-12);
+
+    auto const expanded = averaging::expand(merged.vis, groups);
+    REQUIRE(expanded.size() == 4);
+    CHECK(std::abs(expanded(2) - t_complex(0, 1)) < 1e-12);
+    CHECK(std::abs(expanded(3) - t_complex(2, 1)) < 1e-12);
+  }
+  SECTION("Across the boundary of a bin") {
+    uv_vis.u << 0.0999, 0.1001, 0.35, 0.19;
+    uv_vis.v << 2, 2, 2, 2;
+    auto const groups = averaging::uv_groups(uv_vis, 0.1);
+    CHECK(groups == std::vector<t_int>({0, 0, 1, 0}));
+  }
+}
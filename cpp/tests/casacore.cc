@@ -181,6 +181,61 @@ TEST_CASE("Channel iteration") {
   }
 }
 
+TEST_CASE("Single pass reader") {
+  using namespace purify;
+  namespace pc = purify::casa;
+  auto const filename = purify::notinstalled::ngc3256_ms();
+  auto const ms = pc::MeasurementSet(filename);
+  auto const channel = ms[17];
+  SECTION("One channel matches the channel wrapper") {
+    auto const uv_data
+        = pc::read_measurementset(filename, pc::MeasurementSet::ChannelWrapper::polarization::I,
+                                  std::vector<t_int>{17});
+    REQUIRE(uv_data.vis.size() == 141059);
+    CHECK(uv_data.vis.isApprox(channel.I()));
+    CHECK(uv_data.u.isApprox(channel.lambda_u()));
+    CHECK(uv_data.v.isApprox(-channel.lambda_v()));
+    CHECK(uv_data.w.isApprox(channel.lambda_w()));
+    purify::Vector<t_real> const sigma = channel.wI() * 2 * std::sqrt(2);
+    CHECK(uv_data.weights.real().isApprox(sigma.cwiseInverse()));
+    CHECK(std::abs(uv_data.ra - ms.right_ascension()) < 1e-8);
+    auto const samples = pc::read_measurementset_samples(filename, std::vector<t_int>{17});
+    CHECK(samples.time.isApprox(channel.time()));
+    CHECK(samples.frequency.isApprox(channel.frequencies()));
+  }
+  SECTION("Visibilities are ordered by channel, then row") {
+    auto const uv_data
+        = pc::read_measurementset(filename, pc::MeasurementSet::ChannelWrapper::polarization::I,
+                                  std::vector<t_int>{17, 18});
+    auto const next = ms[18];
+    // a channel is kept where none of its polarisations is flagged, as in the channel wrapper
+    REQUIRE(uv_data.vis.size() == channel.size() + next.size());
+    CHECK(uv_data.vis.head(channel.size()).isApprox(channel.I()));
+    CHECK(uv_data.vis.tail(next.size()).isApprox(next.I()));
+    CHECK(uv_data.u.tail(next.size()).isApprox(next.lambda_u()));
+    CHECK(std::abs(uv_data.average_frequency
+                   - pc::average_frequency(ms, "", std::vector<t_int>{17, 18}))
+          < 1e-8 * uv_data.average_frequency);
+    auto const samples = pc::read_measurementset_samples(filename, std::vector<t_int>{17, 18});
+    REQUIRE(samples.time.size() == uv_data.vis.size());
+    CHECK(samples.time.head(channel.size()).isApprox(channel.time()));
+    CHECK(samples.frequency.tail(next.size()).isApprox(next.frequencies()));
+  }
+  SECTION("Filters are clauses, as the default filter") {
+    auto const uv_data
+        = pc::read_measurementset(filename, pc::MeasurementSet::ChannelWrapper::polarization::I,
+                                  std::vector<t_int>{17}, "WHERE DATA_DESC_ID == 0");
+    auto const window = ms[std::make_tuple(17, std::string("DATA_DESC_ID == 0"))];
+    REQUIRE(window.size() > 0);
+    REQUIRE(window.size() < channel.size());
+    REQUIRE(uv_data.vis.size() == window.size());
+    CHECK(uv_data.vis.isApprox(window.I()));
+    auto const samples = pc::read_measurementset_samples(filename, std::vector<t_int>{17},
+                                                         "WHERE DATA_DESC_ID == 0");
+    CHECK(samples.time.isApprox(window.time()));
+  }
+}
+
 // TEST_CASE("Read Measurement") {
 //   purify::utilities::vis_params const vis_file =
 //   purify::utilities::read_visibility(vla_filename("at166B.3C129.c0I.vis"));
@@ -0,0 +1,94 @@
+#include <fstream>
+#include "catch.hpp"
+#include "purify/checkpoint.h"
+#include "purify/directories.h"
+
+using namespace purify;
+using namespace purify::notinstalled;
+
+namespace {
+checkpoint::SolverState random_state(t_uint const &iteration) {
+  checkpoint::SolverState state;
+  state.iteration = iteration;
+  state.gamma = 0.25 * iteration;
+  state.x = Vector<t_complex>::Random(64);
+  state.residual = Vector<t_complex>::Random(101);
+  state.lambda = Vector<t_complex>::Random(101);
+  state.z = Vector<t_complex>::Random(101);
+  state.l1_weights = Vector<t_real>::Random(3);
+  state.fingerprint = 0x0123456789abcdefull + iteration;
+  return state;
+}
+
+void check_equal(checkpoint::SolverState const &a, checkpoint::SolverState const &b) {
+  CHECK(a.iteration == b.iteration);
+  CHECK(a.gamma == b.gamma);
+  CHECK(a.x == b.x);
+  CHECK(a.residual == b.residual);
+  CHECK(a.lambda == b.lambda);
+  CHECK(a.z == b.z);
+  CHECK(a.l1_weights == b.l1_weights);
+  CHECK(a.fingerprint == b.fingerprint);
+}
+}
+
+TEST_CASE("Solver checkpoints [round trip]", "[checkpoint]") {
+  auto const state = random_state(7);
+  std::string const file_name = output_filename("solver_checkpoint");
+  checkpoint::write(state, file_name);
+  check_equal(checkpoint::read(file_name), state);
+  CHECK(not std::ifstream(file_name + ".tmp"));
+
+  SECTION("No l1 weights") {
+    auto unweighted = state;
+    unweighted.l1_weights.resize(0);
+    checkpoint::write(unweighted, file_name);
+    check_equal(checkpoint::read(file_name), unweighted);
+  }
+  SECTION("Truncated file") {
+    std::ifstream in(file_name, std::ios::binary);
+    std::string const contents((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+    std::ofstream(file_name, std::ios::binary).write(contents.data(), contents.size() - 8);
+    CHECK_THROWS_AS(checkpoint::read(file_name), std::runtime_error);
+  }
+  SECTION("Corrupted file") {
+    std::fstream file(file_name, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(100);
+    file.put('x');
+    file.close();
+    CHECK_THROWS_AS(checkpoint::read(file_name), std::runtime_error);
+  }
+  SECTION("Older version") {
+    std::fstream file(file_name, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(8);
+    file.put(1);
+    file.close();
+    CHECK_THROWS_AS(checkpoint::read(file_name), std::runtime_error);
+  }
+  SECTION("Not a checkpoint") {
+    std::ofstream(file_name) << std::string(200, 'x');
+    CHECK_THROWS_AS(checkpoint::read(file_name), std::runtime_error);
+  }
+}
+
+TEST_CASE("Background checkpoint writer", "[checkpoint]") {
+  std::string const file_name = output_filename("background_checkpoint");
+  auto const last = random_state(20);
+  {
+    checkpoint::Writer writer(file_name);
+    for(t_uint i = 1; i < 20; ++i)
+      writer.write(random_state(i));
+    writer.write(last);
+    writer.flush();
+    // queued states that were not written yet are replaced by the latest
+    CHECK(writer.written() >= 1);
+    CHECK(writer.written() <= 20);
+    check_equal(checkpoint::read(file_name), last);
+  }
+  SECTION("Errors are reported on the next call") {
+    checkpoint::Writer writer(output_filename("no_such_directory/checkpoint"));
+    writer.write(last);
+    CHECK_THROWS_AS(writer.flush(), std::runtime_error);
+  }
+}
@@ -0,0 +1,153 @@
+#include "catch.hpp"
+#include "purify/MeasurementOperator.h"
+#include "purify/clean.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+namespace {
+//! Two point sources observed with a random coverage
+std::tuple<MeasurementOperator, utilities::vis_params, Image<t_complex>> point_sources() {
+  t_int const imsize = 32;
+  auto uv_vis = utilities::random_sample_density(1000, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  MeasurementOperator const op(uv_vis, 4, 4, "kb", imsize, imsize, 20, 2);
+  Image<t_complex> model = Image<t_complex>::Zero(imsize, imsize);
+  model(10, 12) = 3;
+  model(20, 21) = 1;
+  uv_vis.vis = op.degrid(model);
+  return std::make_tuple(op, uv_vis, model);
+}
+}
+
+TEST_CASE("Clean [subtract psf]", "[psf]") {
+  Image<t_complex> psf = Image<t_complex>::Zero(5, 4);
+  psf(2, 2) = 1;
+  psf(0, 0) = 2;
+  Image<t_complex> residual = Image<t_complex>::Zero(5, 4);
+  clean::subtract_psf(residual, psf, 2, 1, 1);
+  CHECK(residual(1, 1) == t_complex(-2));
+  CHECK(residual.abs().sum() == Approx(2));
+  clean::subtract_psf(residual, psf, 1, 4, 3);
+  CHECK(residual(4, 3) == t_complex(-1));
+  CHECK(residual(2, 1) == t_complex(-2));
+  CHECK(residual.abs().sum() == Approx(5));
+}
+
+TEST_CASE("Clean [point spread function]", "[psf]") {
+  MeasurementOperator op;
+  utilities::vis_params uv_vis;
+  Image<t_complex> model;
+  std::tie(op, uv_vis, model) = point_sources();
+
+  auto const psf = clean::point_spread_function(op, uv_vis);
+  REQUIRE(psf.rows() == 2 * op.imsizey());
+  REQUIRE(psf.cols() == 2 * op.imsizex());
+  t_int y, x;
+  clean::peak(psf, y, x);
+  CHECK(y == op.imsizey());
+  CHECK(x == op.imsizex());
+  // sidelobes of a source near a corner are removed up to the opposite corner
+  Image<t_complex> point = Image<t_complex>::Zero(op.imsizey(), op.imsizex());
+  point(4, 5) = 1;
+  Image<t_complex> residual
+      = op.grid((op.degrid(point).array() * uv_vis.weights.array()).matrix());
+  t_real const far_sidelobes = residual.block(20, 20, 12, 12).abs().maxCoeff();
+  clean::subtract_psf(residual, psf, 1, 4, 5);
+  CHECK(residual.block(20, 20, 12, 12).abs().maxCoeff() < 0.1 * far_sidelobes);
+}
+
+TEST_CASE("Clean [hogbom]", "[hogbom]") {
+  MeasurementOperator op;
+  utilities::vis_params uv_vis;
+  Image<t_complex> model;
+  std::tie(op, uv_vis, model) = point_sources();
+
+  auto const clean_model = clean::clean(op, uv_vis, 500, 0.1, "hogbom");
+  CHECK(std::abs(clean_model.sum() - model.sum()) < 0.05 * std::abs(model.sum()));
+  CHECK(std::abs(clean_model(10, 12) - model(10, 12)) < 0.1);
+  CHECK(std::abs(clean_model(20, 21) - model(20, 21)) < 0.1);
+  Image<t_complex> const residual = op.grid(uv_vis.vis - op.degrid(clean_model));
+  Image<t_complex> const dirty = op.grid(uv_vis.vis);
+  CHECK(residual.abs().maxCoeff() < 0.05 * dirty.abs().maxCoeff());
+}
+
+TEST_CASE("Clean [steer]", "[steer]") {
+  MeasurementOperator op;
+  utilities::vis_params uv_vis;
+  Image<t_complex> model;
+  std::tie(op, uv_vis, model) = point_sources();
+
+  auto const clean_model = clean::clean(op, uv_vis, 100, 0.1, "steer");
+  Image<t_complex> const residual = op.grid(uv_vis.vis - op.degrid(clean_model));
+  Image<t_complex> const dirty = op.grid(uv_vis.vis);
+  CHECK(residual.abs().maxCoeff() < 0.2 * dirty.abs().maxCoeff());
+}
+
+TEST_CASE("Clean [clark]", "[clark]") {
+  MeasurementOperator op;
+  utilities::vis_params uv_vis;
+  Image<t_complex> model;
+  std::tie(op, uv_vis, model) = point_sources();
+
+  auto const clean_model = clean::clean(op, uv_vis, 500, 0.1, "clark", 0.2, 0.5, 11);
+  CHECK(std::abs(clean_model.sum() - model.sum()) < 0.05 * std::abs(model.sum()));
+  CHECK(std::abs(clean_model(10, 12) - model(10, 12)) < 0.1);
+  CHECK(std::abs(clean_model(20, 21) - model(20, 21)) < 0.1);
+  Image<t_complex> const residual = op.grid(uv_vis.vis - op.degrid(clean_model));
+  Image<t_complex> const dirty = op.grid(uv_vis.vis);
+  CHECK(residual.abs().maxCoeff() < 0.05 * dirty.abs().maxCoeff());
+
+  CHECK_THROWS_AS(clean::clean(op, uv_vis, 10, 0.1, "clark", 1.5), std::runtime_error);
+  CHECK_THROWS_AS(clean::clean(op, uv_vis, 10, 0.1, "clark", 0), std::runtime_error);
+}
+
+TEST_CASE("Clean [peak]", "[peak]") {
+  Image<t_complex> image = Image<t_complex>::Random(17, 13);
+  image(5, 7) = t_complex(3, -4);
+  image(9, 7) = t_complex(-5, 0);
+  t_int y, x;
+  CHECK(clean::peak(image, y, x) == Approx(5));
+  CHECK(y == 5);
+  CHECK(x == 7);
+}
+
+TEST_CASE("Clean [multiscale]", "[multiscale]") {
+  t_int const imsize = 32;
+  auto uv_vis = utilities::random_sample_density(1000, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  MeasurementOperator const op(uv_vis, 4, 4, "kb", imsize, imsize, 20, 2);
+  // extended source
+  Image<t_complex> const model = 10. * clean::scale_kernel(6, imsize, imsize);
+  CHECK(std::abs(model.sum() - 10.) < 1e-10);
+  uv_vis.vis = op.degrid(model);
+  Image<t_complex> const dirty = op.grid(uv_vis.vis);
+
+  MeasurementOperator measurements = op;
+  auto const multiscale_model = clean::multiscale_clean(measurements, uv_vis, 100, {0, 3, 6});
+  auto const hogbom_model = clean::clean(measurements, uv_vis, 100, 0.1, "hogbom");
+  Image<t_complex> const multiscale_residual
+      = op.grid(uv_vis.vis - op.degrid(multiscale_model));
+  Image<t_complex> const hogbom_residual = op.grid(uv_vis.vis - op.degrid(hogbom_model));
+  CHECK(multiscale_residual.abs().maxCoeff() < 0.1 * dirty.abs().maxCoeff());
+  CHECK(multiscale_residual.abs().maxCoeff() < hogbom_residual.abs().maxCoeff());
+  CHECK(std::abs(multiscale_model.sum() - model.sum()) < 0.1 * std::abs(model.sum()));
+}
+
+TEST_CASE("Clean [weighted point spread function]", "[psf]") {
+  // the psf is the response of op itself, with the weights W binned on its own grid
+  t_int const imsize = 32;
+  auto uv_vis = utilities::random_sample_density(1000, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  for(std::string const weighting : {"uniform", "robust"}) {
+    CAPTURE(weighting);
+    MeasurementOperator const op(uv_vis, 4, 4, "kb", imsize, imsize, 20, 2, 1, 1, weighting, 0);
+    auto const psf = clean::point_spread_function(op, uv_vis);
+    Image<t_complex> delta = Image<t_complex>::Zero(imsize, imsize);
+    delta(imsize / 2, imsize / 2) = 1;
+    Image<t_complex> const expected
+        = op.grid((op.degrid(delta).array() * uv_vis.weights.array()).matrix());
+    Image<t_complex> const centre = psf.block(imsize / 2, imsize / 2, imsize, imsize);
+    CHECK((centre - expected).abs().maxCoeff() < 1e-2 * expected.abs().maxCoeff());
+  }
+}
@@ -0,0 +1,109 @@
+#include <vector>
+#include "catch.hpp"
+#include "purify/convolution.h"
+#include "purify/types.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+namespace {
+//! Brute force linear convolution, cropped to the image around the centre of the kernel
+Image<t_complex> reference(const Image<t_complex> &image, const Image<t_complex> &kernel) {
+  Image<t_complex> output = Image<t_complex>::Zero(image.rows(), image.cols());
+  for(t_int x = 0; x < image.cols(); ++x)
+    for(t_int y = 0; y < image.rows(); ++y)
+      for(t_int j = 0; j < kernel.cols(); ++j)
+        for(t_int i = 0; i < kernel.rows(); ++i) {
+          t_int const yy = y - (i - kernel.rows() / 2);
+          t_int const xx = x - (j - kernel.cols() / 2);
+          if(yy >= 0 and yy < image.rows() and xx >= 0 and xx < image.cols())
+            output(y, x) += kernel(i, j) * image(yy, xx);
+        }
+  return output;
+}
+}
+
+TEST_CASE("Convolution [crop]", "[crop]") {
+  Image<t_complex> kernel = Image<t_complex>::Zero(9, 8);
+  kernel(4, 4) = 1;
+  kernel(3, 6) = 0.5;
+  kernel(0, 0) = 1e-8;
+  auto const cropped = convolution::crop(kernel, 1e-6);
+  CHECK(cropped.rows() == 3);
+  CHECK(cropped.cols() == 5);
+  CHECK(cropped(1, 2) == t_complex(1));
+  CHECK(cropped(0, 4) == t_complex(0.5));
+  CHECK(convolution::crop(kernel).rows() == 9);
+  // even sized kernels keep their first column, with a zero column added at the end
+  auto const even = convolution::crop(kernel);
+  CHECK(even.cols() == 9);
+  CHECK(even(0, 0) == t_complex(1e-8));
+  CHECK(even.col(8).isZero(0));
+}
+
+TEST_CASE("Convolution [kernel]", "[kernel]") {
+  Image<t_complex> const image = Image<t_complex>::Random(100, 90);
+  SECTION("Tiny kernel is applied directly") {
+    Image<t_complex> const kernel = Image<t_complex>::Random(3, 3);
+    convolution::Kernel const convolve(kernel, image.rows(), image.cols());
+    CHECK(convolve.tile_rows() == 0);
+    CHECK(convolve(image).isApprox(reference(image, kernel)));
+  }
+  SECTION("Small kernel on a large image uses overlap-add") {
+    Image<t_complex> const large = Image<t_complex>::Random(600, 600);
+    Image<t_complex> kernel = Image<t_complex>::Zero(100, 90);
+    kernel.block(47, 42, 7, 7) = Image<t_complex>::Random(7, 7);
+    convolution::Kernel const convolve(kernel, large.rows(), large.cols());
+    CHECK(convolve.kernel().rows() == 7);
+    CHECK(convolve.tile_rows() > 0);
+    CHECK(convolve.tile_rows() < large.rows());
+    CHECK(convolve(large).isApprox(reference(large, kernel)));
+  }
+  SECTION("Large kernel uses a single tile") {
+    Image<t_complex> const kernel = Image<t_complex>::Random(100, 90);
+    convolution::Kernel const convolve(kernel, image.rows(), image.cols());
+    CHECK(convolve.tile_rows() == image.rows());
+    CHECK(convolve(image).isApprox(reference(image, kernel)));
+  }
+  SECTION("Sparse image") {
+    Image<t_complex> sparse = Image<t_complex>::Zero(100, 90);
+    sparse(3, 80) = 2;
+    sparse(60, 10) = t_complex(0, 1);
+    Image<t_complex> kernel = Image<t_complex>::Zero(21, 21);
+    kernel.block(5, 5, 11, 11) = Image<t_complex>::Random(11, 11);
+    convolution::Kernel const convolve(kernel, sparse.rows(), sparse.cols());
+    CHECK(convolve(sparse).isApprox(reference(sparse, kernel)));
+  }
+  SECTION("One kernel shared across threads") {
+    Image<t_complex> const kernel = Image<t_complex>::Random(100, 90);
+    convolution::Kernel const convolve(kernel, image.rows(), image.cols());
+    Image<t_complex> const expected = convolve(image);
+    std::vector<Image<t_complex>> results(8);
+#pragma omp parallel for
+    for(t_int i = 0; i < static_cast<t_int>(results.size()); ++i)
+      results[i] = convolve(image);
+    for(auto const &result : results)
+      CHECK(result.isApprox(expected, 1e-12));
+  }
+  CHECK_THROWS_AS(
+      convolution::Kernel(Image<t_complex>::Ones(3, 3), 10, 10)(Image<t_complex>::Ones(5, 5)),
+      std::runtime_error);
+}
+
+TEST_CASE("Convolution [full]", "[full]") {
+  Image<t_complex> const a = Image<t_complex>::Random(7, 6);
+  Image<t_complex> const b = Image<t_complex>::Random(12, 11);
+  Image<t_complex> expected = Image<t_complex>::Zero(18, 16);
+  for(t_int j = 0; j < a.cols(); ++j)
+    for(t_int i = 0; i < a.rows(); ++i)
+      expected.block(i, j, b.rows(), b.cols()) += a(i, j) * b;
+  CHECK(convolution::full(a, b).isApprox(expected));
+  CHECK(convolution::full(b, a).isApprox(expected));
+  CHECK(convolution::full(a.topLeftCorner(2, 2), b)
+            .isApprox(convolution::full(b, a.topLeftCorner(2, 2))));
+
+  auto const padded = utilities::convolution_operator(a, b);
+  CHECK(padded.rows() == 19);
+  CHECK(padded.cols() == 17);
+  CHECK(padded.topLeftCorner(18, 16).isApprox(expected));
+}
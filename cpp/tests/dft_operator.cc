@@ -0,0 +1,38 @@
+#include "catch.hpp"
+#include "purify/DFTOperator.h"
+#include "purify/MeasurementOperator.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+TEST_CASE("DFT operator [degrid]", "[degrid]") {
+  t_int const imsize = 32;
+  auto uv_vis = utilities::random_sample_density(1000, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  MeasurementOperator const op(uv_vis, 4, 4, "kb", imsize, imsize, 20, 2);
+  DFTOperator const dft(op, uv_vis);
+  CHECK(dft.crossover() >= 1);
+
+  std::vector<point_component> const components
+      = {{10, 12, t_complex(3, 0)}, {20, 21, t_complex(1, -1)}, {4, 27, t_complex(0, 2)}};
+  Image<t_complex> model = Image<t_complex>::Zero(imsize, imsize);
+  for(auto const &component : components)
+    model(component.y, component.x) = component.flux;
+  Vector<t_complex> const expected = op.degrid(model);
+
+  // the fft path is only as accurate as the gridding kernel, a few percent for Ju = Jv = 4
+  SECTION("Point components") {
+    Vector<t_complex> const predicted = dft.degrid(components);
+    REQUIRE(predicted.size() == expected.size());
+    CHECK((predicted - expected).norm() < 5e-2 * expected.norm());
+  }
+  SECTION("Sparse image") {
+    Vector<t_complex> const predicted = dft.degrid(model);
+    CHECK((predicted - expected).norm() < 5e-2 * expected.norm());
+  }
+  SECTION("Dense image falls back on the fft") {
+    Image<t_complex> const dense = Image<t_complex>::Random(imsize, imsize);
+    if(dft.crossover() < dense.size())
+      CHECK(dft.degrid(dense).isApprox(op.degrid(dense)));
+  }
+}
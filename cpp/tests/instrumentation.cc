@@ -0,0 +1,124 @@
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include "catch.hpp"
+#include "purify/instrumentation.h"
+
+using namespace purify;
+
+TEST_CASE("Stage timers", "[instrumentation]") {
+  using namespace instrumentation;
+  reset();
+  CHECK(statistics(Stage::degrid).calls == 0);
+  {
+    ScopedTimer const timer(Stage::degrid);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  {
+    ScopedTimer const timer(Stage::degrid);
+  }
+  {
+    ScopedTimer const disabled(Stage::degrid, false);
+  }
+  auto const degrid = statistics(Stage::degrid);
+  CHECK(degrid.calls == 2);
+  CHECK(degrid.seconds >= 0.02);
+  CHECK(degrid.seconds < 10);
+  CHECK(statistics(Stage::grid).calls == 0);
+
+  std::istringstream names(column_names());
+  std::istringstream values(columns());
+  t_uint nnames = 0;
+  t_uint nvalues = 0;
+  for(std::string entry; names >> entry;)
+    ++nnames;
+  for(std::string entry; values >> entry;)
+    ++nvalues;
+  CHECK(nnames == number_of_stages);
+  CHECK(nvalues == number_of_stages);
+
+  std::ostringstream table;
+  summary(table);
+  CHECK(table.str().find("degrid") != std::string::npos);
+  CHECK(table.str().find("power_method") == std::string::npos);
+
+  reset();
+  CHECK(statistics(Stage::degrid).calls == 0);
+  CHECK(statistics(Stage::degrid).seconds == 0);
+}
+
+TEST_CASE("Trace events", "[instrumentation]") {
+  using namespace instrumentation;
+  auto const before = traced_events();
+  {
+    ScopedEvent const event("not traced");
+  }
+  CHECK(traced_events() == before);
+
+  enable_tracing();
+  CHECK(tracing());
+  {
+    ScopedEvent const outer("outer");
+    ScopedTimer const timer(Stage::grid);
+  }
+  std::thread([]() { ScopedEvent const event("other thread"); }).join();
+  enable_tracing(false);
+  CHECK(traced_events() == before + 3);
+
+  std::ostringstream trace;
+  write_trace(trace);
+  auto const json = trace.str();
+  CHECK(json.find("\"traceEvents\"") != std::string::npos);
+  CHECK(json.find("\"name\": \"outer\"") != std::string::npos);
+  CHECK(json.find("\"name\": \"grid\"") != std::string::npos);
+  CHECK(json.find("\"name\": \"other thread\"") != std::string::npos);
+  CHECK(json.find("not traced") == std::string::npos);
+}
+
+TEST_CASE("Hardware counters", "[instrumentation]") {
+  using namespace instrumentation;
+  reset();
+  if(not enable_hardware_counters()) {
+    // e.g. no access to perf events on this machine, timers carry on without counts
+    CHECK(not hardware_counters());
+    ScopedTimer const timer(Stage::grid);
+  } else {
+    CHECK(hardware_counters());
+    {
+      ScopedTimer const timer(Stage::grid);
+      volatile t_real sum = 0;
+      for(t_int i = 0; i < 1000000; ++i)
+        sum = sum + i;
+    }
+    auto const grid = statistics(Stage::grid);
+    CHECK(grid.cycles > 0);
+    CHECK(grid.instructions > 1000000);
+    CHECK(grid.ipc() > 0);
+    std::ostringstream table;
+    summary(table, 100);
+    CHECK(table.str().find("IPC") != std::string::npos);
+    CHECK(table.str().find("misses/vis") != std::string::npos);
+    // threads started after the counters were enabled inherit them
+    reset();
+    {
+      ScopedTimer const timer(Stage::grid);
+      std::thread worker([]() {
+        volatile t_real sum = 0;
+        for(t_int i = 0; i < 1000000; ++i)
+          sum = sum + i;
+      });
+      worker.join();
+    }
+    CHECK(statistics(Stage::grid).instructions > 1000000);
+  }
+  CHECK(statistics(Stage::grid).calls == 1);
+  reset();
+  CHECK(statistics(Stage::grid).cycles == 0);
+}
+
+TEST_CASE("Memory of the process", "[instrumentation]") {
+#ifdef __linux__
+  CHECK(instrumentation::resident_bytes() > 0);
+  CHECK(instrumentation::peak_resident_bytes() >= instrumentation::resident_bytes());
+#endif
+}
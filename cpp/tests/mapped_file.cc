@@ -0,0 +1,23 @@
+#include <fstream>
+#include "catch.hpp"
+#include "purify/directories.h"
+#include "purify/mapped_file.h"
+
+using namespace purify;
+using namespace purify::notinstalled;
+
+TEST_CASE("Mapped file [contents]", "[mapped_file]") {
+  std::string const file_name = output_filename("mapped_file.txt");
+  { std::ofstream(file_name) << "some contents\n"; }
+  MappedFile const file(file_name, true);
+  REQUIRE(file.size() == 14);
+  CHECK(std::string(file.data(), file.size()) == "some contents\n");
+
+  std::string const empty_name = output_filename("mapped_file_empty.txt");
+  { std::ofstream const touch(empty_name); }
+  MappedFile const empty(empty_name);
+  CHECK(empty.size() == 0);
+  CHECK(empty.data() == nullptr);
+
+  CHECK_THROWS_AS(MappedFile(output_filename("no_such_file.txt")), std::runtime_error);
+}
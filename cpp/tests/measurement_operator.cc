@@ -3411,3 +3411,73 @@ TEST_CASE("Measurement Operator [Degridding]", "[Degridding]") {
   //  CHECK(std::abs(std::abs(vis_random(i)/oversample - 1.)) < 1e-1);
  // }
  }
+
+TEST_CASE("Measurement Operator [Chunks]", "[Chunks]") {
+  // an operator built chunk by chunk matches one built from all visibilities at once
+  auto uv_vis = utilities::random_sample_density(1000, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  uv_vis.weights = Vector<t_complex>::Random(uv_vis.u.size()).array().abs() + 0.5;
+  t_int const imsize = 64;
+  t_real const over_sample = 2;
+  MeasurementOperator op(uv_vis, 4, 4, "kb", imsize, imsize, 20, over_sample);
+
+  auto chunked = MeasurementOperator().Ju(4).Jv(4).kernel_name("kb").imsizex(imsize).imsizey(
+      imsize);
+  chunked.init_gridding();
+  CHECK(chunked.S.isApprox(op.S));
+  t_int const ftsize = imsize * over_sample;
+  Matrix<t_complex> gridded_weights = Matrix<t_complex>::Zero(ftsize, ftsize);
+  std::vector<t_tripletList> entries;
+  t_int const chunk = 300;
+  for(t_int first = 0; first < uv_vis.u.size(); first += chunk) {
+    t_int const n = std::min<t_int>(chunk, uv_vis.u.size() - first);
+    utilities::vis_params part;
+    part.u = uv_vis.u.segment(first, n);
+    part.v = uv_vis.v.segment(first, n);
+    part.units = uv_vis.units;
+    auto const scaled = chunked.grid_units(part);
+    utilities::accumulate_weights(gridded_weights, scaled.u, scaled.v, over_sample);
+    auto const part_entries = chunked.interpolation_entries(scaled.u, scaled.v, first);
+    entries.insert(entries.end(), part_entries.begin(), part_entries.end());
+  }
+  auto const scaled = chunked.grid_units(uv_vis);
+  for(auto const weighting : {"natural", "uniform", "robust"}) {
+    Array<t_complex> const expected = utilities::init_weights(
+        scaled.u, scaled.v, uv_vis.weights, over_sample, weighting, 0, ftsize, ftsize);
+    Array<t_complex> const weights = utilities::finalize_weights(
+        gridded_weights, scaled.u, scaled.v, uv_vis.weights, over_sample, weighting, 0);
+    CHECK(weights.isApprox(expected));
+  }
+  chunked.init_operator(op.W, entries);
+  CHECK(chunked.G.rows() == op.G.rows());
+  CHECK(chunked.G.cols() == op.G.cols());
+  CHECK(Matrix<t_complex>(chunked.G - op.G).norm() < 1e-12 * Matrix<t_complex>(op.G).norm());
+  // the power method starts from a random vector
+  CHECK(std::abs(chunked.norm - op.norm) < 1e-2 * op.norm);
+}
+
+TEST_CASE("Measurement Operator [Memory]", "[Memory]") {
+  auto uv_vis = utilities::random_sample_density(1000, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  t_real const over_sample = 2;
+  for(t_int const imsize : {32, 64, 100}) {
+    for(bool const use_w_term : {false, true}) {
+      CAPTURE(imsize);
+      CAPTURE(use_w_term);
+      auto const estimate = MeasurementOperator::estimate_memory(uv_vis.u.size(), 4, 4, imsize,
+                                                                 imsize, over_sample);
+      MeasurementOperator const op(uv_vis, 4, 4, "kb", imsize, imsize, 20, over_sample, 1, 1,
+                                   "none", 0, use_w_term);
+      auto const footprint = op.memory_footprint();
+      CHECK(footprint.interpolation_matrix == estimate.interpolation_matrix);
+      CHECK(footprint.gridding_correction == estimate.gridding_correction);
+      CHECK(footprint.weights == estimate.weights);
+      CHECK(footprint.fft_grids == estimate.fft_grids);
+      // entries of nearby pixels can fall on the same cell of the grid
+      CHECK(footprint.adjoint <= estimate.adjoint);
+      CHECK(footprint.persistent() == estimate.persistent());
+      CHECK(estimate.peak() > estimate.persistent());
+      CHECK(estimate.interpolation_matrix > 1000 * 16 * sizeof(t_complex));
+    }
+  }
+}
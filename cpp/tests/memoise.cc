@@ -0,0 +1,40 @@
+#include "catch.hpp"
+#include "purify/memoise.h"
+
+using namespace purify;
+
+TEST_CASE("Memoised linear transform", "[memoise]") {
+  Matrix<t_complex> const matrix = Matrix<t_complex>::Random(7, 5);
+  t_int calls = 0;
+  auto direct = [&matrix, &calls](Vector<t_complex> &out, Vector<t_complex> const &x) {
+    ++calls;
+    out = matrix * x;
+  };
+  auto adjoint = [&matrix, &calls](Vector<t_complex> &out, Vector<t_complex> const &x) {
+    ++calls;
+    out = matrix.adjoint() * x;
+  };
+  auto const transform = sopt::linear_transform<Vector<t_complex>>(direct, {{0, 1, 7}}, adjoint,
+                                                                   {{0, 1, 5}});
+  auto const memoised = memoised_linear_transform(transform);
+  // copies share the results
+  auto const copy = memoised;
+
+  Vector<t_complex> x = Vector<t_complex>::Random(5);
+  Vector<t_complex> const y = memoised * x;
+  CHECK(y.isApprox(matrix * x));
+  CHECK(calls == 1);
+  CHECK((copy * x).isApprox(y));
+  CHECK(calls == 1);
+  x(2) += 1;
+  CHECK((copy * x).isApprox(matrix * x));
+  CHECK(calls == 2);
+
+  Vector<t_complex> const z = Vector<t_complex>::Random(7);
+  CHECK((memoised.adjoint() * z).isApprox(matrix.adjoint() * z));
+  CHECK((memoised.adjoint() * z).isApprox(matrix.adjoint() * z));
+  // the adjoint is not remembered, and does not forget the forward direction
+  CHECK(calls == 4);
+  CHECK((memoised * x).isApprox(matrix * x));
+  CHECK(calls == 4);
+}
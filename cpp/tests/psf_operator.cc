@@ -0,0 +1,57 @@
+#include "catch.hpp"
+#include "purify/PSFOperator.h"
+#include "purify/clean.h"
+#include "purify/convolution.h"
+#include "purify/types.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+TEST_CASE("PSF operator [convolution]", "[convolution]") {
+  t_int const rows = 20;
+  t_int const cols = 16;
+  Image<t_complex> const psf = Image<t_real>::Random(2 * rows, 2 * cols).cast<t_complex>();
+  PSFOperator const op(psf, rows, cols, 200);
+  REQUIRE(op.norm() > 0);
+
+  Image<t_complex> const image = Image<t_complex>::Random(rows, cols);
+  SECTION("Forward is a linear convolution") {
+    CHECK(op.forward(image).isApprox(convolution::direct(image, psf) / op.norm()));
+    Image<t_complex> const real_image = image.real().cast<t_complex>();
+    CHECK(op.forward(real_image).imag().isZero(0));
+  }
+  SECTION("Adjoint") {
+    Image<t_complex> const other = Image<t_complex>::Random(rows, cols);
+    t_complex const lhs = (op.forward(image) * other.conjugate()).sum();
+    t_complex const rhs = (image * op.adjoint(other).conjugate()).sum();
+    CHECK(std::abs(lhs - rhs) < 1e-8 * std::abs(lhs));
+  }
+  SECTION("Normalised") {
+    Image<t_complex> x = Image<t_complex>::Random(rows, cols);
+    for(t_int i = 0; i < 50; ++i) {
+      x = op.adjoint(op.forward(x));
+      x /= x.matrix().norm();
+    }
+    CHECK(op.adjoint(op.forward(x)).matrix().norm() == Approx(1).epsilon(1e-2));
+  }
+  CHECK_THROWS_AS(op.forward(Image<t_complex>::Zero(rows + 1, cols)), std::runtime_error);
+}
+
+TEST_CASE("PSF operator [Memory]", "[Memory]") {
+  auto uv_vis = utilities::random_sample_density(500, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  for(t_int const imsize : {16, 24, 32}) {
+    CAPTURE(imsize);
+    MeasurementOperator const measurements(uv_vis, 4, 4, "kb", imsize, imsize, 20, 2);
+    PSFOperator const op(clean::point_spread_function(measurements, uv_vis), imsize, imsize, 20);
+    auto const estimate = PSFOperator::estimate_memory(uv_vis.u.size(), 4, 4, imsize, imsize, 2);
+    auto const footprint = op.memory_footprint(measurements.memory_footprint());
+    CHECK(footprint.solver == estimate.solver);
+    CHECK(footprint.persistent() == estimate.persistent());
+    // the psf comes from an operator over four times the pixels
+    CHECK(estimate.solver_construction
+          > MeasurementOperator::estimate_memory(uv_vis.u.size(), 4, 4, 2 * imsize, 2 * imsize, 2)
+                .persistent());
+    CHECK(estimate.peak() > estimate.persistent());
+  }
+}
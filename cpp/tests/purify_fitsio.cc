@@ -12,3 +12,37 @@ TEST_CASE("Purify fitsio", "[readwrite]") {
   CAPTURE(input2);
   CHECK(input.isApprox(input2, 1e-6));
 }
+
+TEST_CASE("Asynchronous fits writer", "[async]") {
+  std::string const fits_name = output_filename("fits_async_output.fits");
+  Image<t_real> last;
+  t_uint queued = 0;
+  {
+    // nothing is started or written without images
+    pfitsio::AsyncWriter idle;
+    idle.flush();
+    CHECK(idle.written() == 0);
+  }
+  {
+    pfitsio::AsyncWriter writer(2);
+    pfitsio::header_params header;
+    header.fits_name = fits_name;
+    for(t_int i = 0; i < 10; ++i) {
+      Image<t_real> snapshot = Image<t_real>::Random(32, 16);
+      last = snapshot;
+      writer.write2d_header(std::move(snapshot), header);
+      CHECK(snapshot.size() == 0);
+      ++queued;
+    }
+    writer.flush();
+    CHECK(writer.written() + writer.coalesced() == queued);
+    CHECK(writer.written() >= 1);
+    // only the latest snapshot of a file is kept
+    CHECK(pfitsio::read2d(fits_name).real().isApprox(last, 1e-6));
+
+    header.fits_name = output_filename("no_such_directory/fits_async_output.fits");
+    Image<t_real> image = Image<t_real>::Zero(4, 4);
+    writer.write2d_header(std::move(image), header);
+    CHECK_THROWS(writer.flush());
+  }
+}
@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <fstream>
+#include "catch.hpp"
+#include "purify/directories.h"
+#include "purify/pvis.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+using namespace purify::notinstalled;
+
+TEST_CASE("Binary visibilities [round trip]", "[pvis]") {
+  auto uv_data = utilities::random_sample_density(1001, 0, constant::pi / 3);
+  uv_data.vis = Vector<t_complex>::Random(uv_data.u.size());
+  uv_data.weights = Vector<t_complex>::Random(uv_data.u.size());
+  uv_data.units = "radians";
+  uv_data.ra = 1.5;
+  uv_data.dec = -0.5;
+  uv_data.average_frequency = 1400;
+  std::string const file_name = output_filename("round_trip.pvis");
+  pvis::write(uv_data, file_name);
+
+  pvis::MappedVisibilities const mapped(file_name);
+  REQUIRE(mapped.size() == uv_data.u.size());
+  CHECK(mapped.u() == uv_data.u);
+  CHECK(mapped.v() == uv_data.v);
+  CHECK(mapped.w() == uv_data.w);
+  CHECK(mapped.vis() == uv_data.vis);
+  CHECK(mapped.weights() == uv_data.weights);
+  CHECK(mapped.units() == "radians");
+  CHECK(mapped.ra() == 1.5);
+  CHECK(mapped.dec() == -0.5);
+  CHECK(mapped.average_frequency() == 1400);
+  for(auto const data : {reinterpret_cast<const char *>(mapped.u().data()),
+                         reinterpret_cast<const char *>(mapped.w().data()),
+                         reinterpret_cast<const char *>(mapped.weights().data())})
+    CHECK(reinterpret_cast<std::uintptr_t>(data) % 64 == 0);
+
+  auto const copy = pvis::read(file_name);
+  CHECK(copy.v == uv_data.v);
+  CHECK(copy.vis == uv_data.vis);
+  CHECK(copy.units == "radians");
+
+  SECTION("Missing w column is written as zeros") {
+    uv_data.w.resize(0);
+    pvis::write(uv_data, file_name);
+    CHECK(pvis::read(file_name).w.isZero(0));
+  }
+  SECTION("Truncated file") {
+    std::ifstream in(file_name, std::ios::binary);
+    std::string const contents((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+    std::ofstream(file_name, std::ios::binary).write(contents.data(), contents.size() - 8);
+    CHECK_THROWS_AS(pvis::read(file_name), std::runtime_error);
+  }
+  SECTION("Not a binary visibility file") {
+    std::ofstream(file_name) << std::string(200, 'x');
+    CHECK_THROWS_AS(pvis::read(file_name), std::runtime_error);
+  }
+}
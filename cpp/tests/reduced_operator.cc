@@ -0,0 +1,66 @@
+#include "catch.hpp"
+#include "purify/MeasurementOperator.h"
+#include "purify/ReducedOperator.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+TEST_CASE("Reduced Operator", "[reduced]") {
+  t_int const width = 32;
+  t_int const height = 32;
+  auto uv_vis = utilities::random_sample_density(500, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  uv_vis.weights = Vector<t_complex>::Random(uv_vis.u.size()).array().abs().cast<t_complex>() + 1.;
+  MeasurementOperator const measurements(uv_vis, 4, 4, "kb", width, height, 20, 2);
+  Image<t_complex> const image = Image<t_complex>::Random(height, width);
+  uv_vis.vis = measurements.degrid(image);
+  ReducedOperator const reduced(measurements, uv_vis, 100);
+
+  SECTION("Fewer measurements than grid cells") {
+    CHECK(reduced.size() > 0);
+    CHECK(reduced.size() <= measurements.ftsizeu() * measurements.ftsizev());
+    CHECK(reduced.data().size() == reduced.size());
+  }
+  SECTION("Adjoint") {
+    // the inverse fft is normalised, so grid is the adjoint of degrid up to the size of the grid
+    t_real const ftsize = measurements.ftsizeu() * measurements.ftsizev();
+    Vector<t_complex> const y = Vector<t_complex>::Random(reduced.size());
+    Image<t_complex> const x = Image<t_complex>::Random(height, width);
+    t_complex const forward = y.dot(reduced.degrid(x));
+    t_complex const backward = ftsize * (reduced.grid(y).conjugate() * x).sum();
+    CHECK(std::abs(forward - backward) < 1e-8 * std::abs(forward));
+  }
+  SECTION("Noise free data") {
+    CHECK(reduced.degrid(image).isApprox(reduced.data(), 1e-8));
+  }
+  SECTION("Normalised") {
+    Image<t_complex> const x = Image<t_complex>::Random(height, width);
+    CHECK(reduced.grid(reduced.degrid(x)).matrix().norm() <= 1.01 * x.matrix().norm());
+  }
+  SECTION("Wrong visibilities") {
+    auto wrong = uv_vis;
+    wrong.vis = uv_vis.vis.head(10);
+    CHECK_THROWS_AS(ReducedOperator(measurements, wrong), std::runtime_error);
+  }
+}
+
+TEST_CASE("Reduced Operator [Memory]", "[Memory]") {
+  auto uv_vis = utilities::random_sample_density(500, 0, constant::pi / 3);
+  uv_vis.units = "radians";
+  for(t_int const imsize : {16, 32, 64}) {
+    CAPTURE(imsize);
+    MeasurementOperator const measurements(uv_vis, 4, 4, "kb", imsize, imsize, 20, 2);
+    ReducedOperator const reduced(measurements, uv_vis, 20);
+    auto const estimate
+        = ReducedOperator::estimate_memory(uv_vis.u.size(), 4, 4, imsize, imsize, 2);
+    auto const footprint = reduced.memory_footprint();
+    CHECK(footprint.interpolation_matrix == estimate.interpolation_matrix);
+    CHECK(footprint.solver > 0);
+    CHECK(footprint.solver <= estimate.solver);
+    CHECK(footprint.solver_construction <= estimate.solver_construction);
+    CHECK(estimate.persistent()
+          == MeasurementOperator::estimate_memory(uv_vis.u.size(), 4, 4, imsize, imsize, 2)
+                     .persistent()
+                 + estimate.solver);
+  }
+}
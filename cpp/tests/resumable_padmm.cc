@@ -0,0 +1,140 @@
+#include <cstdlib>
+#include <sopt/linear_transform.h>
+#include "catch.hpp"
+#include "purify/ResumablePADMM.h"
+#include "purify/checkpoint.h"
+#include "purify/directories.h"
+
+using namespace purify;
+using namespace purify::notinstalled;
+
+namespace {
+//! Small problem, the same for each solver of a test
+struct Problem {
+  Problem() : image_size(64), data_size(101) {
+    std::srand(7);
+    matrix = Matrix<t_complex>::Random(data_size, image_size);
+    Vector<t_complex> truth = Vector<t_complex>::Zero(image_size);
+    truth(5) = 1;
+    truth(40) = 0.5;
+    target = matrix * truth + 1e-3 * Vector<t_complex>::Random(data_size);
+    weights = (0.5 + Vector<t_real>::Random(data_size).array().abs()).matrix();
+  }
+
+  ResumablePADMM solver(t_uint const &itermax) const {
+    auto const A = matrix;
+    auto const Phi = sopt::linear_transform<Vector<t_complex>>(
+        [A](Vector<t_complex> &out, Vector<t_complex> const &x) { out = A * x; },
+        {{static_cast<t_int>(data_size), static_cast<t_int>(image_size), 0}},
+        [A](Vector<t_complex> &out, Vector<t_complex> const &x) { out = A.adjoint() * x; },
+        {{static_cast<t_int>(image_size), static_cast<t_int>(data_size), 0}});
+    ResumablePADMM padmm(target);
+    padmm.itermax(itermax)
+        .gamma(1e-2)
+        .relative_variation(1e-4)
+        .l2ball_proximal_epsilon(1e-2)
+        .l2ball_proximal_weights(weights)
+        .tight_frame(false)
+        .l1_proximal_tolerance(1e-3)
+        .l1_proximal_nu(1)
+        .l1_proximal_itermax(50)
+        .l1_proximal_positivity_constraint(true)
+        .l1_proximal_real_constraint(true)
+        .residual_convergence(0)
+        .lagrange_update_scale(0.9)
+        .nu(matrix.norm() * matrix.norm())
+        .Psi(sopt::linear_transform_identity<t_complex>())
+        .Phi(Phi);
+    return padmm;
+  }
+
+  checkpoint::SolverState initial_state(ResumablePADMM const &padmm) const {
+    Vector<t_complex> const x = Vector<t_complex>::Zero(image_size);
+    return padmm.initial_state(x, target);
+  }
+
+  t_uint image_size;
+  t_uint data_size;
+  Matrix<t_complex> matrix;
+  Vector<t_complex> target;
+  Vector<t_real> weights;
+};
+}
+
+TEST_CASE("Resumed solver matches an uninterrupted one", "[checkpoint]") {
+  Problem const problem;
+  t_uint const N = 10;
+  std::string const file_name = output_filename("resumed_solver_checkpoint");
+
+  auto uninterrupted = problem.solver(N);
+  auto expected = problem.initial_state(uninterrupted);
+  uninterrupted.solve(expected);
+  REQUIRE(expected.iteration == N);
+
+  auto first_half = problem.solver(N / 2);
+  auto state = problem.initial_state(first_half);
+  state.fingerprint = first_half.fingerprint();
+  t_uint checkpoints = 0;
+  first_half.checkpoint(
+      [&file_name, &checkpoints](checkpoint::SolverState const &saved) {
+        checkpoint::write(saved, file_name);
+        ++checkpoints;
+      },
+      0);
+  CHECK(not first_half.solve(state));
+  // stopped by itermax before converging, so the state is saved once at the end
+  CHECK(checkpoints == 1);
+
+  auto second_half = problem.solver(N);
+  auto resumed = checkpoint::read(file_name);
+  CHECK(resumed.fingerprint == second_half.fingerprint());
+  CHECK(resumed.iteration == N / 2);
+  second_half.solve(resumed);
+
+  CHECK(resumed.iteration == expected.iteration);
+  CHECK(resumed.gamma == expected.gamma);
+  CHECK(resumed.x == expected.x);
+  CHECK(resumed.residual == expected.residual);
+  CHECK(resumed.lambda == expected.lambda);
+  CHECK(resumed.z == expected.z);
+}
+
+TEST_CASE("Resumable solver converges as sopt's", "[checkpoint]") {
+  // the convergence criteria are duplicated from sopt, the result must not drift from it
+  Problem const problem;
+  auto padmm = problem.solver(500);
+  padmm.relative_variation(1e-2).residual_convergence(1);
+  auto state = problem.initial_state(padmm);
+  bool const converged = padmm.solve(state);
+  CHECK(converged);
+  CHECK(state.iteration < 500);
+
+  auto const &base = static_cast<ResumablePADMM::PADMM const &>(padmm);
+  auto const diagnostic
+      = base(std::make_tuple(Vector<t_complex>::Zero(problem.image_size).eval(), problem.target));
+  CHECK(diagnostic.good == converged);
+  CHECK(diagnostic.x == state.x);
+  CHECK(diagnostic.residual == state.residual);
+}
+
+TEST_CASE("Solver fingerprint", "[checkpoint]") {
+  Problem const problem;
+  auto const fingerprint = problem.solver(10).fingerprint();
+  CHECK(problem.solver(10).fingerprint() == fingerprint);
+  // itermax may change between a run and its resumption
+  CHECK(problem.solver(20).fingerprint() == fingerprint);
+  auto padmm = problem.solver(10);
+  padmm.gamma(2e-2);
+  CHECK(padmm.fingerprint() != fingerprint);
+  padmm = problem.solver(10);
+  padmm.l2ball_proximal_epsilon(2e-2);
+  CHECK(padmm.fingerprint() != fingerprint);
+  padmm = problem.solver(10);
+  padmm.lagrange_update_scale(0.8);
+  CHECK(padmm.fingerprint() != fingerprint);
+  padmm = problem.solver(10);
+  Vector<t_complex> target = problem.target;
+  target(3) *= 2;
+  padmm.target(target);
+  CHECK(padmm.fingerprint() != fingerprint);
+}
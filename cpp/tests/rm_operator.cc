@@ -0,0 +1,92 @@
+#include "catch.hpp"
+#include "purify/RMOperator.h"
+#include "purify/types.h"
+#include "purify/utilities.h"
+
+using namespace purify;
+
+TEST_CASE("RM Operator [lines of sight]", "[lines]") {
+  utilities::rm_params rm_vis;
+  rm_vis.frequency.setLinSpaced(20, 100, 110);
+  rm_vis.weights = Vector<t_complex>::Ones(20);
+  rm_vis.linear_polarisation = Vector<t_complex>::Zero(20);
+  t_int const width = 64;
+  RMOperator op(rm_vis, 4, "kb", width, 2, 0.1);
+  op.lines_per_block = 2;
+  t_int const x_start = std::floor(op.ftsize * 0.5 - width * 0.5);
+  Eigen::FFT<t_real> fft;
+
+  SECTION("Degrid") {
+    Matrix<t_complex> const lines = Matrix<t_complex>::Random(width, 5);
+    Matrix<t_complex> const visibilities = op.degrid_lines(lines);
+    REQUIRE(visibilities.rows() == 20);
+    REQUIRE(visibilities.cols() == 5);
+    for(t_int i = 0; i < lines.cols(); ++i) {
+      Vector<t_complex> padded_image = Vector<t_complex>::Zero(op.ftsize);
+      padded_image.segment(x_start, width) = op.S.cast<t_complex>() * lines.col(i).array();
+      Vector<t_complex> ft_vector(op.ftsize);
+      fft.fwd(ft_vector, padded_image);
+      Vector<t_complex> const expected = (op.G * ft_vector).array() * op.W / op.norm;
+      CHECK(visibilities.col(i).isApprox(expected, 1e-10));
+      CHECK(op.degrid(lines.col(i)).isApprox(expected, 1e-10));
+    }
+  }
+  SECTION("Grid") {
+    Matrix<t_complex> const visibilities = Matrix<t_complex>::Random(20, 5);
+    Matrix<t_complex> const lines = op.grid_lines(visibilities);
+    REQUIRE(lines.rows() == width);
+    REQUIRE(lines.cols() == 5);
+    for(t_int i = 0; i < visibilities.cols(); ++i) {
+      Vector<t_complex> const ft_vector
+          = op.G.adjoint() * (visibilities.col(i).array() * op.W).matrix();
+      Vector<t_complex> padded_image;
+      fft.inv(padded_image, ft_vector);
+      Vector<t_complex> const expected
+          = op.S.cast<t_complex>() * padded_image.segment(x_start, width).array() / op.norm;
+      CHECK(lines.col(i).isApprox(expected, 1e-10));
+      CHECK(op.grid(visibilities.col(i)).isApprox(expected, 1e-10));
+    }
+  }
+  SECTION("Concurrent calls") {
+    // each call plans for a different number of lines, so plans are created from many threads
+    t_int const ncalls = 16;
+    op.lines_per_block = ncalls;
+    Matrix<t_complex> const lines = Matrix<t_complex>::Random(width, ncalls);
+    std::vector<Matrix<t_complex>> visibilities(ncalls);
+#pragma omp parallel for
+    for(t_int i = 0; i < ncalls; ++i)
+      visibilities[i] = op.degrid_lines(lines.leftCols(i + 1));
+    for(t_int i = 0; i < ncalls; ++i)
+      CHECK(visibilities[i].isApprox(op.degrid_lines(lines.leftCols(i + 1)), 1e-10));
+  }
+  SECTION("Wrong size") {
+    CHECK_THROWS_AS(op.degrid_lines(Matrix<t_complex>::Zero(width + 1, 2)), std::runtime_error);
+    CHECK_THROWS_AS(op.grid_lines(Matrix<t_complex>::Zero(21, 2)), std::runtime_error);
+  }
+}
+
+TEST_CASE("RM Operator [covariance]", "[covariance]") {
+  utilities::rm_params rm_vis;
+  rm_vis.frequency.setLinSpaced(30, 100, 120);
+  rm_vis.weights = Vector<t_complex>::Ones(30);
+  rm_vis.linear_polarisation = Vector<t_complex>::Zero(30);
+  t_int const width = 32;
+  RMOperator op(rm_vis, 4, "kb", width, 2, 0.1);
+  op.W = Vector<t_complex>::Random(30).array().abs().cast<t_complex>() + 0.5;
+
+  Matrix<t_complex> expected(width, width);
+  for(t_int j = 0; j < width; ++j)
+    expected.col(j) = op.covariance_calculation(Vector<t_complex>::Unit(width, j));
+
+  CHECK(op.covariance_matrix().isApprox(expected, 1e-10));
+  CHECK(op.covariance_diagonal().isApprox(expected.diagonal(), 1e-10));
+  Matrix<t_complex> const bands = op.covariance_bands({-2, 0, 3});
+  for(t_int i = 0; i < width; ++i) {
+    if(i >= 2)
+      CHECK(std::abs(bands(i, 0) - expected(i, i - 2)) < 1e-10 * std::abs(expected(i, i)));
+    else
+      CHECK(bands(i, 0) == t_complex(0));
+    if(i + 3 < width)
+      CHECK(std::abs(bands(i, 2) - expected(i, i + 3)) < 1e-10 * std::abs(expected(i, i)));
+  }
+}
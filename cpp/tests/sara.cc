@@ -0,0 +1,26 @@
+#include "catch.hpp"
+#include <sopt/linear_transform.h>
+#include <sopt/wavelets.h>
+#include "purify/sara.h"
+
+using namespace purify;
+
+TEST_CASE("Parallel SARA dictionary", "[sara]") {
+  sopt::wavelets::SARA const sara{std::make_tuple("Dirac", 3u), std::make_tuple("DB1", 3u),
+                                  std::make_tuple("DB4", 2u), std::make_tuple("DB8", 1u)};
+  t_uint const rows = 64;
+  t_uint const cols = 32;
+  auto const serial = sopt::linear_transform<t_complex>(sara, rows, cols);
+  auto const parallel = purify::linear_transform(sara, rows, cols);
+
+  Vector<t_complex> const image = Vector<t_complex>::Random(rows * cols);
+  Vector<t_complex> const coefficients = Vector<t_complex>::Random(rows * cols * sara.size());
+  Vector<t_complex> const analysis = parallel.adjoint() * image;
+  Vector<t_complex> const synthesis = parallel * coefficients;
+  REQUIRE(analysis.size() == coefficients.size());
+  REQUIRE(synthesis.size() == image.size());
+  CHECK(analysis.isApprox(serial.adjoint() * image, 1e-12));
+  CHECK(synthesis.isApprox(serial * coefficients, 1e-12));
+  // synthesis is the adjoint of analysis
+  CHECK(std::abs(analysis.dot(coefficients) - image.dot(synthesis)) < 1e-10 * image.size());
+}
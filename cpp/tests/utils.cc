@@ -511,6 +511,35 @@ TEST_CASE("utilities [read_write_vis]", "[read_write_vis]") {
   CHECK(new_random_uv_data.vis.isApprox(random_uv_data.vis, 1e-8));
   CHECK(new_random_uv_data.weights.isApprox(random_uv_data.weights, 1e-8));
 }
+TEST_CASE("utilities [read_vis_format]", "[read_write_vis]") {
+  // blank lines, tabs and a missing new line at the end of the file
+  std::string const vis_file = output_filename("test_format.vis");
+  {
+    std::ofstream out(vis_file);
+    out << "1 2 3 4 0.5\n\n-1.5\t0.25 1e-3 -2 4\r\n  7 8 9 10 2";
+  }
+  auto const uv_data = utilities::read_visibility(vis_file);
+  REQUIRE(uv_data.u.size() == 3);
+  CHECK(uv_data.u(1) == -1.5);
+  CHECK(uv_data.v(1) == -0.25);
+  CHECK(uv_data.w.isZero(0));
+  CHECK(uv_data.vis(1) == t_complex(1e-3, -2));
+  CHECK(uv_data.weights(2) == t_complex(0.5));
+  CHECK(uv_data.vis(2) == t_complex(9, 10));
+  {
+    std::ofstream out(vis_file);
+    out << "1 2 3 4\n1 2 3 x 0.5\n";
+  }
+  CHECK_THROWS_AS(utilities::read_visibility(vis_file), std::runtime_error);
+  {
+    std::ofstream out(vis_file);
+    out << "1 2 3 4\n5 6 7 8";
+  }
+  auto const no_sigma = utilities::read_visibility(vis_file);
+  REQUIRE(no_sigma.u.size() == 2);
+  CHECK(no_sigma.weights.isApprox(Vector<t_complex>::Ones(2)));
+  CHECK_THROWS_AS(utilities::read_visibility(vis_file, true), std::runtime_error);
+}
 TEST_CASE("utilities [file exists]", "[file exists]") {
   std::string vis_file = vla_filename("at166B.3C129.c0.vis");
   // File should exist